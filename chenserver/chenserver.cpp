@@ -46,7 +46,11 @@ int main(int argc, const char *argv[])
             std::string command;
             if (iface->ReadLine(command, keepRunning) && keepRunning)
             {
-                std::string response = ExecuteCommand(game, ui, command, keepRunning);
+                std::string response;
+                {
+                    DisconnectWatcher watcher(*iface, game.StopToken());
+                    response = ExecuteCommand(game, ui, command, keepRunning);
+                }
                 iface->WriteLine(response);
             }
         }
@@ -57,6 +61,39 @@ int main(int argc, const char *argv[])
     return rc;
 }
 
+DisconnectWatcher::DisconnectWatcher(ChessCommandInterface& _iface, SearchStopToken& _token)
+    : iface(_iface)
+    , token(_token)
+    , finished(false)
+{
+    token.reset();
+    thread = std::thread(&DisconnectWatcher::Watch, this);
+}
+
+DisconnectWatcher::~DisconnectWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    wakeup.notify_one();
+    thread.join();
+}
+
+void DisconnectWatcher::Watch()
+{
+    const std::chrono::milliseconds POLL_INTERVAL(10);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeup.wait_for(lock, POLL_INTERVAL, [this]{ return finished; }))
+    {
+        if (iface.ClientDisconnected())
+        {
+            token.requestStop();
+            break;
+        }
+    }
+}
+
 const char *GetWhitePlayerString()  // used by SavePortableGameNotation()
 {
     return "White";
@@ -183,6 +220,11 @@ std::string ExecuteCommand(ChessGameState& game, ChessUI_Server& ui, const std::
     vector<string> args;
     if (ParseCommand(command, verb, args))
     {
+        if (verb == "analyze")
+        {
+            return Analyze(ui, game, args);
+        }
+
         if (verb == "exit")
         {
             keepRunning = false;
@@ -199,6 +241,11 @@ std::string ExecuteCommand(ChessGameState& game, ChessUI_Server& ui, const std::
             return LegalMoveList(game, args);
         }
 
+        if (verb == "mate")
+        {
+            return SolveMate(game, args);
+        }
+
         if (verb == "move")
         {
             return MakeMoves(game, args);
@@ -211,6 +258,41 @@ std::string ExecuteCommand(ChessGameState& game, ChessUI_Server& ui, const std::
             return "OK";
         }
 
+        if (verb == "nodes")
+        {
+            // Make "think" and "analyze" stop after this many nodes instead of
+            // their time limit, so that the same position always gets the same
+            // answer.  0 goes back to using the time limit.
+            if (args.size() != 1)
+            {
+                return BAD_ARGS;
+            }
+            return SetNodeLimit(game, args[0]);
+        }
+
+        if (verb == "nps")
+        {
+            // Limit the search speed in nodes per second, to share the CPU
+            // fairly among many games.  0 removes the limit.
+            if (args.size() != 1)
+            {
+                return BAD_ARGS;
+            }
+            return SetSpeedLimit(game, args[0]);
+        }
+
+        if (verb == "profile")
+        {
+            // Report or reset the execution profiler's counters.
+            return Profile(args);
+        }
+
+        if (verb == "stats")
+        {
+            // Statistics about the most recent "think" or "analyze", as JSON.
+            return SearchStatistics(game);
+        }
+
         if (verb == "status")
         {
             return GameStatus(game);
@@ -235,6 +317,16 @@ std::string ExecuteCommand(ChessGameState& game, ChessUI_Server& ui, const std::
             return Think(ui, game, atoi(args[0].c_str()));
         }
 
+        if (verb == "threads")
+        {
+            // Set the number of threads used by "think".
+            if (args.size() != 1)
+            {
+                return BAD_ARGS;
+            }
+            return SetThreadCount(game, atoi(args[0].c_str()));
+        }
+
         if (verb == "undo")
         {
             if (args.size() != 1)
@@ -305,6 +397,9 @@ std::string MakeMoves(ChessGameState& game, const std::vector<std::string>& move
     return "OK " + to_string(numPushedMoves);     // return "OK " followed by number of moves we made
 }
 
+const int MAX_THINK_MINUTES = 5;        // adjust as needed
+const int MAX_THINK_MILLIS = 1000 * 60 * MAX_THINK_MINUTES;
+
 std::string Think(ChessUI_Server& ui, ChessGameState& game, int thinkTimeMillis)
 {
     using namespace std;
@@ -314,8 +409,6 @@ std::string Think(ChessUI_Server& ui, ChessGameState& game, int thinkTimeMillis)
         return "GAME_OVER";
     }
 
-    const int MAX_THINK_MINUTES = 5;        // adjust as needed
-    const int MAX_THINK_MILLIS = 1000 * 60 * MAX_THINK_MINUTES;
     if ((thinkTimeMillis > 0) && (thinkTimeMillis <= MAX_THINK_MILLIS))
     {
         Move move;
@@ -334,6 +427,166 @@ std::string Think(ChessUI_Server& ui, ChessGameState& game, int thinkTimeMillis)
     return "BAD_THINK_TIME";
 }
 
+std::string Analyze(ChessUI_Server& ui, ChessGameState& game, const std::vector<std::string>& args)
+{
+    using namespace std;
+
+    // analyze millis numLines [format]
+    // Reports the best numLines moves without making any of them:
+    // OK n, then for each line its score (positive favors White),
+    // its number of moves, and the moves themselves.
+
+    if ((args.size() < 2) || (args.size() > 3))
+    {
+        return "BAD_ARGS";
+    }
+
+    if (game.IsGameOver())
+    {
+        return "GAME_OVER";
+    }
+
+    int thinkTimeMillis = atoi(args[0].c_str());
+    if ((thinkTimeMillis <= 0) || (thinkTimeMillis > MAX_THINK_MILLIS))
+    {
+        return "BAD_THINK_TIME";
+    }
+
+    int numLines = atoi(args[1].c_str());
+    if ((numLines < 1) || (numLines > MAX_MULTI_PV))
+    {
+        return "BAD_LINE_COUNT";
+    }
+
+    size_t index = 2;
+    MoveFormatKind format = ParseFormatArg(args, index);
+    if (format == MOVE_FORMAT_INVALID)
+    {
+        return "BAD_FORMAT";
+    }
+
+    vector<BestPath> lines = game.Analyze(ui, thinkTimeMillis, numLines);
+    if (lines.empty())
+    {
+        return "THINK_ERROR";
+    }
+
+    string text = "OK " + to_string(lines.size());
+    for (const BestPath& path : lines)
+    {
+        vector<string> moves = game.FormatLine(path, format);
+        text += " " + to_string(path.m[0].score) + " " + to_string(moves.size());
+        for (const string& movetext : moves)
+        {
+            text += " " + movetext;
+        }
+    }
+    return text;
+}
+
+const UINT32 MAX_MATE_NODES = 20000000;   // about a minute on a typical machine
+
+std::string SolveMate(ChessGameState& game, const std::vector<std::string>& args)
+{
+    using namespace std;
+
+    // mate numMoves [format]
+    // Looks for a forced checkmate by the side to move in at most numMoves
+    // of its own moves.  Responds OK n, then the number of plies in the
+    // mating line and the moves themselves.  n is no more than numMoves,
+    // but shorter mates may exist if the solver ran out of nodes before
+    // it could rule them out.
+
+    if ((args.size() < 1) || (args.size() > 2))
+    {
+        return "BAD_ARGS";
+    }
+
+    if (game.IsGameOver())
+    {
+        return "GAME_OVER";
+    }
+
+    int numMoves = atoi(args[0].c_str());
+    if ((numMoves < 1) || (numMoves > MATE_SOLVER_MAX_MOVES))
+    {
+        return "BAD_MOVE_COUNT";
+    }
+
+    size_t index = 1;
+    MoveFormatKind format = ParseFormatArg(args, index);
+    if (format == MOVE_FORMAT_INVALID)
+    {
+        return "BAD_FORMAT";
+    }
+
+    BestPath path;
+    int mateLength = 0;
+    switch (game.SolveMate(numMoves, MAX_MATE_NODES, path, mateLength))
+    {
+    case MATE_FOUND:
+        break;
+
+    case MATE_NOT_FOUND:
+        return "NO_MATE";
+
+    default:
+        return "MATE_UNKNOWN";
+    }
+
+    vector<string> moves = game.FormatLine(path, format);
+    string text = "OK " + to_string(mateLength) + " " + to_string(moves.size());
+    for (const string& movetext : moves)
+    {
+        text += " " + movetext;
+    }
+    return text;
+}
+
+std::string SetThreadCount(ChessGameState& game, int numThreads)
+{
+    if ((numThreads < 1) || (numThreads > MAX_SEARCH_THREADS))
+    {
+        return "BAD_THREAD_COUNT";
+    }
+    game.SetThreadCount(numThreads);
+    return "OK";
+}
+
+bool ParseCount(const std::string& text, UINT32& count)
+{
+    char *end = nullptr;
+    unsigned long value = strtoul(text.c_str(), &end, 10);
+    if ((text.length() == 0) || (*end != '\0') || (text[0] == '-') || (value > 0xffffffffUL))
+    {
+        return false;
+    }
+    count = static_cast<UINT32>(value);
+    return true;
+}
+
+std::string SetNodeLimit(ChessGameState& game, const std::string& arg)
+{
+    UINT32 maxNodes;
+    if (!ParseCount(arg, maxNodes))
+    {
+        return "BAD_NODE_COUNT";
+    }
+    game.SetNodeLimit(maxNodes);
+    return "OK";
+}
+
+std::string SetSpeedLimit(ChessGameState& game, const std::string& arg)
+{
+    UINT32 nodesPerSecond;
+    if (!ParseCount(arg, nodesPerSecond))
+    {
+        return "BAD_NODE_COUNT";
+    }
+    game.SetSpeedLimit(nodesPerSecond);
+    return "OK";
+}
+
 std::string LegalMoveList(ChessGameState& game, const std::vector<std::string>& args)
 {
     using namespace std;
@@ -387,3 +640,47 @@ std::string History(ChessGameState& game, const std::vector<std::string>& args)
     }
     return listing;
 }
+
+std::string Profile(const std::vector<std::string>& args)
+{
+    using namespace std;
+
+#ifdef CHENARD_PROFILER
+    if (args.size() == 1 && args[0] == "reset")
+    {
+        StartProfiler();
+        return "OK";
+    }
+
+    if (!args.empty())
+    {
+        return "BAD_ARGS";
+    }
+
+    // "OK" followed by the number of regions, then for each region:
+    // name, number of calls, inclusive ticks, exclusive ticks.
+    ProfilerTotals totals[PX_COUNT];
+    ProfilerQueryTotals(totals);
+    string text = "OK " + to_string(PX_COUNT);
+    for (int region = 0; region < PX_COUNT; ++region)
+    {
+        text += " " + string(ProfilerRegionName(region));
+        text += " " + to_string(totals[region].calls);
+        text += " " + to_string(totals[region].inclusive);
+        text += " " + to_string(totals[region].exclusive);
+    }
+    return text;
+#else
+    (void)args;
+    return "PROFILER_DISABLED";
+#endif
+}
+
+std::string SearchStatistics(ChessGameState& game)
+{
+    if (game.LastSearchStats().empty())
+    {
+        return "NO_SEARCH";
+    }
+    return "OK " + game.LastSearchStats();
+}
@@ -5,11 +5,14 @@
 */
 
 #include <assert.h>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <time.h>
 #include <vector>
 #include "chess.h"      // pick up handy CHENARD_LINUX preprocessor symbol
@@ -18,6 +21,7 @@
     #include <unistd.h>
     #include <cstring>
     #include <sys/types.h>
+    #include <sys/select.h>
     #include <sys/socket.h>
     #include <netinet/in.h>
 
@@ -49,6 +53,8 @@
     #endif
 #endif
 #include "uiserver.h"
+#include "matesolv.h"
+#include "profiler.h"
 
 class ChessGameState;
 
@@ -83,13 +89,25 @@ std::string MakeMoves(ChessGameState& game, const std::vector<std::string>& move
 std::string LegalMoveList(ChessGameState& game, const std::vector<std::string>& args);
 std::string TestLegality(ChessGameState& game, const std::string& notation);
 std::string Think(ChessUI_Server& ui, ChessGameState& game, int thinkTimeMillis);
+std::string Analyze(ChessUI_Server& ui, ChessGameState& game, const std::vector<std::string>& args);
+std::string SolveMate(ChessGameState& game, const std::vector<std::string>& args);
+std::string SetThreadCount(ChessGameState& game, int numThreads);
+bool ParseCount(const std::string& text, UINT32& count);
+std::string SetNodeLimit(ChessGameState& game, const std::string& arg);
+std::string SetSpeedLimit(ChessGameState& game, const std::string& arg);
 std::string Undo(ChessGameState& game, int numTurns);
 std::string History(ChessGameState& game, const std::vector<std::string>& args);
+std::string Profile(const std::vector<std::string>& args);
+std::string SearchStatistics(ChessGameState& game);
 
 class ChessGameState
 {
 public:
-    ChessGameState() {}
+    ChessGameState()
+        : threadCount(1)
+        , nodeLimit(0)
+        , speedLimit(0)
+    {}
     ChessGameState(const ChessGameState&) = delete;
     ChessGameState& operator=(const ChessGameState&) = delete;
 
@@ -106,7 +124,15 @@ public:
     void PopMove();
     int GenMoves(MoveList& ml) { return board.GenMoves(ml); }
     bool Think(ChessUI_Server& ui, int thinkTimeMillis, Move& move);
+    std::vector<BestPath> Analyze(ChessUI_Server& ui, int thinkTimeMillis, int numLines);   // best lines first; empty if search failed
+    std::vector<std::string> FormatLine(const BestPath& path, MoveFormatKind format);
+    MateSolverResult SolveMate(int maxMoves, UINT32 maxNodes, BestPath& path, int& mateLength);   // path holds the mating line
+    void SetThreadCount(int numThreads) { threadCount = numThreads; }
+    void SetNodeLimit(UINT32 maxNodes) { nodeLimit = maxNodes; }
+    void SetSpeedLimit(UINT32 nodesPerSecond) { speedLimit = nodesPerSecond; }
     bool IsGameOver() { return board.GameIsOver(); }
+    SearchStopToken& StopToken() { return stopToken; }     // stops Think() from another thread
+    const std::string& LastSearchStats() const { return lastSearchStats; }     // JSON; empty before the first search
 
 private:
     struct MoveState
@@ -120,8 +146,16 @@ private:
         {}
     };
 
+    void PrepareThinker(ComputerChessPlayer& thinker, int thinkTimeMillis);
+
     ChessBoard board;
     std::vector<MoveState> moveStack;
+    ChessEngineContext engine;      // keeps this game's search state apart from any other game's
+    int threadCount;        // number of search threads used by Think()
+    UINT32 nodeLimit;       // if nonzero, Think() stops after this many nodes instead of its time limit
+    UINT32 speedLimit;      // if nonzero, the most nodes per second Think() may search
+    SearchStopToken stopToken;
+    std::string lastSearchStats;    // FormatSearchStatsJson of the most recent Think() or Analyze()
 };
 
 /*
@@ -134,6 +168,34 @@ public:
     virtual ~ChessCommandInterface() {}
     virtual bool ReadLine(std::string& line, bool& keepRunning) = 0;
     virtual void WriteLine(const std::string& line) = 0;
+
+    // Called from another thread while a command is executing, between
+    // ReadLine and WriteLine.  Returns true if the client has gone away,
+    // so there is no point finishing the command.
+    virtual bool ClientDisconnected() { return false; }
+};
+
+/*
+    DisconnectWatcher stops any search on the given token as soon as the
+    client disconnects, for as long as the watcher exists.
+*/
+class DisconnectWatcher
+{
+public:
+    DisconnectWatcher(ChessCommandInterface& _iface, SearchStopToken& _token);
+    DisconnectWatcher(const DisconnectWatcher&) = delete;
+    DisconnectWatcher& operator= (const DisconnectWatcher&) = delete;
+    ~DisconnectWatcher();
+
+private:
+    ChessCommandInterface& iface;
+    SearchStopToken& token;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool finished;
+    std::thread thread;
+
+    void Watch();
 };
 
 class ChessCommandInterface_stdio : public ChessCommandInterface
@@ -156,6 +218,7 @@ public:
     virtual ~ChessCommandInterface_tcp();
     virtual bool ReadLine(std::string& line, bool& keepRunning);
     virtual void WriteLine(const std::string& line);
+    virtual bool ClientDisconnected();
 
 private:
     const int port;
@@ -8,6 +8,7 @@ void ChessGameState::Reset()
 {
     board.Init();
     moveStack.clear();
+    engine.ClearTranspositionTable();
 }
 
 const char * ChessGameState::GameResult()
@@ -149,12 +150,101 @@ void ChessGameState::PopMove()
     }
 }
 
-bool ChessGameState::Think(ChessUI_Server& ui, int thinkTimeMillis, Move& move)
+void ChessGameState::PrepareThinker(ComputerChessPlayer& thinker, int thinkTimeMillis)
 {
     int centis = (thinkTimeMillis + 9) / 10;    // convert milliseconds to centiseconds and round up
-    ComputerChessPlayer thinker(ui);
     thinker.setResignFlag(false);       // do not allow computer to resign
-    thinker.SetTimeLimit(centis);       // set upper limit on how long computer is allowed to think
+    if (nodeLimit > 0)
+    {
+        thinker.SetMaxNodesVisited(nodeLimit);      // reproducible, and ignores the clock
+    }
+    else
+    {
+        thinker.SetTimeLimit(centis);       // set upper limit on how long computer is allowed to think
+    }
+    thinker.SetThreadCount(threadCount);
+    thinker.SetNodesPerSecondLimit(speedLimit);
+    thinker.SetStopToken(&stopToken);   // lets the server give up when the client disconnects
+}
+
+bool ChessGameState::Think(ChessUI_Server& ui, int thinkTimeMillis, Move& move)
+{
+    ComputerChessPlayer thinker(ui, engine);
+    PrepareThinker(thinker, thinkTimeMillis);
     INT32 timeSpent = 0;
-    return thinker.GetMove(board, move, timeSpent);
+    bool result = thinker.GetMove(board, move, timeSpent);
+    lastSearchStats = FormatSearchStatsJson(thinker.QuerySearchStats());
+    return result;
+}
+
+std::vector<BestPath> ChessGameState::Analyze(ChessUI_Server& ui, int thinkTimeMillis, int numLines)
+{
+    ComputerChessPlayer thinker(ui, engine);
+    PrepareThinker(thinker, thinkTimeMillis);
+    thinker.SetMultiPV(numLines);
+    thinker.SetOpeningBookEnable(false);    // the book and training file know only one move, with no score
+    thinker.SetTrainingEnable(false);
+
+    std::vector<BestPath> lines;
+    Move move;
+    INT32 timeSpent = 0;
+    bool result = thinker.GetMove(board, move, timeSpent);
+    lastSearchStats = FormatSearchStatsJson(thinker.QuerySearchStats());
+    if (result)
+    {
+        BestPath found[MAX_MULTI_PV];
+        int count = thinker.GetPrincipalVariations(found, MAX_MULTI_PV);
+        if (count == 0)
+        {
+            // The move did not come from a search (e.g. the only legal move), so all we know is the move itself.
+            found[0].depth = 0;
+            found[0].m[0] = move;
+            count = 1;
+        }
+        lines.assign(found, found + count);
+    }
+    return lines;
+}
+
+MateSolverResult ChessGameState::SolveMate(int maxMoves, UINT32 maxNodes, BestPath& path, int& mateLength)
+{
+    MateSolver solver;
+    solver.SetNodeLimit(maxNodes);
+    solver.SetStopToken(&stopToken);    // lets the server give up when the client disconnects
+
+    MateSolverResult result = solver.Solve(board, maxMoves);
+    mateLength = solver.QueryMateLength();
+
+    Move line[MATE_SOLVER_MAX_PLIES];
+    int numPlies = solver.QueryMateLine(line, MATE_SOLVER_MAX_PLIES);     // always fits in a BestPath
+    path.depth = numPlies - 1;
+    for (int i = 0; i < numPlies; ++i)
+    {
+        path.m[i] = line[i];
+    }
+    return result;
+}
+
+std::vector<std::string> ChessGameState::FormatLine(const BestPath& path, MoveFormatKind format)
+{
+    // Each move must be formatted in the position just before it,
+    // so play the line forward and then take it all back.
+    std::vector<std::string> text;
+    for (int i = 0; i <= path.depth; ++i)
+    {
+        Move move = path.m[i];
+        if (!board.isLegal(move))
+        {
+            break;      // the rest of the line is stale
+        }
+        text.push_back(Format(move, format));
+        PushMove(move);
+    }
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        PopMove();
+    }
+
+    return text;
 }
\ No newline at end of file
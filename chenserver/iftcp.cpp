@@ -258,7 +258,38 @@ std::string ChessCommandInterface_tcp::UrlDecode(const std::string& urltext)
 
 inline void SendString(SOCKET clientSocket, const std::string& text)
 {
-    send(clientSocket, text.c_str(), text.length(), 0);
+#if CHENARD_LINUX
+    const int flags = MSG_NOSIGNAL;     // a client that hung up must not kill the server with SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    send(clientSocket, text.c_str(), text.length(), flags);
+}
+
+
+bool ChessCommandInterface_tcp::ClientDisconnected()
+{
+    if (!IsValidSocket(clientSocket))
+    {
+        return true;
+    }
+
+    // The client is gone if the socket is readable but has no more data:
+    // that means the connection was closed (or failed).
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(clientSocket, &readSet);
+    timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    int count = select(static_cast<int>(clientSocket) + 1, &readSet, nullptr, nullptr, &timeout);
+    if (count <= 0)
+    {
+        return count < 0;
+    }
+
+    char c;
+    return recv(clientSocket, &c, 1, MSG_PEEK) <= 0;
 }
 
 
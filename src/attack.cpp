@@ -3,386 +3,248 @@
      attack.cpp  -  Copyright (C) 1993-2005 by Don Cross
 
      Contains code to see if a given square on a ChessBoard
-     is attacked by a given side.
+     is attacked by a given side (using the board's bitboards),
+     and static exchange evaluation.
 
 ==========================================================================*/
 
+#include <string.h>
+
 #include "chess.h"
+#include "bitboard.h"
 #include "profiler.h"
+#include "side.h"
+
 
+// A square is attacked by a piece exactly when the same kind of piece
+// standing on that square would attack the piece's square, so each test
+// below looks from the target square outward.  Pawns are the exception:
+// a white pawn attacks the target from the squares a black pawn standing
+// on the target would attack, and vice versa.
 
 bool ChessBoard::IsAttackedByWhite ( int offset ) const
 {
-    PROFILER_ENTER (PX_ATTACK);
-    const SQUARE * const base = board + offset;
-    const SQUARE *disp;
+    PROFILER_DETAIL_ENTER (PX_ATTACK);
+    const int square = BitboardSquare [offset];
 
-    // Look for knight attacks...
+    bool attacked =
+        (KnightAttacks [square] & pieceBits [WN_INDEX]) ||
+        (PawnAttacks [1] [square] & pieceBits [WP_INDEX]) ||
+        (KingAttacks [square] & pieceBits [WK_INDEX]);
 
-    if ( inventory[WN_INDEX] > 0 )
+    if ( !attacked )
     {
-        if (    (base [ OFFSET( 1, 2) ] & WN_MASK) 
-             || (base [ OFFSET( 1,-2) ] & WN_MASK) 
-             || (base [ OFFSET(-1, 2) ] & WN_MASK) 
-             || (base [ OFFSET(-1,-2) ] & WN_MASK) 
-             || (base [ OFFSET( 2, 1) ] & WN_MASK) 
-             || (base [ OFFSET( 2,-1) ] & WN_MASK) 
-             || (base [ OFFSET(-2, 1) ] & WN_MASK) 
-             || (base [ OFFSET(-2,-1) ] & WN_MASK) )
-        {
-            PROFILER_EXIT();
-            return true;
-        }
-    }
-
-    const int queensAndBishops = inventory[WQ_INDEX] + inventory[WB_INDEX];
+        const BITBOARD occupied = sideBits[0] | sideBits[1];
+        const BITBOARD queensAndBishops = pieceBits [WQ_INDEX] | pieceBits [WB_INDEX];
+        const BITBOARD queensAndRooks   = pieceBits [WQ_INDEX] | pieceBits [WR_INDEX];
 
-    //-------------------------------------- SOUTHEAST
-    if ( base[SOUTHEAST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*SOUTHEAST; *disp == EMPTY; disp += SOUTHEAST );
-            if ( *disp & (WQ_MASK | WB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[SOUTHEAST] & (WP_MASK | WB_MASK | WQ_MASK | WK_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
+        attacked =
+            (queensAndBishops && (BishopAttacks ( square, occupied ) & queensAndBishops)) ||
+            (queensAndRooks && (RookAttacks ( square, occupied ) & queensAndRooks));
     }
 
-    //-------------------------------------- SOUTHWEST
-    if ( base[SOUTHWEST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*SOUTHWEST; *disp == EMPTY; disp += SOUTHWEST );
-            if ( *disp & (WQ_MASK | WB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[SOUTHWEST] & (WP_MASK | WB_MASK | WQ_MASK | WK_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+    PROFILER_DETAIL_EXIT();
+    return attacked;
+}
 
-    //-------------------------------------- SOUTH
-    const int queensAndRooks = inventory[WQ_INDEX] + inventory[WR_INDEX];
 
-    if ( base[SOUTH] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*SOUTH; *disp == EMPTY; disp += SOUTH );
-            if ( *disp & (WQ_MASK | WR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[SOUTH] & (WQ_MASK | WK_MASK | WR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+//--------------------------------------------------------------------------
 
-    //-------------------------------------- EAST
-    if ( base[EAST] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*EAST; *disp == EMPTY; disp += EAST );
-            if ( *disp & (WQ_MASK | WR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[EAST] & (WQ_MASK | WK_MASK | WR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
 
-    //-------------------------------------- WEST
-    if ( base[WEST] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*WEST; *disp == EMPTY; disp += WEST );
-            if ( *disp & (WQ_MASK | WR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[WEST] & (WQ_MASK | WK_MASK | WR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+bool ChessBoard::IsAttackedByBlack ( int offset ) const
+{
+    PROFILER_DETAIL_ENTER (PX_ATTACK);
+    const int square = BitboardSquare [offset];
 
-    //-------------------------------------- NORTHEAST
-    if ( base[NORTHEAST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*NORTHEAST; *disp == EMPTY; disp += NORTHEAST );
-            if ( *disp & (WQ_MASK | WB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTHEAST] & (WQ_MASK | WK_MASK | WB_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+    bool attacked =
+        (KnightAttacks [square] & pieceBits [BN_INDEX]) ||
+        (PawnAttacks [0] [square] & pieceBits [BP_INDEX]) ||
+        (KingAttacks [square] & pieceBits [BK_INDEX]);
 
-    //-------------------------------------- NORTHWEST
-    if ( base[NORTHWEST] == EMPTY )
+    if ( !attacked )
     {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*NORTHWEST; *disp == EMPTY; disp += NORTHWEST );
-            if ( *disp & (WQ_MASK | WB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTHWEST] & (WQ_MASK | WK_MASK | WB_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+        const BITBOARD occupied = sideBits[0] | sideBits[1];
+        const BITBOARD queensAndBishops = pieceBits [BQ_INDEX] | pieceBits [BB_INDEX];
+        const BITBOARD queensAndRooks   = pieceBits [BQ_INDEX] | pieceBits [BR_INDEX];
 
-    //-------------------------------------- NORTH
-    if ( base[NORTH] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*NORTH; *disp == EMPTY; disp += NORTH );
-            if ( *disp & (WQ_MASK | WR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTH] & (WQ_MASK | WK_MASK | WR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
+        attacked =
+            (queensAndBishops && (BishopAttacks ( square, occupied ) & queensAndBishops)) ||
+            (queensAndRooks && (RookAttacks ( square, occupied ) & queensAndRooks));
     }
 
-    PROFILER_EXIT();
-    return false;
+    PROFILER_DETAIL_EXIT();
+    return attacked;
 }
 
 
+
 //--------------------------------------------------------------------------
+// Static exchange evaluation.
+//
+// Plays out the sequence of captures on one square in which each side
+// always recaptures with its least valuable attacker, and either side
+// may stop whenever continuing would lose material.  Pieces are lifted
+// off a scratch copy of the board as they capture, so sliders lined up
+// behind them (x-rays) join in naturally.  Pins are ignored.
 
+#define  SEE_KING_VALUE   1000     // the king may only capture last
 
-bool ChessBoard::IsAttackedByBlack ( int offset ) const
+static const int KnightJumps [8] =
 {
-    PROFILER_ENTER (PX_ATTACK);
-    const SQUARE * const base = board + offset;
-    const SQUARE *disp;
+    OFFSET( 1, 2), OFFSET( 1,-2), OFFSET(-1, 2), OFFSET(-1,-2),
+    OFFSET( 2, 1), OFFSET( 2,-1), OFFSET(-2, 1), OFFSET(-2,-1)
+};
 
-    // Look for knight attacks...
+static const int DiagonalSteps [4] = { NORTHEAST, NORTHWEST, SOUTHEAST, SOUTHWEST };
+static const int OrthogonalSteps [4] = { NORTH, SOUTH, EAST, WEST };
 
-    if ( inventory[BN_INDEX] > 0 )
-    {
-        if (    (base [ OFFSET( 1, 2) ] & BN_MASK) 
-             || (base [ OFFSET( 1,-2) ] & BN_MASK) 
-             || (base [ OFFSET(-1, 2) ] & BN_MASK) 
-             || (base [ OFFSET(-1,-2) ] & BN_MASK) 
-             || (base [ OFFSET( 2, 1) ] & BN_MASK) 
-             || (base [ OFFSET( 2,-1) ] & BN_MASK) 
-             || (base [ OFFSET(-2, 1) ] & BN_MASK) 
-             || (base [ OFFSET(-2,-1) ] & BN_MASK) )
-        {
-            PROFILER_EXIT();
-            return true;
-        }
-    }
 
-    const int queensAndBishops = inventory[BQ_INDEX] + inventory[BB_INDEX];
+static SCORE SeeValue ( SQUARE piece )
+{
+    return (piece & (WK_MASK | BK_MASK)) ? SEE_KING_VALUE : RAW_PIECE_VALUE(piece);
+}
 
-    //-------------------------------------- NORTHEAST
-    if ( base[NORTHEAST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*NORTHEAST; *disp == EMPTY; disp += NORTHEAST );
-            if ( *disp & (BQ_MASK | BB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTHEAST] & (BQ_MASK | BK_MASK | BB_MASK | BP_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
 
-    //-------------------------------------- NORTHWEST
-    if ( base[NORTHWEST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
-        {
-            for ( disp = base + 2*NORTHWEST; *disp == EMPTY; disp += NORTHWEST );
-            if ( *disp & (BQ_MASK | BB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTHWEST] & (BQ_MASK | BK_MASK | BB_MASK | BP_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+// Returns the offset of the least valuable piece of the given side
+// which attacks 'target' on the board 'b', or 0 if there is none.
 
-    //-------------------------------------- NORTH
-    const int queensAndRooks = inventory[BQ_INDEX] + inventory[BR_INDEX];
+static int LeastValuableAttacker ( const SQUARE *b, int target, bool white )
+{
+    const SQUARE P = white ? WP_MASK : BP_MASK;
+    const SQUARE N = white ? WN_MASK : BN_MASK;
+    const SQUARE B = white ? WB_MASK : BB_MASK;
+    const SQUARE R = white ? WR_MASK : BR_MASK;
+    const SQUARE Q = white ? WQ_MASK : BQ_MASK;
+    const SQUARE K = white ? WK_MASK : BK_MASK;
 
-    if ( base[NORTH] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*NORTH; *disp == EMPTY; disp += NORTH );
-            if ( *disp & (BQ_MASK | BR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
-    }
-    else if ( base[NORTH] & (BQ_MASK | BK_MASK | BR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
+    // Pawns capture toward the enemy, so they attack from behind the target.
+    const int pawnEast = white ? SOUTHEAST : NORTHEAST;
+    const int pawnWest = white ? SOUTHWEST : NORTHWEST;
+
+    if ( b [target + pawnEast] & P )
+        return target + pawnEast;
+
+    if ( b [target + pawnWest] & P )
+        return target + pawnWest;
 
-    //-------------------------------------- EAST
-    if ( base[EAST] == EMPTY )
+    int i, ofs;
+    for ( i=0; i < 8; ++i )
+        if ( b [target + KnightJumps[i]] & N )
+            return target + KnightJumps[i];
+
+    int queen = 0;
+    for ( i=0; i < 4; ++i )
     {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*EAST; *disp == EMPTY; disp += EAST );
-            if ( *disp & (BQ_MASK | BR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
+        for ( ofs = target + DiagonalSteps[i]; b[ofs] == EMPTY; ofs += DiagonalSteps[i] );
+        if ( b[ofs] & B )
+            return ofs;
+        if ( b[ofs] & Q )
+            queen = ofs;
     }
-    else if ( base[EAST] & (BQ_MASK | BK_MASK | BR_MASK) )
+
+    for ( i=0; i < 4; ++i )
     {
-        PROFILER_EXIT();
-        return true;
+        for ( ofs = target + OrthogonalSteps[i]; b[ofs] == EMPTY; ofs += OrthogonalSteps[i] );
+        if ( b[ofs] & R )
+            return ofs;
+        if ( b[ofs] & Q )
+            queen = ofs;
     }
 
-    //-------------------------------------- WEST
-    if ( base[WEST] == EMPTY )
+    if ( queen )
+        return queen;
+
+    for ( i=0; i < 4; ++i )
     {
-        if ( queensAndRooks > 0 )
-        {
-            for ( disp = base + 2*WEST; *disp == EMPTY; disp += WEST );
-            if ( *disp & (BQ_MASK | BR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
-        }
+        if ( b [target + DiagonalSteps[i]] & K )
+            return target + DiagonalSteps[i];
+        if ( b [target + OrthogonalSteps[i]] & K )
+            return target + OrthogonalSteps[i];
     }
-    else if ( base[WEST] & (BQ_MASK | BK_MASK | BR_MASK) )
+
+    return 0;
+}
+
+
+static SCORE SwapOff (
+    SQUARE *b,          // scratch copy of the board
+    int     target,     // square where the exchange takes place
+    SCORE   victim,     // value of the piece captured first
+    int     from,       // square of the piece which captures first
+    bool    white )     // does the first capture belong to White?
+{
+    SCORE gain [40];
+    int   d = 0;
+    SCORE attacker = SeeValue ( b[from] );
+
+    gain[0] = victim;
+    do
     {
-        PROFILER_EXIT();
-        return true;
+        // What the side to move next gains if it recaptures and the
+        // exchange then stops...
+        ++d;
+        gain[d] = attacker - gain[d-1];
+        if ( gain[d] < 0 && -gain[d-1] < 0 )
+            break;      // neither choice can change the outcome
+
+        b[from] = EMPTY;
+        white = !white;
+        from = LeastValuableAttacker ( b, target, white );
+        if ( from )
+            attacker = SeeValue ( b[from] );
     }
+    while ( from );
+
+    // ...and now let each side choose whether to recapture, from the end back.
+    while ( --d )
+        gain[d-1] = (-gain[d-1] > gain[d]) ? gain[d-1] : -gain[d];
+
+    return gain[0];
+}
 
-    //-------------------------------------- SOUTHEAST
-    if ( base[SOUTHEAST] == EMPTY )
+
+template <class Side>
+SCORE ChessBoard::CaptureSEE ( Move move ) const
+{
+    PROFILER_DETAIL_ENTER(PX_ATTACK)
+    const int source = move.source & BOARD_OFFSET_MASK;
+    SCORE score = 0;
+
+    if ( move.dest <= OFFSET(9,9) )
     {
-        if ( queensAndBishops > 0 )
+        if ( board[move.dest] != EMPTY )
         {
-            for ( disp = base + 2*SOUTHEAST; *disp == EMPTY; disp += SOUTHEAST );
-            if ( *disp & (BQ_MASK | BB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
+            SQUARE b [144];
+            memcpy ( b, board, sizeof(b) );
+            score = SwapOff ( b, move.dest, RAW_PIECE_VALUE(board[move.dest]), source, Side::IsWhite );
         }
     }
-    else if ( base[SOUTHEAST] & (BB_MASK | BQ_MASK | BK_MASK) )
+    else
     {
-        PROFILER_EXIT();
-        return true;
-    }
-
-    //-------------------------------------- SOUTHWEST
-    if ( base[SOUTHWEST] == EMPTY )
-    {
-        if ( queensAndBishops > 0 )
+        const int special = move.dest & SPECIAL_MOVE_MASK;
+        if ( special == SPECIAL_MOVE_EP_EAST || special == SPECIAL_MOVE_EP_WEST )
         {
-            for ( disp = base + 2*SOUTHWEST; *disp == EMPTY; disp += SOUTHWEST );
-            if ( *disp & (BQ_MASK | BB_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
+            score = PAWN_VAL;
         }
-    }
-    else if ( base[SOUTHWEST] & (BB_MASK | BQ_MASK | BK_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
-
-    //-------------------------------------- SOUTH
-    if ( base[SOUTH] == EMPTY )
-    {
-        if ( queensAndRooks > 0 )
+        else if ( move.isPawnPromotion() )
         {
-            for ( disp = base + 2*SOUTH; *disp == EMPTY; disp += SOUTH );
-            if ( *disp & (BQ_MASK | BR_MASK) )
-            {
-                PROFILER_EXIT();
-                return true;
-            }
+            // Promotions are never losing captures as far as ordering and
+            // pruning are concerned; just report the material they gain.
+            score = RawPieceValues [move.dest & PIECE_MASK] - PAWN_VAL;
+            if ( special == SPECIAL_MOVE_PROMOTE_CAP_EAST )
+                score += RAW_PIECE_VALUE ( board [source + Side::PawnEast] );
+            else if ( special == SPECIAL_MOVE_PROMOTE_CAP_WEST )
+                score += RAW_PIECE_VALUE ( board [source + Side::PawnWest] );
         }
     }
-    else if ( base[SOUTH] & (BQ_MASK | BK_MASK | BR_MASK) )
-    {
-        PROFILER_EXIT();
-        return true;
-    }
 
-    PROFILER_EXIT();
-    return false;
+    PROFILER_DETAIL_EXIT();
+    return score;
 }
 
+template SCORE ChessBoard::CaptureSEE<WhiteSide> ( Move ) const;
+template SCORE ChessBoard::CaptureSEE<BlackSide> ( Move ) const;
+
 
 /*
     $Log: attack.cpp,v $
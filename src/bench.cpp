@@ -0,0 +1,210 @@
+/*===============================================================================
+
+    bench.cpp  -  Fixed-depth search benchmark for Chenard.
+
+    "chenard --bench [depth] [threads] [hashMB]" searches a built-in set of
+    positions to a fixed depth and reports the total number of nodes, the
+    time taken, and the speed in nodes per second.
+
+    The total number of visited nodes is also printed as a signature.  With
+    one thread the search is deterministic, so the signature depends only on
+    the code and the arguments: a change that is not supposed to change the
+    search (e.g. a faster move generator) must not change the signature,
+    and a change that is supposed to should be noticed.
+
+=============================================================================*/
+
+#include <stdio.h>
+#include <chrono>
+
+#include "chess.h"
+
+
+#define  BENCH_DEFAULT_DEPTH      5
+#define  BENCH_DEFAULT_HASH_MB   16
+
+
+// Openings, middlegames with tactics, and endgames with pawns.  Endgames
+// that the endgame databases know are left out, because they don't search.
+
+static const char * const BenchPositions[] =
+{
+    // Openings
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "rnbqkb1r/1p2pppp/p2p1n2/8/3NP3/2N5/PPP2PPP/R1BQKB1R w KQkq - 0 6",
+    "r1bqk2r/2ppbppp/p1n2n2/1p2p3/4P3/1B3N2/PPPP1PPP/RNBQR1K1 b kq - 1 7",
+    "rnbqkb1r/ppp2ppp/4pn2/3p2B1/2PP4/2N5/PP2PPPP/R2QKBNR b KQkq - 3 4",
+    "rnbqk1nr/ppp2ppp/4p3/3p4/1b1PP3/2N5/PPP2PPP/R1BQKBNR w KQkq - 2 4",
+    "rnbq1rk1/ppp1ppbp/3p1np1/8/2PPP3/2N2N2/PP3PPP/R1BQKB1R w KQ - 1 6",
+    "rn1qkbnr/pp2pppp/2p5/5b2/3PN3/8/PPP2PPP/R1BQKBNR w KQkq - 1 5",
+    "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+
+    // Positions used for testing move generators
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+
+    // Bratko-Kopec test
+    "1k1r4/pp1b1R2/3q2pp/4p3/2B5/4Q3/PPP2B2/2K5 b - - 0 1",
+    "3r1k2/4npp1/1ppr3p/p6P/P2PPPP1/1NR5/5K2/2R5 w - - 0 1",
+    "2q1rr1k/3bbnnp/p2p1pp1/2pPp3/PpP1P1P1/1P2BNNP/2BQ1PRK/7R b - - 0 1",
+    "rnbqkb1r/p3pppp/1p6/2ppP3/3N4/2P5/PPP1QPPP/R1B1KB1R w KQkq - 0 1",
+    "r1b2rk1/2q1b1pp/p2ppn2/1p6/3QP3/1BN1B3/PPP3PP/R4RK1 w - - 0 1",
+    "2r3k1/pppR1pp1/4p3/4P1P1/5P2/1P4K1/P1P5/8 w - - 0 1",
+    "1nk1r1r1/pp2n1pp/4p3/q2pPp1N/b1pP1P2/B1P2R2/2P1B1PP/R2Q2K1 w - - 0 1",
+    "4b3/p3kp2/6p1/3pP2p/2pP1P2/4K1P1/P3N2P/8 w - - 0 1",
+    "2kr1bnr/pbpq4/2n1pp2/3p3p/3P1P1B/2N2N1Q/PPP3PP/2KR1B1R w - - 0 1",
+    "3rr1k1/pp3pp1/1qn2np1/8/3p4/PP1R1P2/2P1NQPP/R1B3K1 b - - 0 1",
+    "2r1nrk1/p2q1ppp/bp1p4/n1pPp3/P1P1P3/2PBB1N1/4QPPP/R4RK1 w - - 0 1",
+    "r3r1k1/ppqb1ppp/8/4p1NQ/8/2P5/PP3PPP/R3R1K1 b - - 0 1",
+    "r2q1rk1/4bppp/p2p4/2pP4/3pP3/3Q4/PP1B1PPP/R3R1K1 w - - 0 1",
+    "rnb2r1k/pp2p2p/2pp2p1/q2P1p2/8/1Pb2NP1/PB2PPBP/R2Q1RK1 w - - 0 1",
+    "2r3k1/1p2q1pp/2b1pr2/p1pp4/6Q1/1P1PP1R1/P1PN2PP/5RK1 w - - 0 1",
+    "r1bqkb1r/4npp1/p1p4p/1p1pP1B1/8/1B6/PPPN1PPP/R2Q1RK1 w kq - 0 1",
+    "r2q1rk1/1ppnbppp/p2p1nb1/3Pp3/2P1P1P1/2N2N1P/PPB1QP2/R1B2RK1 b - - 0 1",
+    "r1bq1rk1/pp2ppbp/2np2p1/2n5/P3PP2/N1P2N2/1PB3PP/R1B1QRK1 b - - 0 1",
+    "3rr3/2pq2pk/p2p1pnp/8/2QBPP2/1P6/P5PP/4RRK1 b - - 0 1",
+    "r4k2/pb2bp1r/1p1qp2p/3pNp2/3P1P2/2N3P1/PPP1Q2P/2KRR3 w - - 0 1",
+    "3rn2k/ppb2rpp/2ppqp2/5N2/2P1P3/1P5Q/PB3PPP/3RR1K1 w - - 0 1",
+    "2r2rk1/1bqnbpp1/1p1ppn1p/pP6/N1P1P3/P2B1N1P/1B2QPP1/R2R2K1 b - - 0 1",
+    "r1bqk2r/pp2bppp/2p5/3pP3/P2Q1P2/2N1B3/1PP3PP/R4RK1 b kq - 0 1",
+    "r2qnrnk/p2b2b1/1p1p2pp/2pPpp2/1PP1P3/PRNBB3/3QNPPP/5RK1 w - - 0 1",
+
+    // Tactics
+    "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+    "5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - 0 1",
+    "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1",
+    "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1",
+    "rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b KQkq - 0 1",
+    "r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w - - 0 1",
+    "3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - 0 1",
+    "2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w - - 0 1",
+
+    // Endgames
+    "8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b - - 0 1",
+    "7k/p7/1R5K/6r1/6p1/6P1/8/8 w - - 0 1",
+    "8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - - 0 1",
+    "1K1k4/1P6/8/8/8/8/r7/2R5 w - - 0 1",
+    "8/5pk1/6p1/R7/6PP/5K2/r7/8 w - - 0 1",
+    "8/8/4kpp1/3p4/p2P2P1/P2B1K2/8/5b2 w - - 0 1",
+    "8/6p1/8/8/8/8/1P6/k1K5 w - - 0 1",
+};
+
+
+// A user interface that shows nothing, and remembers the statistics
+// of the most recent search.
+
+class ChessUI_Bench: public ChessUI_Silent
+{
+public:
+    ChessUI_Bench(): visited(0), evaluated(0), generated(0) {}
+
+    void ReportComputerStats (
+        INT32   /*thinkTime*/,
+        UINT32  nodesVisited,
+        UINT32  nodesEvaluated,
+        UINT32  nodesGenerated,
+        int     /*fwSearchDepth*/,
+        UINT32  /*vis*/ [NODES_ARRAY_SIZE],
+        UINT32  /*gen*/ [NODES_ARRAY_SIZE] )
+    {
+        visited   = nodesVisited;
+        evaluated = nodesEvaluated;
+        generated = nodesGenerated;
+    }
+
+    UINT32  visited;
+    UINT32  evaluated;
+    UINT32  generated;
+};
+
+
+int RunBenchmark (
+    int depth,              // 0 = BENCH_DEFAULT_DEPTH
+    int numThreads,
+    int hashMegabytes )     // 0 = BENCH_DEFAULT_HASH_MB
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if ( depth <= 0 )
+        depth = BENCH_DEFAULT_DEPTH;
+
+    if ( hashMegabytes <= 0 )
+        hashMegabytes = BENCH_DEFAULT_HASH_MB;
+
+    const int numPositions = int ( sizeof(BenchPositions) / sizeof(BenchPositions[0]) );
+
+    ChessEngineContext engine;
+    engine.SetTranspositionTableSize ( hashMegabytes );
+    ChessUI_Bench ui;
+
+    UINT64 totalVisited = 0;
+    UINT64 totalEvaluated = 0;
+    UINT64 totalGenerated = 0;
+    INT64  totalMicroseconds = 0;
+
+    for ( int i=0; i < numPositions; ++i )
+    {
+        ChessBoard board;
+        if ( !board.SetForsythEdwardsNotation ( BenchPositions[i] ) )
+        {
+            fprintf ( stderr, "Error:  Invalid benchmark FEN '%s'\n", BenchPositions[i] );
+            return 1;
+        }
+
+        // Each position starts from nothing, so that its node count
+        // does not depend on the positions searched before it.
+        engine.GetTranspositionTable().reset();
+
+        ComputerChessPlayer player ( ui, engine );
+        player.SetSearchDepth ( depth );
+        player.SetThreadCount ( numThreads );
+        player.SetSearchBias ( 0 );
+        player.SetOpeningBookEnable ( false );
+        player.SetTrainingEnable ( false );
+        player.setResignFlag ( false );
+
+        ui.visited = ui.evaluated = ui.generated = 0;
+
+        Move move;
+        INT32 timeSpent = 0;
+        const Clock::time_point start = Clock::now();
+        player.GetMove ( board, move, timeSpent );
+        const INT64 microseconds = std::chrono::duration_cast<std::chrono::microseconds> ( Clock::now() - start ).count();
+
+        char moveString [64];
+        FormatChessMove ( board, move, moveString );
+        printf ( "Position %2d/%d: %-8s %10lu nodes  %8.3lf seconds\n",
+                 i+1,
+                 numPositions,
+                 moveString,
+                 (unsigned long) ui.visited,
+                 microseconds / 1.0e+6 );
+
+        totalVisited      += ui.visited;
+        totalEvaluated    += ui.evaluated;
+        totalGenerated    += ui.generated;
+        totalMicroseconds += microseconds;
+    }
+
+    const double seconds = totalMicroseconds / 1.0e+6;
+    const double nps = (totalMicroseconds > 0) ? (totalVisited / seconds) : 0.0;
+
+    printf ( "\n" );
+    printf ( "Depth:              %d\n", depth );
+    printf ( "Threads:            %d\n", numThreads );
+    printf ( "Hash:               %d MB\n", hashMegabytes );
+    printf ( "Nodes visited:      %llu\n", (unsigned long long) totalVisited );
+    printf ( "Nodes evaluated:    %llu\n", (unsigned long long) totalEvaluated );
+    printf ( "Nodes generated:    %llu\n", (unsigned long long) totalGenerated );
+    printf ( "Time:               %0.3lf seconds\n", seconds );
+    printf ( "Nodes/second:       %0.0lf\n", nps );
+    printf ( "Signature:          %llu%s\n",
+             (unsigned long long) totalVisited,
+             (numThreads > 1) ? "  (not reproducible with more than one thread)" : "" );
+
+    return 0;
+}
+
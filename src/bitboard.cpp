@@ -0,0 +1,237 @@
+/*===============================================================================
+
+    bitboard.cpp  -  Bitboard attack tables for Chenard.
+
+    Builds the tables declared in bitboard.h.  The attack sets are worked
+    out the slow way, by walking rays square by square, once at startup.
+
+    The magic numbers below were found by trying random multipliers with
+    few bits set until one sent every occupancy of a square's rays to a
+    table entry holding the right attack set.  That search takes the
+    better part of a second, so its results are kept here instead, and
+    startup only checks that they still work.
+
+=============================================================================*/
+
+#include "chess.h"
+#include "bitboard.h"
+
+int       BitboardSquare [144];
+BITBOARD  BitboardBit [144];
+
+BITBOARD  KnightAttacks [64];
+BITBOARD  KingAttacks [64];
+BITBOARD  PawnAttacks [2] [64];
+
+BitboardMagic  BishopMagic [64];
+BitboardMagic  RookMagic [64];
+
+// Each square needs a table entry for every subset of its mask: 2^9 at
+// most for a bishop (in the center) and 2^12 for a rook (in a corner).
+#define  BISHOP_TABLE_SIZE   5248
+#define  ROOK_TABLE_SIZE   102400
+
+static BITBOARD  BishopTable [BISHOP_TABLE_SIZE];
+static BITBOARD  RookTable [ROOK_TABLE_SIZE];
+
+// Multipliers for the portable index (unused when PEXT makes the index).
+static const BITBOARD BishopMagicNumbers [64] =
+{
+    0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+    0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+    0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+    0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+    0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+    0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+    0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+    0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+    0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+    0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+    0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+    0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+    0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+    0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+    0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+    0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+};
+
+static const BITBOARD RookMagicNumbers [64] =
+{
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+static const int BishopDirections [4] [2] = { {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+static const int RookDirections [4] [2]   = { {1,0}, {-1,0}, {0,1}, {0,-1} };
+
+
+static inline bool OnBoard ( int x, int y )
+{
+    return x >= 0 && x <= 7 && y >= 0 && y <= 7;
+}
+
+
+static inline BITBOARD SquareBit ( int x, int y )
+{
+    return BITBOARD(1) << (x + 8*y);
+}
+
+
+static int CountBits ( BITBOARD b )
+{
+    int count = 0;
+    for ( ; b; b &= b - 1 )
+        ++count;
+    return count;
+}
+
+
+static BITBOARD JumpAttacks ( int square, const int jumps[][2], int numJumps )
+{
+    BITBOARD attacks = 0;
+    for ( int i=0; i < numJumps; ++i )
+    {
+        const int x = square%8 + jumps[i][0];
+        const int y = square/8 + jumps[i][1];
+        if ( OnBoard ( x, y ) )
+            attacks |= SquareBit ( x, y );
+    }
+    return attacks;
+}
+
+
+// Squares a slider on 'square' attacks when 'occupied' holds the other
+// pieces: each ray runs up to and including the first occupied square.
+static BITBOARD SlowSliderAttacks ( int square, BITBOARD occupied, const int directions[4][2] )
+{
+    BITBOARD attacks = 0;
+    for ( int d=0; d < 4; ++d )
+    {
+        int x = square%8 + directions[d][0];
+        int y = square/8 + directions[d][1];
+        for ( ; OnBoard ( x, y ); x += directions[d][0], y += directions[d][1] )
+        {
+            attacks |= SquareBit ( x, y );
+            if ( occupied & SquareBit ( x, y ) )
+                break;
+        }
+    }
+    return attacks;
+}
+
+
+// The squares whose occupancy can change a slider's attacks: its rays,
+// less the last square of each, which is attacked whether occupied or not.
+static BITBOARD SliderMask ( int square, const int directions[4][2] )
+{
+    BITBOARD mask = 0;
+    for ( int d=0; d < 4; ++d )
+    {
+        const int dx = directions[d][0];
+        const int dy = directions[d][1];
+        int x = square%8 + dx;
+        int y = square/8 + dy;
+        for ( ; OnBoard ( x+dx, y+dy ); x += dx, y += dy )
+            mask |= SquareBit ( x, y );
+    }
+    return mask;
+}
+
+
+static void InitSliderTables (
+    BitboardMagic   magic[64],
+    const BITBOARD  magicNumbers[64],
+    BITBOARD       *table,
+    int             tableSize,
+    const int       directions[4][2] )
+{
+    BITBOARD *next = table;
+    for ( int square=0; square < 64; ++square )
+    {
+        BitboardMagic &m = magic[square];
+        m.mask = SliderMask ( square, directions );
+        m.magic = magicNumbers[square];
+        m.shift = 64 - CountBits ( m.mask );
+        m.attacks = next;
+
+        next += BITBOARD(1) << CountBits ( m.mask );
+        if ( next > table + tableSize )
+            ChessFatal ( "Bitboard attack table overflow in InitSliderTables" );
+
+        // Visit every subset of the mask (the "Carry-Rippler" trick).
+        // No attack set is empty, so an empty entry has not been filled yet.
+        BITBOARD subset = 0;
+        do
+        {
+            const BITBOARD attacks = SlowSliderAttacks ( square, subset, directions );
+            BITBOARD &entry = m.attacks [ BitboardMagicIndex ( m, subset ) ];
+            if ( entry == 0 )
+                entry = attacks;
+            else if ( entry != attacks )
+                ChessFatal ( "Bad magic number in InitSliderTables" );
+
+            subset = (subset - m.mask) & m.mask;
+        }
+        while ( subset );
+    }
+}
+
+
+static bool GenerateBitboards()
+{
+    static const int knightJumps [8] [2] = { {1,2}, {2,1}, {2,-1}, {1,-2}, {-1,-2}, {-2,-1}, {-2,1}, {-1,2} };
+    static const int kingSteps [8] [2]   = { {1,0}, {1,1}, {0,1}, {-1,1}, {-1,0}, {-1,-1}, {0,-1}, {1,-1} };
+    static const int whitePawnCaptures [2] [2] = { {1,1}, {-1,1} };
+    static const int blackPawnCaptures [2] [2] = { {1,-1}, {-1,-1} };
+
+    for ( int ofs=0; ofs < 144; ++ofs )
+    {
+        const int x = XPART(ofs) - 2;
+        const int y = YPART(ofs) - 2;
+        if ( OnBoard ( x, y ) )
+        {
+            BitboardSquare[ofs] = x + 8*y;
+            BitboardBit[ofs] = SquareBit ( x, y );
+        }
+        else
+        {
+            BitboardSquare[ofs] = -1;
+            BitboardBit[ofs] = 0;
+        }
+    }
+
+    for ( int square=0; square < 64; ++square )
+    {
+        KnightAttacks[square]  = JumpAttacks ( square, knightJumps, 8 );
+        KingAttacks[square]    = JumpAttacks ( square, kingSteps, 8 );
+        PawnAttacks[0][square] = JumpAttacks ( square, whitePawnCaptures, 2 );
+        PawnAttacks[1][square] = JumpAttacks ( square, blackPawnCaptures, 2 );
+    }
+
+    InitSliderTables ( BishopMagic, BishopMagicNumbers, BishopTable, BISHOP_TABLE_SIZE, BishopDirections );
+    InitSliderTables ( RookMagic, RookMagicNumbers, RookTable, ROOK_TABLE_SIZE, RookDirections );
+    return true;
+}
+
+
+void InitBitboards()
+{
+    // Like the Zobrist keys, the tables are built the first time
+    // any ChessBoard is constructed.
+    static const bool generated = GenerateBitboards();
+    (void) generated;
+}
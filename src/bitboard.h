@@ -0,0 +1,98 @@
+/*===============================================================================
+
+    bitboard.h  -  Bitboard attack tables for Chenard.
+
+    The ChessBoard keeps, alongside its 12x12 mailbox, one 64-bit set of
+    squares for each kind of piece and one for each side's pieces.  Bit n
+    is the square (n % 8, n / 8) counting from a1, so a1 = 0, h1 = 7 and
+    h8 = 63.  With these, "is this square attacked?" becomes a handful of
+    table lookups ANDed against the piece sets instead of eight ray walks.
+
+    Sliding pieces use "magic" bitboards: the occupied squares on a
+    piece's rays are hashed into an index into a table of precomputed
+    attack sets.  On processors with BMI2 the PEXT instruction makes the
+    index directly; elsewhere a multiply by a magic number and a shift
+    does the same job portably.
+
+=============================================================================*/
+#ifndef __ddc_chenard_bitboard_h
+#define __ddc_chenard_bitboard_h
+
+#ifndef BITBOARD_USE_PEXT
+    #ifdef __BMI2__
+        #define BITBOARD_USE_PEXT  1
+    #else
+        #define BITBOARD_USE_PEXT  0
+    #endif
+#endif
+
+#if BITBOARD_USE_PEXT
+    #include <immintrin.h>
+#endif
+
+typedef UINT64  BITBOARD;
+
+// Converts a mailbox offset into a bitboard square number, or into
+// the set holding just that square (empty for OFFBOARD squares).
+extern int       BitboardSquare [144];      // -1 for OFFBOARD squares
+extern BITBOARD  BitboardBit [144];
+
+extern BITBOARD  KnightAttacks [64];
+extern BITBOARD  KingAttacks [64];
+extern BITBOARD  PawnAttacks [2] [64];     // [0] = squares a white pawn attacks, [1] = black
+
+struct BitboardMagic
+{
+    BITBOARD   mask;        // squares on the rays whose occupancy matters
+    BITBOARD   magic;       // multiplier that hashes them without harmful collisions
+    BITBOARD  *attacks;     // this square's part of the attack table
+    int        shift;       // 64 minus the number of bits in 'mask'
+};
+
+extern BitboardMagic  BishopMagic [64];
+extern BitboardMagic  RookMagic [64];
+
+void InitBitboards();   // safe to call more than once
+
+
+inline unsigned BitboardMagicIndex ( const BitboardMagic &m, BITBOARD occupied )
+{
+#if BITBOARD_USE_PEXT
+    return unsigned ( _pext_u64 ( occupied, m.mask ) );
+#else
+    return unsigned ( ((occupied & m.mask) * m.magic) >> m.shift );
+#endif
+}
+
+
+inline BITBOARD BishopAttacks ( int square, BITBOARD occupied )
+{
+    const BitboardMagic &m = BishopMagic [square];
+    return m.attacks [ BitboardMagicIndex ( m, occupied ) ];
+}
+
+
+inline BITBOARD RookAttacks ( int square, BITBOARD occupied )
+{
+    const BitboardMagic &m = RookMagic [square];
+    return m.attacks [ BitboardMagicIndex ( m, occupied ) ];
+}
+
+
+// Which of the sets in ChessBoard::sideBits holds 'piece' (white = 0, black = 1).
+#define  BB_SIDE(piece)   (SPIECE_INDEX(piece) >> 4)
+
+// Adds 'piece' to the bitboards at 'ofs' if it is not there, or removes it
+// if it is.  For use inside ChessBoard member functions, like the hash
+// updates in move.cpp: every change to board[] must be matched by these.
+#define  BB_TOGGLE(piece,ofs)   \
+    ( pieceBits [ SPIECE_INDEX(piece) ] ^= BitboardBit[ofs],  \
+      sideBits [ BB_SIDE(piece) ] ^= BitboardBit[ofs] )
+
+// Moves 'piece' from one square to another in the bitboards.
+#define  BB_MOVE(piece,from,to)   \
+    ( pieceBits [ SPIECE_INDEX(piece) ] ^= (BitboardBit[from] | BitboardBit[to]),  \
+      sideBits [ BB_SIDE(piece) ] ^= (BitboardBit[from] | BitboardBit[to]) )
+
+
+#endif /* __ddc_chenard_bitboard_h */
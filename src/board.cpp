@@ -10,12 +10,16 @@
 #include <assert.h>
 
 #include "chess.h"
+#include "bitboard.h"
 
 
 ChessBoard::ChessBoard():
     gameHistory ( new Move [MAX_GAME_HISTORY] ),
     initialFen (0)
 {
+    InitZobristKeys();
+    InitBitboards();
+
     whiteRepeatHash = new int [REPEAT_HASH_SIZE];
     blackRepeatHash = new int [REPEAT_HASH_SIZE];
 
@@ -33,6 +37,9 @@ ChessBoard::ChessBoard ( const ChessBoard &other ):
     gameHistory ( new Move [MAX_GAME_HISTORY] ),
     initialFen (0)
 {
+    InitZobristKeys();
+    InitBitboards();
+
     whiteRepeatHash = new int[REPEAT_HASH_SIZE];
     blackRepeatHash = new int[REPEAT_HASH_SIZE];
 
@@ -63,6 +70,12 @@ ChessBoard & ChessBoard::operator= ( const ChessBoard &other )
         bmaterial       =   other.bmaterial;
         wk_offset       =   other.wk_offset;
         bk_offset       =   other.bk_offset;
+
+        for ( int i=0; i < PIECE_ARRAY_SIZE; i++ )
+            pieceBits[i] = other.pieceBits[i];
+
+        sideBits[0]     =   other.sideBits[0];
+        sideBits[1]     =   other.sideBits[1];
         white_to_move   =   other.white_to_move;
 
         for ( int i=0; i < PIECE_ARRAY_SIZE; i++ )
@@ -168,6 +181,7 @@ void ChessBoard::Init()
     initialPlyNumber = 0;
     FreeString (initialFen);    // side effect: causes us to interpret this ChessBoard object as unedited.
     lastCapOrPawn = -1;
+    UpdateBitboards();
     memset(whiteRepeatHash, 0, REPEAT_HASH_SIZE * sizeof(whiteRepeatHash[0]));
     memset(blackRepeatHash, 0, REPEAT_HASH_SIZE * sizeof(blackRepeatHash[0]));
     cachedHash = CalcHash();
@@ -255,17 +269,36 @@ int ChessBoard::NumberOfRepetitions()
     // Strategy: make the moves found in the history of 'this'
     // into 'x', and look for positions that exactly match
 
-    static ChessBoard x;   // make static so memory isn't allocated on each call
+    // Make static so memory isn't allocated on each call,
+    // and thread_local so that Lazy SMP helper threads each get their own.
+    static thread_local ChessBoard x;
     x.Init();
 
     UnmoveInfo unmove;
     int numRepetitions = 0;     // we compare against every position including the current position
     int maxPly = (ply_number < MAX_GAME_HISTORY) ? ply_number : MAX_GAME_HISTORY;
+
+    // A pass made by the search (null-move pruning) is not a legal move,
+    // so a position after it cannot really repeat one from before it.
+    // Only count positions from the most recent pass onward.
+    int firstPly = 0;
+    for ( int ply = maxPly-1; ply >= 0; --ply )
+    {
+        if ( gameHistory[ply].dest == SPECIAL_MOVE_NULL )
+        {
+            firstPly = ply;
+            break;
+        }
+    }
+
     for ( int ply=0; ply < maxPly; ++ply )
     {
         Move m = gameHistory[ply];
-        x.MakeMove ( m, unmove );
-        if ( *this == x )
+        if ( m.dest == SPECIAL_MOVE_NULL )
+            x.MakeNullMove ( unmove );
+        else
+            x.MakeMove ( m, unmove );
+        if ( ply >= firstPly && *this == x )
             ++numRepetitions;
     }
 
@@ -372,6 +405,7 @@ bool ChessBoard::SetOffsetContents ( SQUARE s, int offset, bool force )
                         if ( board[kludge] == EMPTY )
                         {
                             board[kludge] = board[offset];
+                            BB_TOGGLE ( board[kludge], kludge );
                             if ( board[kludge] & BK_MASK )
                                 bk_offset = kludge;
                             else
@@ -392,12 +426,14 @@ bool ChessBoard::SetOffsetContents ( SQUARE s, int offset, bool force )
 
             if ( s == WKING && offset != wk_offset )
             {
+                BB_TOGGLE ( WKING, wk_offset );
                 board [wk_offset] = EMPTY;
                 wk_offset = offset;
                 flags |= SF_WKMOVED;
             }
             else if ( s == BKING && offset != bk_offset )
             {
+                BB_TOGGLE ( BKING, bk_offset );
                 board [bk_offset] = EMPTY;
                 bk_offset = offset;
                 flags |= SF_BKMOVED;
@@ -419,6 +455,12 @@ bool ChessBoard::SetOffsetContents ( SQUARE s, int offset, bool force )
                     flags |= SF_BKRMOVED;
             }
 
+            if ( board [offset] & (WHITE_MASK | BLACK_MASK) )
+                BB_TOGGLE ( board[offset], offset );
+
+            if ( s & (WHITE_MASK | BLACK_MASK) )
+                BB_TOGGLE ( s, offset );
+
             board [offset] = s;
 
             return true;
@@ -508,6 +550,8 @@ void ChessBoard::Update()
         }
     }
 
+    UpdateBitboards();
+
     if ( IsAttackedByBlack(wk_offset) )
     {
         flags |= SF_WCHECK;
@@ -530,6 +574,23 @@ void ChessBoard::Update()
 }
 
 
+void ChessBoard::UpdateBitboards()
+{
+    int i;
+    for ( i=0; i < PIECE_ARRAY_SIZE; i++ )
+        pieceBits[i] = 0;
+
+    sideBits[0] = sideBits[1] = 0;
+
+    for ( i=OFFSET(2,2); i <= OFFSET(9,9); i++ )
+    {
+        SQUARE s = board[i];
+        if ( s & (WHITE_MASK | BLACK_MASK) )
+            BB_TOGGLE ( s, i );
+    }
+}
+
+
 char PieceRepresentation ( SQUARE square )
 {
     switch ( square )
@@ -789,7 +789,7 @@ int ChessGA::battle ( int g1, int g2 )
             whiteIndex, gw.fitness(), gw.numGames(),
             blackIndex, gb.fitness(), gb.numGames() );
 
-        ComputerChessPlayer::XposTable->reset();
+        ChessEngineContext::Default().GetTranspositionTable().reset();
 
         ui->DrawBoard (board);
 
@@ -1364,7 +1364,7 @@ int GeneBattleGame (
     const int maxPliesAllowed = 300;
     for ( int ply=0; ply < maxPliesAllowed; ++ply )
     {
-        ComputerChessPlayer::XposTable->reset();
+        ChessEngineContext::Default().GetTranspositionTable().reset();
 
         ui.DrawBoard (board);
 
@@ -101,6 +101,11 @@ ChessGeneDefinition ChessGene::DefTable[] =
     { "MO_Forward",                5,     0,     20 },    //  79
     { "MO_Castle",                10,     0,     40 },    //  80
     { "KnightForkUncertainty",     7,     0,      9 },    //  81
+    { "S_NullMoveReduction",       2,     1,      3 },    //  82
+    { "S_LmrMinDepth",             3,     2,      6 },    //  83
+    { "S_LmrMinMoves",             4,     2,     12 },    //  84
+    { "S_LmrBase",                50,     0,    150 },    //  85
+    { "S_LmrDivisor",            250,   150,    400 },    //  86
 
     { 0, 0, 0, 0 }  // marks end of list
 };
@@ -8,10 +8,18 @@
 #endif
 
 //#define CHENARD_PROFILER 1
+//#define CHENARD_PROFILER_DETAIL 1     // also time MakeMove/UnmakeMove and attack tests (slow)
 
 #ifndef __DDC_CHESS_32_H
 #define __DDC_CHESS_32_H
 
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #if 1
     // __asm keyword not allowed in x64 Windows builds
     #define BREAKPOINT()    ((void)0)
@@ -48,6 +56,10 @@ class ChessPlayer;
 class ComputerChessPlayer;
 class ChessGame;
 class ChessUI;
+class SearchHelper;
+struct SearchStats;
+struct WhiteSide;       // see side.h
+struct BlackSide;
 
 #define NODES_ARRAY_SIZE    100
 
@@ -85,6 +97,9 @@ class ChessUI;
 
 #endif  // __BORLANDC__
 
+typedef unsigned long long  UINT64;
+typedef long long           INT64;
+
 typedef UINT32          SQUARE;    //holds contents of square on chess board
 typedef unsigned char   BYTE;
 typedef signed char     INT8;
@@ -401,7 +416,7 @@ struct UnmoveInfo
     SCORE     bmaterial;
     Move      prev_move;        //prev ChessBoard::prev_move (for e.p.)
     INT16     lastCapOrPawn;
-    UINT32    cachedHash;
+    UINT64    cachedHash;
 };
 
 // http://www.stmintz.com/ccc/index.php?id=424966
@@ -429,6 +444,9 @@ struct MoveList
 
 #define MAX_BESTPATH_DEPTH  50
 
+#define LMR_MAX_DEPTH       32      // size of ComputerChessPlayer::lmrTable
+#define LMR_MAX_MOVES       64
+
 #define DEBUG_BEST_PATH  0
 
 struct BestPath
@@ -444,6 +462,58 @@ struct BestPath
 };
 
 
+/*-------------------------------------------------------------------
+     MovePicker hands out the moves of an interior search node in
+     stages, so that a node which cuts off early never pays for
+     generating, legality testing and sorting moves it won't search:
+
+        1. best path move from the previous iteration, if any
+        2. best reply remembered by the transposition table
+        3. captures and promotions, most valuable victim first
+        4. killer move
+        5. everything else, by history heuristic
+-------------------------------------------------------------------*/
+
+enum MovePickerStage
+{
+    MPS_BEST_PATH,
+    MPS_XPOS,
+    MPS_GEN_CAPTURES,
+    MPS_CAPTURES,
+    MPS_KILLER,
+    MPS_GEN_QUIET,
+    MPS_QUIET,
+    MPS_DONE
+};
+
+struct MovePicker
+{
+    int       stage;
+    int       depth;
+    int       index;            // next unpicked move in 'ml'
+    int       numLegal;         // number of legal moves handed out so far
+    int       numSpecial;       // number of moves in 'special'
+    Move      special [3];      // best path, xpos and killer moves already tried
+    Move      bestPathMove;
+    Move      xposMove;
+    Move      killerMove;
+    MoveList  ml;
+
+    // Swap the best remaining move in 'ml' into ml.m[index].
+    // Selecting one move at a time means a node that cuts off
+    // early never sorts the tail of the list.
+    template <class Side> void Select();
+
+    bool AlreadyTried ( Move move ) const
+    {
+        for ( int i=0; i < numSpecial; ++i )
+            if ( special[i] == move )
+                return true;
+        return false;
+    }
+};
+
+
 
 //------------------------------------------------------------------
 
@@ -563,6 +633,10 @@ public:
         UINT32  vis [NODES_ARRAY_SIZE],
         UINT32  gen [NODES_ARRAY_SIZE] );
 
+    // Called after ReportComputerStats with everything the search counted.
+    // See FormatSearchStatsJson.
+    virtual void ReportSearchStats ( const SearchStats & )  {}
+
     //--------------------------------------------------------------//
     //  The following function should display the given ChessBoard  //
     //  to the user.                                                //
@@ -606,6 +680,16 @@ public:
     // The following function is called whenever a level is exited.
     virtual void DebugExit ( int /*depth*/, ChessBoard &, SCORE ) {}
 
+    // The search makes the DebugPly/DebugExit calls above only if this
+    // returns true when the search starts.  Builds that define
+    // SEARCH_DEBUG_HOOKS as 0 never make them at all.
+    virtual bool WantsDebugPly() const { return false; }
+
+    // Called by the search a few times a second (not at every node), so
+    // the user interface can poll for input or report progress.  It may
+    // call ComputerChessPlayer::AbortSearch().
+    virtual void SearchCheckpoint() {}
+
     virtual void SetAdHocText ( int /*index*/, const char *, ... ) {}
     virtual bool allowMateAnnounce ( bool )
     {
@@ -640,6 +724,25 @@ public:
 };
 
 
+// A user interface that shows nothing and never asks for anything.
+// Searches run where no one is watching (helper threads, benchmarks,
+// self-tests) still need a ChessUI for their ComputerChessPlayer.
+
+class ChessUI_Silent: public ChessUI
+{
+public:
+    ChessPlayer *CreatePlayer ( ChessSide )  { return 0; }
+    void ReportEndOfGame ( ChessSide )  {}
+    void Resign ( ChessSide, QuitGameReason )  {}
+    bool ReadMove ( ChessBoard &, int &, int &, SQUARE & )  { return false; }
+    SQUARE PromotePawn ( int, int, ChessSide )  { return Q_INDEX; }
+    void DisplayMove ( ChessBoard &, Move )  {}
+    void RecordMove ( ChessBoard &, Move, INT32 )  {}
+    void DrawBoard ( const ChessBoard & )  {}
+    void NotifyUser ( const char * )  {}
+};
+
+
 
 //------------------------------------------------------------------
 
@@ -709,42 +812,104 @@ private:
 
 
 // Jan 1999: We're gonna try the transposition table thing again!
+// Entries are grouped into 64-byte buckets of four 16-byte entries,
+// shared by both sides because the board hash includes the side to move.
 
-#define  XF_STALE     0x01     // entry is (slightly) out of date
+#define  XF_UPPER     0x02     // score is an upper bound: search failed low
+#define  XF_LOWER     0x04     // score is a lower bound: search failed high
+#define  XF_EXACT     (XF_UPPER | XF_LOWER)     // score is exact
+#define  XF_BOUND     XF_EXACT                  // mask for bound type; 0 means unused entry
 
 struct TranspositionEntry
 {
-    UINT32  boardHash;       // hash code of board producing this node
+    UINT32  keyCheck;        // high 32 bits of board hash (low bits choose the bucket), XOR dataCheck()
+    Move    bestReply;       // source, dest, and score all valid
     BYTE    searchedDepth;   // how deep full-width search is beneath this node
     BYTE    future;          // how deep in the tree we found the node
     BYTE    flags;           // see XF_... above
-    Move    bestReply;       // source, dest, and score all valid
-    SCORE   alpha;
-    SCORE   beta;
+    BYTE    generation;      // TranspositionTable::generation when stored; older means stale
+    BYTE    reserved[4];     // pads entry to 16 bytes
 
 // Utility functions...
 
-    bool scoreIsInsideWindow() const
+    // Folds the fields after keyCheck into 32 bits.  Storing the key check
+    // XORed with this means that an entry read while another thread is
+    // writing it, mixing fields of two stores, does not match either position.
+    UINT32 dataCheck() const
+    {
+        const UINT32 moveBits = bestReply.source | (UINT32(bestReply.dest) << 8) | (UINT32(UINT16(bestReply.score)) << 16);
+        const UINT32 infoBits = searchedDepth | (UINT32(future) << 8) | (UINT32(flags) << 16) | (UINT32(generation) << 24);
+        return moveBits ^ (infoBits * 0x9E3779B1u);
+    }
+
+    bool matches ( UINT32 check ) const
+    {
+        return (keyCheck ^ dataCheck()) == check;
+    }
+
+    bool isUsed() const
     {
-        return alpha <= bestReply.score && bestReply.score <= beta;
+        return (flags & XF_BOUND) != 0;
     }
 
-    bool compatibleWindow ( SCORE callerAlpha, SCORE callerBeta) const
+    bool scoreIsExact() const
     {
-        // caller's window must be inside entry's window to be compatible
-        return alpha <= callerAlpha && callerBeta <= beta;
+        return (flags & XF_BOUND) == XF_EXACT;
+    }
+
+    bool scoreIsUsable ( SCORE callerAlpha, SCORE callerBeta ) const
+    {
+        // An exact score can always be used.  A bound can be used
+        // only when it is enough to cause the same cutoff the search would.
+        switch ( flags & XF_BOUND )
+        {
+            case XF_EXACT:  return true;
+            case XF_LOWER:  return bestReply.score >= callerBeta;
+            case XF_UPPER:  return bestReply.score <= callerAlpha;
+        }
+        return false;
     }
 };
 
+
+#define  XPOS_BUCKET_SIZE   4       // entries per 64-byte bucket (one cache line)
+#define  MAX_XPOS_MEGABYTES   (1024 * 1024)     // upper limit for transposition table size (1 TB)
+
+struct TranspositionBucket
+{
+    TranspositionEntry  entry [XPOS_BUCKET_SIZE];
+};
+
+
+// Counts kept by a TranspositionTable since it was last reset.
+// Lazy SMP threads update them without locking, so they are approximate.
+
+struct TranspositionStats
+{
+    UINT32  tries;      // lookups
+    UINT32  hits;       // lookups that found the position
+    UINT32  stores;     // attempts to store a position
+    UINT32  fresh;      // stored in an unused slot, or over a less useful entry for the same position
+    UINT32  stales;     // stored over an entry left by an earlier search
+    UINT32  stomps;     // stored over a shallower entry for another position
+    UINT32  failures;   // not stored: the bucket had nothing worse to replace
+    UINT32  inferior;   // not stored: the table already had a better entry for the position
+};
+
+
 class TranspositionTable
 {
 public:
+    // The table uses the largest power of two number of buckets that fits
+    // in the given size.  A size less than 1 selects the original 1MB table.
     TranspositionTable (int memorySizeInMegabytes);
     ~TranspositionTable();
 
     void reset();
     void startNewSearch();
 
+    // 'alpha' and 'beta' are the window the position was searched with.
+    // They determine whether bestReply.score is exact or a bound.
     void rememberWhiteMove (
         ChessBoard &board,
         int level,
@@ -761,10 +926,15 @@ public:
         SCORE alpha,
         SCORE beta );
 
-    const TranspositionEntry *locateWhiteMove ( ChessBoard &board );
-    const TranspositionEntry *locateBlackMove ( ChessBoard &board );
+    const TranspositionEntry *locateMove ( ChessBoard &board );
+
+    // The following version copies the entry into 'copy' before returning a pointer to it.
+    // The search uses it because Lazy SMP helper threads may be overwriting
+    // the same table slot at the same time.
+    const TranspositionEntry *locateMove ( ChessBoard &board, TranspositionEntry &copy );
 
     void debugDump ( const char *filename ) const;
+    void queryStats ( TranspositionStats & ) const;
 
 protected:
     void init ();
@@ -776,22 +946,34 @@ protected:
         Move bestReply,
         SCORE alpha,
         SCORE beta,
-        TranspositionEntry *table,
         bool whiteToMove );
 
-    const TranspositionEntry *locateMove (
-        ChessBoard &board,
-        TranspositionEntry *table );
+    TranspositionBucket &findBucket ( UINT64 hashCode ) const
+    {
+        return buckets [hashCode & bucketMask];
+    }
 
-    bool findEntry (
-        UINT32 hashCode,
-        TranspositionEntry *table,
-        unsigned &index );
+    static UINT32 keyCheck ( UINT64 hashCode )
+    {
+        return UINT32 ( hashCode >> 32 );
+    }
+
+    int age ( const TranspositionEntry &x ) const
+    {
+        // How many searches ago the entry was stored.  Wraps after 256,
+        // which only makes a very old entry look a little younger.
+        return BYTE ( generation - x.generation );
+    }
 
 private:
-    unsigned numTableEntries;
-    TranspositionEntry *whiteTable;
-    TranspositionEntry *blackTable;
+    size_t numBuckets;      // always a power of 2
+    size_t bucketMask;      // numBuckets - 1
+    TranspositionBucket *buckets;   // aligned to a cache line inside 'memory'
+    char *memory;
+    size_t memorySize;      // bytes allocated at 'memory'
+    bool memoryMapped;      // was 'memory' allocated by AllocateTableMemory?
+    BYTE generation;        // incremented by startNewSearch
+
     unsigned numTries;   // total number of attempts to find old entry
     unsigned numHits;    // number of times table entry was retrieved
 
@@ -825,7 +1007,7 @@ struct ChessGeneDefinition
 // (excluding terminator element) or a ChessFatal() will occur
 // at run time.
 
-#define  NUM_CHESS_GENES     82
+#define  NUM_CHESS_GENES     87
 
 
 // A ChessGene is a vector of heuristic constants that affects
@@ -862,40 +1044,313 @@ enum CCP_SEARCH_TYPE    // defines what kind of search done by ComputerChessPlay
     CCPST_UNDEFINED,        // search type is not defined
     CCPST_TIMED_SEARCH,     // search will last a specified maximum time
     CCPST_DEPTH_SEARCH,     // search will iteratively examine to specified max depth
-    CCPST_MAXEVAL_SEARCH    // search will continue until certain number of nodes evaluated
+    CCPST_MAXEVAL_SEARCH,   // search will continue until certain number of nodes evaluated
+    CCPST_NODE_SEARCH       // search will continue until certain number of nodes visited
 };
 
 
+#define MAX_SEARCH_THREADS   256     // upper limit for ComputerChessPlayer::SetThreadCount
+#define MAX_MULTI_PV          16     // upper limit for ComputerChessPlayer::SetMultiPV
+
+
+//------------------------------------------------------------------------
+// SearchTimeManager decides when a timed search has to stop.  It measures
+// time in microseconds on a monotonic clock, because ChessTime() is too
+// coarse for fast games and can jump when the system time is adjusted.
+//
+//   - The soft deadline is the time limit itself.  The search stops there
+//     unless the score is falling and search extension is enabled.
+//   - The hard deadline is never passed.
+//   - A new iteration is not started if, judging by how long the last
+//     one took, it could not finish within the iteration budget.  The
+//     budget is the whole soft limit while the root's best move or score
+//     is still changing, and shrinks each time an iteration confirms them.
+
+class SearchTimeManager
+{
+public:
+    SearchTimeManager(): softLimit(0), hardLimit(0), iterationStart(0), lastIteration(0)
+    {
+        startTime = Clock::now();
+        forgetIterations();
+    }
+
+    void start ( INT32 centiseconds, bool allowExtension )
+    {
+        startTime = Clock::now();
+        softLimit = INT64(centiseconds) * 10000;
+        hardLimit = allowExtension ? (2 * softLimit) : softLimit;
+        iterationStart = lastIteration = 0;
+        forgetIterations();
+    }
+
+    INT64 elapsedMicroseconds() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds> ( Clock::now() - startTime ).count();
+    }
+
+    INT64 softDeadline() const { return softLimit; }
+    INT64 hardDeadline() const { return hardLimit; }
+
+    void startIteration() { iterationStart = elapsedMicroseconds(); }
+
+    // Call after each completed iteration with the best move it found at the root.
+    void finishIteration ( Move best )
+    {
+        lastIteration = elapsedMicroseconds() - iterationStart;
+
+        int swing = best.score - lastBest.score;
+        if ( swing < 0 )
+            swing = -swing;
+
+        if ( best == lastBest && swing <= STABLE_SCORE_SWING )
+            ++stableIterations;
+        else
+            stableIterations = 0;
+
+        lastBest = best;
+    }
+
+    bool canStartIteration() const
+    {
+        // With this much pruning, each iteration takes roughly twice as
+        // long as the one before it.
+        return elapsedMicroseconds() + 2*lastIteration < iterationBudget();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum
+    {
+        STABLE_SCORE_SWING = 30     // the most the root score may move in an iteration that confirms it
+    };
+
+    void forgetIterations()
+    {
+        lastBest.source = lastBest.dest = 0;    // matches no legal move
+        lastBest.score = 0;
+        stableIterations = 0;
+    }
+
+    INT64 iterationBudget() const
+    {
+        // Percentage of the soft limit, by how many iterations in a row
+        // have kept the same best move.
+        static const int percent[] = { 100, 85, 70, 55 };
+        const int n = (stableIterations < 3) ? stableIterations : 3;
+        return softLimit * percent[n] / 100;
+    }
+
+    Clock::time_point  startTime;
+    INT64   softLimit;          // microseconds after startTime
+    INT64   hardLimit;
+    INT64   iterationStart;
+    INT64   lastIteration;      // how long the most recently completed iteration took
+    Move    lastBest;           // best move (and score) of that iteration
+    int     stableIterations;   // iterations in a row that have confirmed lastBest
+};
+
+
+//------------------------------------------------------------------------
+// SearchStopToken lets any thread stop a search, for example when a
+// server's client disconnects.  Give it to a player with
+// ComputerChessPlayer::SetStopToken().  The search stops within a node or
+// two of requestStop() and returns the best move it had found by then.
+//
+// Callbacks registered with addCallback() run once, on the thread that
+// calls requestStop(), or right away if the token is already stopped.
+// They run with the token locked, so they must not call back into it.
+// removeCallback() waits for any callback that is still running.
+
+class SearchStopToken
+{
+public:
+    typedef void (*Callback) ( void *context );
+
+    SearchStopToken(): stopped(false) {}
+
+    void requestStop();
+    bool stopRequested() const { return stopped; }
+    void reset();       // call only while no search is using the token
+
+    void addCallback ( Callback, void *context );
+    void removeCallback ( Callback, void *context );
+
+private:
+    SearchStopToken ( const SearchStopToken & );                // not implemented
+    SearchStopToken & operator= ( const SearchStopToken & );    // not implemented
+
+    struct Registration
+    {
+        Callback    callback;
+        void       *context;
+    };
+
+    std::atomic<bool>          stopped;
+    std::mutex                 mutex;
+    std::vector<Registration>  registrations;
+};
+
+
+// A ChessEngineContext owns the state that ComputerChessPlayer objects
+// used to share through global variables: the transposition table,
+// the opening book's scratch board, and the record of which player
+// is searching right now.  A program that runs several independent
+// engines at the same time (e.g. one game per thread) gives each one
+// its own context.  Players created without a context share
+// ChessEngineContext::Default().  Only one search at a time may use
+// a given context, not counting that search's own Lazy SMP helpers.
+
+class ChessEngineContext
+{
+public:
+    ChessEngineContext();
+    ~ChessEngineContext();
+
+    static ChessEngineContext &Default();
+
+    // Creates a 1MB transposition table the first time it is called,
+    // unless SetTranspositionTableSize has already created one.
+    TranspositionTable &GetTranspositionTable();
+    TranspositionTable *QueryTranspositionTable() const { return xposTable; }  // NULL if none yet
+
+    // Replaces the transposition table.  0 retains original Chenard behavior.
+    void SetTranspositionTableSize ( int memorySizeInMegabytes );
+
+    // Empties the transposition table, for a new game.  Searches within
+    // a game do not need this: they age out each other's entries.
+    void ClearTranspositionTable();
+
+    ChessBoard &GetOpeningBookBoard() { return *openingBookBoard; }
+
+    // Thread count given to each ComputerChessPlayer constructed with this context.
+    void SetDefaultThreadCount ( int _numThreads );
+    int  QueryDefaultThreadCount() const { return defaultThreadCount; }
+
+    // The following let another thread (e.g. a GUI status display)
+    // find out which player is searching and when it started.
+    void BeginSearch ( ComputerChessPlayer *player, INT32 startTime );
+    void EndSearch() { searchingPlayer = 0; }
+    ComputerChessPlayer *QuerySearchingPlayer() const { return searchingPlayer; }
+    INT32 QueryTimeSearchStarted() const { return timeSearchStarted; }
+
+private:
+    ChessEngineContext ( const ChessEngineContext & );              // not implemented
+    ChessEngineContext & operator= ( const ChessEngineContext & );  // not implemented
+
+    TranspositionTable  *xposTable;
+    ChessBoard          *openingBookBoard;  // scratch board for OB_FindContinuation
+    int                  defaultThreadCount;
+
+    std::atomic<ComputerChessPlayer *>  searchingPlayer;
+    std::atomic<INT32>                  timeSearchStarted;
+};
+
+
+//------------------------------------------------------------------------
+// SearchStats records the work done by one call to
+// ComputerChessPlayer::GetMove, so the search can be tuned from data.
+// FormatSearchStatsJson writes it as a single line of JSON.
+
+#define  MAX_SEARCH_ITERATIONS   (NODES_ARRAY_SIZE/4)
+
+struct SearchIterationStats
+{
+    int     depth;          // full-width plies
+    bool    completed;      // false if the search stopped partway through it
+    UINT32  visited;        // nodes visited by the calling thread since the search started
+    INT64   microseconds;   // time since the search started
+};
+
+struct SearchStats
+{
+    int     numThreads;
+    INT64   microseconds;
+    UINT32  visited;                // all threads
+    UINT32  evaluated;              // all threads
+    UINT32  generated;              // all threads
+    UINT32  quiescenceVisited;      // the part of 'visited' in the quiescence search
+    UINT32  cutoffs;                // full-width nodes where a move reached the opponent's bound
+    UINT32  firstMoveCutoffs;       // ... and it was the first move searched
+    UINT32  visnodes [NODES_ARRAY_SIZE];    // by ply, calling thread only
+    UINT32  gennodes [NODES_ARRAY_SIZE];
+    int     numIterations;          // 0 if the move was not searched for (opening book, etc.)
+    SearchIterationStats  iteration [MAX_SEARCH_ITERATIONS];
+    TranspositionStats    xpos;     // what this search added to the table's counts
+};
+
+std::string FormatSearchStatsJson ( const SearchStats & );
+
+
 class ComputerChessPlayer: public ChessPlayer
 {
 public:
-    ComputerChessPlayer ( ChessUI & );
+    ComputerChessPlayer ( ChessUI &ui ): ComputerChessPlayer ( ui, ChessEngineContext::Default(), false ) {}
+    ComputerChessPlayer ( ChessUI &ui, ChessEngineContext &_engine ): ComputerChessPlayer ( ui, _engine, false ) {}
     virtual ~ComputerChessPlayer();
 
-    static void LazyInitXposTable();
+    ChessEngineContext &QueryEngineContext() const { return engine; }
 
     bool GetMove ( ChessBoard &, Move &, INT32 &timeSpent );
 
     void SetSearchDepth ( int NewSearchDepth );       // cancels time limit
     void SetTimeLimit ( INT32 hundredthsOfSeconds );  // cancels search depth
     void SetMaxNodesEvaluated ( UINT32 _maxNodesEvaluated );  // cancels timed search/depth search
+    void SetMaxNodesVisited ( UINT32 _maxNodesVisited );      // cancels timed search/depth search
+
+    // A search limited by SetMaxNodesVisited is reproducible: it runs on
+    // one thread, without randomizing the move order, and never reads the
+    // clock to decide when to stop.  So the same position, searched after
+    // the same history, always gives the same move, score, and node count.
+    UINT32 QueryMaxNodesVisited() const { return maxNodesVisited; }
+
+    // Caps the speed of every following search at about this many visited
+    // nodes per second, by sleeping when the search gets ahead of it.  The
+    // limit is shared among the search threads.  0 = no limit (the default).
+    void SetNodesPerSecondLimit ( UINT32 _npsLimit ) { npsLimit = _npsLimit; }
+    UINT32 QueryNodesPerSecondLimit() const { return npsLimit; }
 
     void SetMinSearchDepth (int _minSearchDepth);
 
     INT32 QueryTimeLimit() const { return timeLimit; }
 
+    // Lazy SMP: the total number of threads (including the calling thread)
+    // that search each position.  Helper threads run the same iterative
+    // deepening against the shared transposition table, but only the
+    // calling thread's result is reported.
+    void SetThreadCount ( int _numThreads );
+    int  QueryThreadCount() const { return numThreads; }
+
+    // Multi-PV analysis: the number of root moves whose scores are
+    // searched exactly.  When it is more than 1, each completed iteration
+    // reports that many lines through ChessUI::DisplayBestPath, best first.
+    // The default of 1 is what we want for playing games.
+    void SetMultiPV ( int _multiPV );
+    int  QueryMultiPV() const { return multiPV; }
+
+    // Copies up to 'maxLines' lines from the last completed iteration of
+    // the most recent GetMove, best first, and returns how many it copied.
+    // Returns 0 if that move did not come from a search (opening book,
+    // training file, endgame database, or a single legal move).
+    int  GetPrincipalVariations ( BestPath lines[], int maxLines ) const;
+
     // The following method is used to abort a search in progress
     // in multi-threaded environments.  There is no proper use of this
     // function in a single-threaded program (at least none that I can
     // think of!)
-    void AbortSearch ();
+    void AbortSearch ();        // may be called from any thread
     bool IsSearchAborted() const { return searchAborted; }
 
+    // Subsequent searches also stop when 'token' is stopped.  NULL for none.
+    // The token must outlive any search that uses it.
+    void SetStopToken ( SearchStopToken *token ) { stopToken = token; }
+
     virtual void InformResignation();
 
     bool IsSearchRandomized() const
     {
-        return searchBias != 0;
+        return searchBias != 0 && searchType != CCPST_NODE_SEARCH;
     }
 
     void SetSearchBias  ( SCORE NewSearchBias );    //0=deterministic search, 1=randomized search
@@ -909,7 +1364,7 @@ public:
         trainingEnabled = newTrainingEnable;
     }
 
-    void ResetHistoryBuffers();
+    void ResetHistoryBuffers();     // also clears the transposition table
 
     bool queryResignFlag() const { return allowResignation; }
     void setResignFlag ( bool x ) { allowResignation = x; }
@@ -949,7 +1404,13 @@ public:
 
     const BestPath& getBestPath() const { return currentBestPath; }
 
+    // What the most recent GetMove counted.  Helper threads are included
+    // once the search has finished.
+    const SearchStats &QuerySearchStats() const { return searchStats; }
+
 protected:
+    ComputerChessPlayer ( ChessUI &, ChessEngineContext &, bool _helperInstance );
+
     typedef SCORE (ComputerChessPlayer::*EvalFunction)
         ( ChessBoard &,
           int depth,
@@ -967,40 +1428,31 @@ protected:
     int WhiteKingFreedom ( ChessBoard & );
     int BlackKingFreedom ( ChessBoard & );
 
-    SCORE WhiteSearchRoot ( ChessBoard &, Move & );
-    SCORE BlackSearchRoot ( ChessBoard &, Move & );
+    // The root, interior and quiescence searches are written once and
+    // specialized for each side by the WhiteSide/BlackSide traits in side.h.
 
-    SCORE WhiteSearch (
-        ChessBoard &,
-        int depth,
-        SCORE alpha,
-        SCORE beta,
-        bool bestPathFlag );
+    template <class Side>
+    SCORE SearchRoot ( ChessBoard &, Move & );
 
-    SCORE BlackSearch (
-        ChessBoard &,
-        int depth,
-        SCORE alpha,
-        SCORE beta,
-        bool bestPathFlag );
+    template <class Side>
+    SCORE SearchRoot ( ChessBoard &, Move &, SCORE alpha, SCORE beta );
 
-    SCORE WhiteQSearch (
+    template <class Side>
+    SCORE Search (
         ChessBoard &,
         int depth,
         SCORE alpha,
         SCORE beta,
         bool bestPathFlag );
 
-    SCORE BlackQSearch (
+    template <class Side>
+    SCORE QSearch (
         ChessBoard &,
         int depth,
         SCORE alpha,
         SCORE beta,
         bool bestPathFlag );
 
-    void GenWhiteCapturesAndChecks ( ChessBoard &board, MoveList &ml );
-    void GenBlackCapturesAndChecks ( ChessBoard &board, MoveList &ml );
-
     SCORE  CommonMidgameEval ( ChessBoard &board );
     SCORE  WhiteMidgameEval ( ChessBoard &board, int depth, SCORE alpha, SCORE beta );
     SCORE  BlackMidgameEval ( ChessBoard &board, int depth, SCORE alpha, SCORE beta );
@@ -1029,17 +1481,32 @@ protected:
         int depth,
         bool bestPathFlag );
 
+    void  StartMovePicker ( MovePicker &, int depth, bool bestPathFlag );
+    template <class Side> bool  NextMove ( ChessBoard &, MovePicker &, Move & );
+    template <class Side> bool  MoveIsLegal ( ChessBoard &, Move & );
+    template <class Side> void  PickerOrdering ( const ChessBoard &, Move & );
+
     bool CheckTimeLimit();
+    INT64 ThrottleSearch ( INT64 now );
+    static void AbortSearchCallback ( void *context );     // for SearchStopToken
+    void ReportMultiPV ( const ChessBoard & );
+    void RecordIteration();
 
     void ChooseEvalFunctions ( ChessBoard &board );
+    void InitLateMoveReductions();
+    int  LateMoveReduction ( int remainingDepth, int moveNumber ) const;
+
+    void StartHelperThreads ( const ChessBoard &board, int startLevel );
+    void StopHelperThreads ();
+    void HelperSearch ( ChessBoard &board, int startLevel );
 
     void FindPrevBestPath ( Move );
     void FoundBestMove ( Move, int depth );
     void HitBottom ( int depth )   { nextBestPath[depth].depth = depth - 1; }
     BestPath *SaveTLMBestPath ( Move );
 
-    SCORE WhiteRookBonus ( const SQUARE *b, int ofs, int bk_offset );
-    SCORE BlackRookBonus ( const SQUARE *b, int ofs, int wk_offset );
+    template <class Side>
+    SCORE RookBonus ( const SQUARE *b, int ofs, int enemyKingOffset );
 
     SCORE WhiteBishopBonus ( const SQUARE *b, int ofs, int wk_offset );
     SCORE BlackBishopBonus ( const SQUARE *b, int ofs, int bk_offset );
@@ -1068,6 +1535,11 @@ private:
     UINT32     generated;
     UINT32     visnodes [NODES_ARRAY_SIZE];
     UINT32     gennodes [NODES_ARRAY_SIZE];
+    UINT32     quiescenceVisited;
+    UINT32     cutoffs;
+    UINT32     firstMoveCutoffs;
+    SearchStats         searchStats;
+    TranspositionStats  xposAtStart;    // the table's counts when the search started
     SCORE      searchBias;    // 0=deterministic search, 1=randomized search
 
     // The following members are used to assist in automatically extending the search...
@@ -1075,19 +1547,23 @@ private:
     bool       computerPlayingWhite;
     SCORE      expectedScorePrev;
     SCORE      expectedScoreNow;
-    INT32      revertTimeLimit;    // 0 means search was not extended
 
     CCP_SEARCH_TYPE  searchType;     // added 1999-Mar-09
 
     UINT32     maxNodesEvaluated;   // used when searchType==CCPST_MAXEVAL_SEARCH
+    UINT32     maxNodesVisited;     // used when searchType==CCPST_NODE_SEARCH
+    UINT32     npsLimit;            // 0 = search as fast as possible
+    UINT32     threadNpsLimit;      // this thread's share of npsLimit in the current search
 
-    bool       searchAborted;  // gets set when search is aborted
-    INT32      stopTime;       // interval marker to stop thinking at (0.01 sec)
+    std::atomic<bool> searchAborted;  // gets set when search is aborted (possibly by another thread)
     INT32      timeLimit;      // holds time limit from search to search
+    SearchTimeManager  timeManager;
 
-    INT32      timeCheckCounter;
-    INT32      timeCheckLimit;
-    INT32      prevTime;
+    INT32      timeCheckCounter;   // calls to CheckTimeLimit since the clock was last read
+    INT64      checkpointTime;     // when ChessUI::SearchCheckpoint was last called (microseconds)
+
+    bool       debugHooksEnabled;  // make ChessUI::DebugPly/DebugExit calls during this search?
+    SearchStopToken   *stopToken;  // optional external way to stop the search
 
     EvalFunction   whiteEval;   // eval used for White's turn nodes
     EvalFunction   blackEval;   // eval used for Black's turn nodes
@@ -1098,9 +1574,9 @@ private:
     BestPath *eachBestPath;                         // array of BestPath for each Top Level Move
     BestPath currentBestPath;                       // BestPath from prev search of current TLM
     BestPath *nextBestPath;                         // BestPath for next search
-    UINT32   expectedNextBoardHash;                 // hash value of board if opponent makes expected move
+    UINT64   expectedNextBoardHash;                 // hash value of board if opponent makes expected move
     int      prevCompletedLevel;                    // highest full-width level completed in previous search
-    UINT32   hashPath [MAX_BESTPATH_DEPTH+8];
+    UINT64   hashPath [MAX_BESTPATH_DEPTH+8];
 
     // The following variables sneak information to move ordering
 
@@ -1112,6 +1588,10 @@ private:
     SCORE *whiteHist;
     SCORE *blackHist;
 
+    // Late move reductions, indexed by remaining depth and the number of
+    // legal moves tried so far.  Rebuilt from the gene before each search.
+    unsigned char lmrTable [LMR_MAX_DEPTH] [LMR_MAX_MOVES];
+
     bool openingBookSearchEnabled;
     bool trainingEnabled;
     bool allowResignation;
@@ -1120,6 +1600,9 @@ private:
     SCORE resignThreshold;
 
     friend class ChessBoard;    // needed for move ordering
+    friend class MicroBenchmark;    // times the evaluator by itself
+    friend struct WhiteSide;    // see side.h
+    friend struct BlackSide;
     bool firstTimeChooseEval;
 
     // the KingPosTable... arrays are used only by EndgameEval1 functions.
@@ -1138,11 +1621,21 @@ private:
     bool blunderAlertInstance;  // is this a blunder alert thinker?
     bool immediateSingularMove; // when there is a single legal move, make it without analysis
 
-public:
-    // Since it uses so much memory, all ComputerChessPlayer
-    // objects will share a single TranspositionTable object.
-
-    static TranspositionTable *XposTable;
+    // Lazy SMP...
+    int  numThreads;            // total search threads, including this one
+    int  numHelpers;            // number of allocated entries in helpers[]
+    SearchHelper *helpers;      // helper players, each with its own board and thread
+    bool helperInstance;        // is this player searching on behalf of another?
+
+    // Multi-PV...
+    int  multiPV;               // number of root moves to score exactly
+    int  multiPVCount;          // number of valid entries in multiPVPath[]
+    BestPath multiPVPath [MAX_MULTI_PV];    // best lines from the last completed iteration
+
+    // Since it uses so much memory, all ComputerChessPlayer objects
+    // in the same engine context share a single TranspositionTable.
+    ChessEngineContext &engine;
+    TranspositionTable *xposTable;
 };
 
 
@@ -1180,7 +1673,7 @@ public:
     bool operator!= ( const PackedChessBoard &other ) const { return !(*this == other); }
 
 private:
-    UINT32  hash;
+    UINT64  hash;
     BYTE    square [64];
     BYTE    flags;
     Move    prevMove;
@@ -1199,7 +1692,7 @@ public:
     bool operator== ( const ChessBoard &other ) const;
 
     void   Init();        // resets the chess board to beginning-of-game
-    UINT32 Hash() const { return cachedHash; }
+    UINT64 Hash() const { return cachedHash; }     // Zobrist key of the complete position
 
     //********************************************************************
     //****
@@ -1252,11 +1745,32 @@ public:
     int  GenWhiteCaptures ( MoveList &, ComputerChessPlayer *player = 0 );
     int  GenBlackCaptures ( MoveList &, ComputerChessPlayer *player = 0 );
 
+    // Captures, promotions and moves which check the enemy king,
+    // for Side = WhiteSide or BlackSide (see side.h).
+    template <class Side>
+    int  GenCapturesAndChecks ( MoveList &, ComputerChessPlayer *player = 0 );
+
+    // The pseudo-legal generators skip the self-check test and move ordering.
+    // The caller must make each move and reject it if it leaves the king in check.
+    template <class Side>  int  GenPseudoMoves ( MoveList & );
+    template <class Side>  int  GenPseudoCaptures ( MoveList & );
+    template <class Side>  int  GenPseudoQuiets ( MoveList & );     // everything GenPseudoCaptures leaves out
+
+    // Could the piece on the move's source square make the move, ignoring self-check?
+    template <class Side>  bool MoveIsPseudoLegal ( Move );
+
+    // Does a quiet pseudo-legal move check the enemy king, either from its
+    // destination or by uncovering one of our sliders?  Castling is
+    // always answered true; only making it tells.
+    template <class Side>
+    bool MoveMayCheck ( Move ) const;
+
     int  NumWhiteMoves() const;
     int  NumBlackMoves() const;
 
-    bool  WhiteCanMove();
-    bool  BlackCanMove();
+    template <class Side>  bool CanMove();
+    bool  WhiteCanMove()   { return CanMove<WhiteSide>(); }
+    bool  BlackCanMove()   { return CanMove<BlackSide>(); }
     bool  CurrentPlayerCanMove()
     {
         return WhiteToMove() ? WhiteCanMove() : BlackCanMove();
@@ -1285,17 +1799,22 @@ public:
     void SaveSpecialMove ( Move );
     void MarkInitialPosition();
 
-    void   MakeWhiteMove (
+    template <class Side>
+    void   MakeMove (
         Move       &move,     // can have side-effects!
         UnmoveInfo &unmove,
         bool    look_for_self_check,
         bool    look_for_enemy_check );
 
-    void   MakeBlackMove (
-        Move       &move,     // can have side-effects!
-        UnmoveInfo &unmove,
-        bool    look_for_self_check,
-        bool    look_for_enemy_check );
+    void   MakeWhiteMove ( Move &move, UnmoveInfo &unmove, bool look_for_self_check, bool look_for_enemy_check )
+    {
+        MakeMove<WhiteSide> ( move, unmove, look_for_self_check, look_for_enemy_check );
+    }
+
+    void   MakeBlackMove ( Move &move, UnmoveInfo &unmove, bool look_for_self_check, bool look_for_enemy_check )
+    {
+        MakeMove<BlackSide> ( move, unmove, look_for_self_check, look_for_enemy_check );
+    }
 
     void MakeMove ( Move &move, UnmoveInfo &unmove )
     {
@@ -1305,8 +1824,11 @@ public:
             MakeBlackMove ( move, unmove, true, true );
     }
 
-    void   UnmakeWhiteMove ( Move move, UnmoveInfo &unmove );
-    void   UnmakeBlackMove ( Move move, UnmoveInfo &unmove );
+    template <class Side>
+    void   UnmakeMove ( Move move, UnmoveInfo &unmove );
+
+    void   UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )   { UnmakeMove<WhiteSide> ( move, unmove ); }
+    void   UnmakeBlackMove ( Move move, UnmoveInfo &unmove )   { UnmakeMove<BlackSide> ( move, unmove ); }
 
     void UnmakeMove ( Move move, UnmoveInfo &unmove )
     {
@@ -1316,11 +1838,25 @@ public:
             UnmakeWhiteMove ( move, unmove );
     }
 
+    // Passes the turn to the other side without moving anything.
+    // Only for use by the search (null-move pruning): the null move must
+    // not be made while the side to move is in check.  It is recorded in
+    // the game history (dest = SPECIAL_MOVE_NULL), which NumberOfRepetitions
+    // replays as a pass.
+    void   MakeNullMove ( UnmoveInfo &unmove );
+    void   UnmakeNullMove ( UnmoveInfo &unmove );
+
     bool ScanMove (const char *pgn, Move &move);
 
     bool  IsAttackedByWhite ( int offset ) const;
     bool  IsAttackedByBlack ( int offset ) const;
 
+    // Static exchange evaluation: net material (in RawPieceValues units)
+    // the mover can expect from a capture once all recaptures on the
+    // destination square are played out.  Negative for losing captures.
+    template <class Side>
+    SCORE CaptureSEE ( Move ) const;
+
     int    GetCurrentPlyNumber() const;
     Move   GetPastMove ( int plyNumber ) const;
 
@@ -1377,6 +1913,12 @@ protected:
     UINT16      wk_offset;       // location of white king in the board
     UINT16      bk_offset;       // location of black king in the board
 
+    // Bitboards kept in step with board[] (see bitboard.h):
+    // the squares of each kind of piece, indexed like inventory[],
+    // and of each side's pieces, indexed by BB_SIDE.
+    UINT64      pieceBits [PIECE_ARRAY_SIZE];
+    UINT64      sideBits [2];
+
     bool        white_to_move;    // Is it white's turn to move?
     INT16       inventory [PIECE_ARRAY_SIZE];   // how many of each piece
     Move        prev_move;        // Need for en passant
@@ -1388,7 +1930,7 @@ protected:
     INT16       lastCapOrPawn;   // ply number of last capture or pawn advance
 
     // The following are important for detecting draws by repetition
-    UINT32      cachedHash;
+    UINT64      cachedHash;
 
     // The following arrays store the number of times the given (hash%size)
     // value has been seen, as a way to detect repeated board positions.
@@ -1399,55 +1941,44 @@ protected:
 private:
     bool pgnCloseMatch (const char *pgn, Move move) const;
 
-    UINT32 CalcHash() const;  // calculates 32-bit hash code of board
-
-    void  GenMoves_WP ( MoveList &, int source, int ybase );
-    void  GenMoves_WN ( MoveList &, int source );
-    void  GenMoves_WB ( MoveList &, int source );
-    void  GenMoves_WR ( MoveList &, int source );
-    void  GenMoves_WQ ( MoveList &, int source );
-    void  GenMoves_WK ( MoveList &, int source );
-
-    void  GenMoves_BP ( MoveList &, int source, int ybase );
-    void  GenMoves_BN ( MoveList &, int source );
-    void  GenMoves_BB ( MoveList &, int source );
-    void  GenMoves_BR ( MoveList &, int source );
-    void  GenMoves_BQ ( MoveList &, int source );
-    void  GenMoves_BK ( MoveList &, int source );
-
-    void  GenCaps_WP ( MoveList &, int source, int ybase );
-    void  GenCaps_WN ( MoveList &, int source );
-    void  GenCaps_WB ( MoveList &, int source );
-    void  GenCaps_WR ( MoveList &, int source );
-    void  GenCaps_WQ ( MoveList &, int source );
-    void  GenCaps_WK ( MoveList &, int source );
-
-    void  GenCaps_BP ( MoveList &, int source, int ybase );
-    void  GenCaps_BN ( MoveList &, int source );
-    void  GenCaps_BB ( MoveList &, int source );
-    void  GenCaps_BR ( MoveList &, int source );
-    void  GenCaps_BQ ( MoveList &, int source );
-    void  GenCaps_BK ( MoveList &, int source );
-
-    bool  WP_CanMove ( int ofs, int ybase );
-    bool  WN_CanMove ( int ofs );
-    bool  WB_CanMove ( int ofs );
-    bool  WR_CanMove ( int ofs );
-    bool  WQ_CanMove ( int ofs );
-    bool  WK_CanMove ( int ofs );
-
-    bool  BP_CanMove ( int ofs, int ybase );
-    bool  BN_CanMove ( int ofs );
-    bool  BB_CanMove ( int ofs );
-    bool  BR_CanMove ( int ofs );
-    bool  BQ_CanMove ( int ofs );
-    bool  BK_CanMove ( int ofs );
-
-    void  RemoveIllegalWhite (
-        MoveList &ml,
-        ComputerChessPlayer *myPlayer = 0 );
-
-    void  RemoveIllegalBlack (
+    UINT64 CalcHash() const;  // calculates 64-bit Zobrist key of board from scratch
+    UINT64 StateKey() const;  // Zobrist key of side to move, castling rights and en passant
+    static void InitZobristKeys();
+    void UpdateBitboards();   // rebuilds pieceBits[] and sideBits[] from board[]
+
+    template <class Side>  void  GenMoves_P ( MoveList &, int source, int ybase );
+    template <class Side>  void  GenMoves_N ( MoveList &, int source );
+    template <class Side>  void  GenMoves_B ( MoveList &, int source );
+    template <class Side>  void  GenMoves_R ( MoveList &, int source );
+    template <class Side>  void  GenMoves_Q ( MoveList &, int source );
+    template <class Side>  void  GenMoves_K ( MoveList &, int source );
+    template <class Side>  void  GenCastling ( MoveList &, int source );
+
+    template <class Side>  void  GenQuiets_P ( MoveList &, int source, int ybase );
+    template <class Side>  void  GenQuiets_N ( MoveList &, int source );
+    template <class Side>  void  GenQuiets_B ( MoveList &, int source );
+    template <class Side>  void  GenQuiets_R ( MoveList &, int source );
+    template <class Side>  void  GenQuiets_Q ( MoveList &, int source );
+    template <class Side>  void  GenQuiets_K ( MoveList &, int source );
+    template <class Side>  void  GenQuietsFrom ( MoveList &, int source );
+    template <class Side>  void  GenQuietChecks ( MoveList & );
+
+    template <class Side>  void  GenCaps_P ( MoveList &, int source, int ybase );
+    template <class Side>  void  GenCaps_N ( MoveList &, int source );
+    template <class Side>  void  GenCaps_B ( MoveList &, int source );
+    template <class Side>  void  GenCaps_R ( MoveList &, int source );
+    template <class Side>  void  GenCaps_Q ( MoveList &, int source );
+    template <class Side>  void  GenCaps_K ( MoveList &, int source );
+
+    template <class Side>  bool  P_CanMove ( int ofs, int ybase );
+    template <class Side>  bool  N_CanMove ( int ofs );
+    template <class Side>  bool  B_CanMove ( int ofs );
+    template <class Side>  bool  R_CanMove ( int ofs );
+    template <class Side>  bool  Q_CanMove ( int ofs );
+    template <class Side>  bool  K_CanMove ( int ofs );
+
+    template <class Side>
+    void  RemoveIllegal (
         MoveList &ml,
         ComputerChessPlayer *myPlayer = 0 );
 
@@ -1456,6 +1987,8 @@ private:
     friend class ChessUI_dos_cga;
     friend class ChessUI_dos_vga;
     friend class PackedChessBoard;
+    friend struct WhiteSide;    // see side.h
+    friend struct BlackSide;
 
     friend void FormatChessMove (
         const ChessBoard &,
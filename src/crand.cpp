@@ -14,7 +14,11 @@
 #define MULTIPLIER      0x015a4e35L
 #define INCREMENT       1
 
-static  INT32    Seed = 1;
+// Each thread has its own generator state, so that engines searching
+// on different threads do not race each other for the seed.
+static  thread_local INT32    Seed = 1;
+static  thread_local bool     Seeded = false;
+static  std::atomic<INT32>    NumSeededThreads (0);
 
 
 static INT16 _ChessRandom ()
@@ -31,11 +35,11 @@ static INT16 _ChessRandom ()
 
 int ChessRandom ( int n )
 {
-    static int firstTime = 1;
-    if ( firstTime )
+    if ( !Seeded )
     {
-        firstTime = 0;
-        Seed = INT32 ( time(NULL) );
+        // Threads seeded in the same second must still get different sequences.
+        Seeded = true;
+        Seed = INT32 ( time(NULL) ) + MULTIPLIER * NumSeededThreads++;
     }
 
     if ( n <= 0 )
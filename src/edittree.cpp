@@ -372,7 +372,7 @@ void Edit_DrawBoard ( const ChessBoard &board )
         if ( y == 6 )
             printf ( "   ply  = %d", board.GetCurrentPlyNumber() );
         else if ( y == 5 )
-            printf ( "   hash = %08lx", (unsigned long)(board.Hash()) );
+            printf ( "   hash = %016llx", board.Hash() );
 
         printf ( "\n" );
     }
@@ -1019,7 +1019,7 @@ void CalculatePositionHashes (LearnBranch *table, int tablesize, ChessBoard &boa
     assert (node >= 0);
     assert (node < tablesize);
 
-    int myhash = board.Hash();
+    int myhash = int ( board.Hash() );     // the low 32 bits fit in the reserved slot
 
     do
     {
@@ -1030,7 +1030,7 @@ void CalculatePositionHashes (LearnBranch *table, int tablesize, ChessBoard &boa
             board.MakeMove (table[node].move, unmove);
             CalculatePositionHashes (table, tablesize, board, table[node].child);
             board.UnmakeMove (table[node].move, unmove);
-            int checkhash = board.Hash();
+            int checkhash = int ( board.Hash() );
             assert (checkhash == myhash);
         }
         node = table[node].sibling;
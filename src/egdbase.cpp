@@ -1968,6 +1968,9 @@ struct tDatabaseMemoryImage
     }
 };
 
+// Only the database generator uses this cache (CONSULT_MODE_MEMORY).
+// ComputerChessPlayer searches consult with CONSULT_MODE_SEEK and never touch it,
+// so any number of engines may probe the databases at the same time.
 static tDatabaseMemoryImage DatabaseMemoryImage[WorkSetSize];
 
 //-----------------------------------------------------------------------------------------------------
@@ -2053,10 +2056,10 @@ bool ConsultDatabase (int workIndex, ChessBoard &board, Move &move, ConsultMode
         bool loaded = false;
 
         // See if we have already loaded this database file.
-        // Note that we re-use in-memory data even if told to seek,
-        // to take advantage of anyone else who already loaded it in memory mode.
+        // Seek mode must leave the generator's memory images alone,
+        // because it is used by searches that may be running on other threads.
         tDatabaseMemoryImage& d = DatabaseMemoryImage[workIndex];
-        if (d.buffer != NULL)
+        if (mode == CONSULT_MODE_MEMORY && d.buffer != NULL)
         {
             entrySize = d.prefix.entrySize;
             memcpy(entryData, &d.buffer[ti * entrySize], entrySize);
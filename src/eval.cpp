@@ -7,6 +7,7 @@
 ==========================================================================*/
 
 #include "chess.h"
+#include "side.h"
 #include "profiler.h"
 
 #define SAFE_EVAL_PRUNE_MARGIN  (gene.v[4])
@@ -312,164 +313,34 @@ static bool AttackWhiteKingPos ( const SQUARE *inBoard )
 }
 
 
-SCORE ComputerChessPlayer::WhiteRookBonus ( const SQUARE *b, int ofs, int wk_offset )
-{
-    int z;
-    SCORE bonus = 0;
-
-    // See if we are on the seventh rank or the eighth rank...
-
-    if ( ofs >= OFFSET(2,8) )
-    {
-        if ( ofs <= OFFSET(9,8) )
-            bonus += ROOK_ON_7TH_RANK;
-        else
-            bonus += (ROOK_CAN_REACH_7TH_RANK + ROOK_OPEN_FILE);
-    }
-    else
-    {
-        // A file is open if none of our pawns is blocking it before 7th.
-        for ( z=ofs + NORTH; b[z] == EMPTY && z < OFFSET(2,8); z += NORTH );
-
-        bonus += (YPART(z) - 2) / 2;
-
-        if ( z < OFFSET(2,8) )
-        {
-            if ( !(b[z] & WP_MASK) )
-                bonus += ROOK_OPEN_FILE;
-        }
-        else if ( z > OFFSET(9,8) )
-            bonus += ROOK_CAN_REACH_7TH_RANK;
-
-        for ( z=ofs + SOUTH; b[z] == EMPTY; z += SOUTH );
-        if ( b[z] & (WR_MASK | WQ_MASK) )
-            bonus += ROOK_CONNECT_VERT;
-
-        for ( z=ofs + WEST; b[z] == EMPTY; z += WEST );
-        if ( b[z] & WR_MASK )
-            bonus += ROOK_CONNECT_HOR;
-    }
-
-    if ( (b[ofs+EAST] & (WHITE_MASK | OFFBOARD)) &&
-         (b[ofs+WEST] & (WHITE_MASK | OFFBOARD)) )
-    {
-        if ( (b[ofs+NORTH] & (WHITE_MASK | OFFBOARD)) &&
-             (b[ofs+SOUTH] & (WHITE_MASK | OFFBOARD)) )
-            bonus -= ROOK_IMMOBILE;
-        else
-            bonus -= ROOK_IMMOBILE_HORIZ;
-    }
-
-    if ( Distance ( ofs, wk_offset ) < 3 )
-        bonus += CTEK_ROOK;
-
-// NORTH -------------------------------------------------------------------
-
-    // Look north for pins caused by rook
-    for ( z=ofs + NORTH; b[z] == EMPTY; z += NORTH );
-    int holdz = z;
-    if ( b[z] & (BB_MASK | BN_MASK) )
-    {
-        for ( z += NORTH; b[z] == EMPTY; z += NORTH );
-        if ( b[z] & BQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & BK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Continue NORTH for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(WR_MASK | WQ_MASK)) == EMPTY; z += NORTH );
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
-
-// EAST ---------------------------------------------------------------------
-
-    // Look east for pins caused by rook
-    for ( z=ofs + EAST; b[z] == EMPTY; z += EAST );
-    holdz = z;
-    if ( b[z] & (BB_MASK | BN_MASK) )
-    {
-        for ( z += EAST; b[z] == EMPTY; z += EAST );
-        if ( b[z] & BQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & BK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Continue EAST for king position attack and protection
+// Is inBoard beside (or just in front of) the given side's king?
+template <class Side> bool AttackKingPos ( const SQUARE *inBoard );
 
-    for ( z = holdz; (b[z] & ~(WR_MASK | WQ_MASK)) == EMPTY; z += EAST );
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
-// WEST -------------------------------------------------------------------
-
-    // Look west for pins caused by rook
-    for ( z=ofs + WEST; b[z] == EMPTY; z += WEST );
-    holdz = z;
-    if ( b[z] & (BB_MASK | BN_MASK) )
-    {
-        for ( z += WEST; b[z] == EMPTY; z += WEST );
-        if ( b[z] & BQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & BK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Continue WEST for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(WR_MASK | WQ_MASK)) == EMPTY; z += WEST );
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
-// SOUTH -----------------------------------------------------------------------
-
-    // Look south for pins caused by rook
-    for ( z=ofs + SOUTH; b[z] == EMPTY; z += SOUTH );
-    holdz = z;
-    if ( b[z] & (BB_MASK | BN_MASK) )
-    {
-        for ( z += SOUTH; b[z] == EMPTY; z += SOUTH );
-        if ( b[z] & BQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & BK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Continue SOUTH for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(WR_MASK | WQ_MASK)) == EMPTY; z += SOUTH );
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
+template <> inline bool AttackKingPos<WhiteSide> ( const SQUARE *inBoard )
+{
+    return AttackWhiteKingPos ( inBoard );
+}
 
-    return bonus;
+template <> inline bool AttackKingPos<BlackSide> ( const SQUARE *inBoard )
+{
+    return AttackBlackKingPos ( inBoard );
 }
 
 
-SCORE ComputerChessPlayer::BlackRookBonus ( const SQUARE *b, int ofs, int wk_offset )
+template <class Side>
+SCORE ComputerChessPlayer::RookBonus ( const SQUARE *b, int ofs, int enemyKingOffset )
 {
-    SCORE bonus = 0;
+    typedef typename Side::Opponent Enemy;
+
+    const SQUARE friendlyRay = Side::RookMask | Side::QueenMask;
     int z;
+    SCORE bonus = 0;
 
     // See if we are on the seventh rank or the eighth rank...
 
-    if ( ofs <= OFFSET(9,3) )
+    if ( Side::Rank(ofs) >= 7 )
     {
-        if ( ofs >= OFFSET(2,3) )
+        if ( Side::Rank(ofs) == 7 )
             bonus += ROOK_ON_7TH_RANK;
         else
             bonus += (ROOK_CAN_REACH_7TH_RANK + ROOK_OPEN_FILE);
@@ -477,131 +348,66 @@ SCORE ComputerChessPlayer::BlackRookBonus ( const SQUARE *b, int ofs, int wk_off
     else
     {
         // A file is open if none of our pawns is blocking it before 7th.
-        for ( z=ofs + SOUTH; b[z] == EMPTY && z > OFFSET(9,3); z += SOUTH );
-        bonus += (9 - YPART(z)) / 2;
+        for ( z=ofs + Side::Forward; b[z] == EMPTY && Side::Rank(z) < 7; z += Side::Forward );
+
+        bonus += (Side::Rank(z) - 1) / 2;
 
-        if ( z > OFFSET(9,3) )
+        if ( Side::Rank(z) < 7 )
         {
-            if ( !(b[z] & BP_MASK) )
+            if ( !(b[z] & Side::PawnMask) )
                 bonus += ROOK_OPEN_FILE;
         }
-        else if ( z < OFFSET(3,3) )
-            bonus += ROOK_CAN_REACH_7TH_RANK;
 
-        for ( z=ofs + NORTH; b[z] == EMPTY; z += NORTH );
-        if ( b[z] & (BR_MASK | BQ_MASK) )
+        for ( z=ofs - Side::Forward; b[z] == EMPTY; z -= Side::Forward );
+        if ( b[z] & friendlyRay )
             bonus += ROOK_CONNECT_VERT;
 
         for ( z=ofs + WEST; b[z] == EMPTY; z += WEST );
-        if ( b[z] & BR_MASK )
+        if ( b[z] & Side::RookMask )
             bonus += ROOK_CONNECT_HOR;
     }
 
-    if ( (b[ofs+EAST] & (BLACK_MASK | OFFBOARD)) &&
-         (b[ofs+WEST] & (BLACK_MASK | OFFBOARD)) )
+    if ( (b[ofs+EAST] & (Side::Mask | OFFBOARD)) &&
+         (b[ofs+WEST] & (Side::Mask | OFFBOARD)) )
     {
-        if ( (b[ofs+NORTH] & (BLACK_MASK | OFFBOARD)) &&
-             (b[ofs+SOUTH] & (BLACK_MASK | OFFBOARD)) )
+        if ( (b[ofs+NORTH] & (Side::Mask | OFFBOARD)) &&
+             (b[ofs+SOUTH] & (Side::Mask | OFFBOARD)) )
             bonus -= ROOK_IMMOBILE;
         else
             bonus -= ROOK_IMMOBILE_HORIZ;
     }
 
-    if ( Distance ( ofs, wk_offset ) < 3 )
+    if ( Distance ( ofs, enemyKingOffset ) < 3 )
         bonus += CTEK_ROOK;
 
-// NORTH ---------------------------------------------------------------
+    // Look along each file and rank for pins caused by the rook,
+    // then continue through any friendly rooks and queens for
+    // king position attack and protection.
 
-    // Look north for pins caused by rook
-    for ( z=ofs + NORTH; b[z] == EMPTY; z += NORTH );
-    int holdz = z;
-    if ( b[z] & (WB_MASK | WN_MASK) )
+    static const int dirs[] = { NORTH, EAST, WEST, SOUTH };
+    for ( int d=0; d < 4; ++d )
     {
-        for ( z += NORTH; b[z] == EMPTY; z += NORTH );
-        if ( b[z] & WQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & WK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Look NORTH for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(BR_MASK | BQ_MASK)) == EMPTY; z += NORTH );
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
-// EAST ---------------------------------------------------------------
-
-    // Look east for pins caused by rook
-    for ( z=ofs + EAST; b[z] == EMPTY; z += EAST );
-    holdz = z;
-    if ( b[z] & (WB_MASK | WN_MASK) )
-    {
-        for ( z += EAST; b[z] == EMPTY; z += EAST );
-        if ( b[z] & WQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & WK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Continue EAST for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(BR_MASK | BQ_MASK)) == EMPTY; z += EAST );
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
-// WEST ----------------------------------------------------------------
+        const int dir = dirs[d];
 
-    // Look west for pins caused by rook
-    for ( z=ofs + WEST; b[z] == EMPTY; z += WEST );
-    holdz = z;
-    if ( b[z] & (WB_MASK | WN_MASK) )
-    {
-        for ( z += WEST; b[z] == EMPTY; z += WEST );
-        if ( b[z] & WQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & WK_MASK )
-            bonus += ROOK_PIN_K;
-    }
-
-    // Look WEST for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(BR_MASK | BQ_MASK)) == EMPTY; z += WEST );
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
+        for ( z=ofs + dir; b[z] == EMPTY; z += dir );
+        const int holdz = z;
+        if ( b[z] & (Enemy::BishopMask | Enemy::KnightMask) )
+        {
+            for ( z += dir; b[z] == EMPTY; z += dir );
+            if ( b[z] & Enemy::QueenMask )
+                bonus += ROOK_PIN_Q;
+            else if ( b[z] & Enemy::KingMask )
+                bonus += ROOK_PIN_K;
+        }
 
-// SOUTH ---------------------------------------------------------------
+        for ( z = holdz; (b[z] & ~friendlyRay) == EMPTY; z += dir );
+        if ( AttackKingPos<Enemy>(b+z) )
+            bonus += ROOK_ATTACK_KPOS;
 
-    // Look south for pins caused by rook
-    for ( z=ofs + SOUTH; b[z] == EMPTY; z += SOUTH );
-    holdz = z;
-    if ( b[z] & (WB_MASK | WN_MASK) )
-    {
-        for ( z += SOUTH; b[z] == EMPTY; z += SOUTH );
-        if ( b[z] & WQ_MASK )
-            bonus += ROOK_PIN_Q;
-        else if ( b[z] & WK_MASK )
-            bonus += ROOK_PIN_K;
+        if ( AttackKingPos<Side>(b+z) )
+            bonus += ROOK_PROTECT_KPOS;
     }
 
-    // Look SOUTH for king position attack and protection
-
-    for ( z = holdz; (b[z] & ~(BR_MASK | BQ_MASK)) == EMPTY; z += SOUTH );
-    if ( AttackWhiteKingPos(b+z) )
-        bonus += ROOK_ATTACK_KPOS;
-
-    if ( AttackBlackKingPos(b+z) )
-        bonus += ROOK_PROTECT_KPOS;
-
     return bonus;
 }
 
@@ -1757,7 +1563,7 @@ SCORE ComputerChessPlayer::CommonMidgameEval ( ChessBoard &board )
                         score += WhiteBishopBonus ( b, ofs, bk );
                 }
                 else if ( piece & WR_MASK )
-                    score += WhiteRookBonus ( b, ofs, bk );
+                    score += RookBonus<WhiteSide> ( b, ofs, bk );
                 else if ( piece & WQ_MASK )
                     score += WhiteQueenBonus ( b, ofs, bk );
             }
@@ -1773,7 +1579,7 @@ SCORE ComputerChessPlayer::CommonMidgameEval ( ChessBoard &board )
                         score -= BlackBishopBonus ( b, ofs, wk );
                 }
                 else if ( piece & BR_MASK )
-                    score -= BlackRookBonus ( b, ofs, wk );
+                    score -= RookBonus<BlackSide> ( b, ofs, wk );
                 else if ( piece & BQ_MASK )
                     score -= BlackQueenBonus ( b, ofs, wk );
             }
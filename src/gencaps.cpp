@@ -9,10 +9,28 @@
 
 #include "chess.h"
 #include "profiler.h"
+#include "side.h"
 
 int ChessBoard::GenWhiteCaptures (
     MoveList &ml,
     ComputerChessPlayer *player )
+{
+    GenPseudoCaptures<WhiteSide> ( ml );
+    RemoveIllegal<WhiteSide> ( ml, player );
+    return ml.num;
+}
+
+
+int ChessBoard::GenBlackCaptures ( MoveList &ml, ComputerChessPlayer *player )
+{
+    GenPseudoCaptures<BlackSide> ( ml );
+    RemoveIllegal<BlackSide> ( ml, player );
+    return ml.num;
+}
+
+
+template <class Side>
+int ChessBoard::GenPseudoCaptures ( MoveList &ml )
 {
     PROFILER_ENTER(PX_GENCAPS)
     int x, ybase, ofs;
@@ -26,72 +44,72 @@ int ChessBoard::GenWhiteCaptures (
         {
             piece = board [ofs = ybase + x];
 
-            if ( piece & WHITE_MASK )
+            if ( piece & Side::Mask )
             {
                 switch ( UPIECE_INDEX(piece) )
                 {
                 case P_INDEX:
-                    GenCaps_WP ( ml, ofs, ybase );
+                    GenCaps_P<Side> ( ml, ofs, ybase );
                     break;
 
                 case N_INDEX:
-                    GenCaps_WN ( ml, ofs );
+                    GenCaps_N<Side> ( ml, ofs );
                     break;
 
                 case B_INDEX:
-                    GenCaps_WB ( ml, ofs );
+                    GenCaps_B<Side> ( ml, ofs );
                     break;
 
                 case R_INDEX:
-                    GenCaps_WR ( ml, ofs );
+                    GenCaps_R<Side> ( ml, ofs );
                     break;
 
                 case Q_INDEX:
-                    GenCaps_WQ ( ml, ofs );
+                    GenCaps_Q<Side> ( ml, ofs );
                     break;
 
                 case K_INDEX:
-                    GenCaps_WK ( ml, ofs );
+                    GenCaps_K<Side> ( ml, ofs );
                     break;
 
                 default:
-                    ChessFatal ( "Invalid piece in ChessBoard::GenWhiteCaptures" );
+                    ChessFatal ( "Invalid piece in ChessBoard::GenPseudoCaptures" );
                     break;
                 }
             }
         }
     }
 
-    RemoveIllegalWhite ( ml, player );
     PROFILER_EXIT();
     return ml.num;
 }
 
 
-void ChessBoard::GenCaps_WP ( MoveList &ml, int ofs, int ybase )
+template <class Side>
+void ChessBoard::GenCaps_P ( MoveList &ml, int ofs, int ybase )
 {
-    if ( ybase == OFFSET(2,6) )
+    if ( ybase == OFFSET(2, Side::EnPassantRank) )   // check for en passant and normal captures
     {
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHEAST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(1,2) &&
-                  prev_move.dest == ofs + OFFSET(1,0) &&
-                  (board [prev_move.dest] & BP_MASK) )
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnEast );
+        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + EAST + 2*Side::Forward &&
+                  prev_move.dest == ofs + EAST &&
+                  (board [prev_move.dest] & Side::Opponent::PawnMask) )
             ml.AddMove ( ofs, SPECIAL_MOVE_EP_EAST );
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHWEST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(-1,2) &&
-                  prev_move.dest == ofs + OFFSET(-1,0) &&
-                  (board [prev_move.dest] & BP_MASK) )
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnWest );
+        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + WEST + 2*Side::Forward &&
+                  prev_move.dest == ofs + WEST &&
+                  (board [prev_move.dest] & Side::Opponent::PawnMask) )
             ml.AddMove ( ofs, SPECIAL_MOVE_EP_WEST );
     }
-    else if ( ybase == OFFSET(2,8) )
+    else if ( ybase == OFFSET(2, Side::SeventhRank) )   // check for pawn promotion
     {
         // Count ANY pawn promotion as a capture, even if it is not
         // capturing an enemy piece.
 
-        if ( board [ofs + NORTH] == EMPTY )
+        if ( board [ofs + Side::Forward] == EMPTY )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | R_INDEX );
@@ -99,7 +117,7 @@ void ChessBoard::GenCaps_WP ( MoveList &ml, int ofs, int ybase )
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | N_INDEX );
         }
 
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | R_INDEX );
@@ -107,7 +125,7 @@ void ChessBoard::GenCaps_WP ( MoveList &ml, int ofs, int ybase )
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | N_INDEX );
         }
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | R_INDEX );
@@ -117,400 +135,431 @@ void ChessBoard::GenCaps_WP ( MoveList &ml, int ofs, int ybase )
     }
     else  // Look for normal captures
     {
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHEAST );
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnEast );
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHWEST );
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnWest );
     }
 }
 
 
-void ChessBoard::GenCaps_WN ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenCaps_N ( MoveList &ml, int source )
 {
-    if ( board [source + OFFSET(1,2)] & BLACK_MASK )
+    if ( board [source + OFFSET(1,2)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(1,2) );
 
-    if ( board [source + OFFSET(-1,2)] & BLACK_MASK )
+    if ( board [source + OFFSET(-1,2)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(-1,2) );
 
-    if ( board [source + OFFSET(1,-2)] & BLACK_MASK )
+    if ( board [source + OFFSET(1,-2)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(1,-2) );
 
-    if ( board [source + OFFSET(-1,-2)] & BLACK_MASK )
+    if ( board [source + OFFSET(-1,-2)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(-1,-2) );
 
-    if ( board [source + OFFSET(2,1)] & BLACK_MASK )
+    if ( board [source + OFFSET(2,1)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(2,1) );
 
-    if ( board [source + OFFSET(2,-1)] & BLACK_MASK )
+    if ( board [source + OFFSET(2,-1)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(2,-1) );
 
-    if ( board [source + OFFSET(-2,1)] & BLACK_MASK )
+    if ( board [source + OFFSET(-2,1)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(-2,1) );
 
-    if ( board [source + OFFSET(-2,-1)] & BLACK_MASK )
+    if ( board [source + OFFSET(-2,-1)] & Side::Opponent::Mask )
         ml.AddMove ( source, source + OFFSET(-2,-1) );
 }
 
 
-void ChessBoard::GenCaps_WB ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenCaps_B ( MoveList &ml, int source )
 {
     int ofs;
     for ( ofs = source + NORTHEAST; board[ofs] == EMPTY; ofs += NORTHEAST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + NORTHWEST; board[ofs] == EMPTY; ofs += NORTHWEST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + SOUTHWEST; board[ofs] == EMPTY; ofs += SOUTHWEST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + SOUTHEAST; board[ofs] == EMPTY; ofs += SOUTHEAST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 }
 
 
-void ChessBoard::GenCaps_WR ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenCaps_R ( MoveList &ml, int source )
 {
     int ofs;
     for ( ofs = source + NORTH; board[ofs] == EMPTY; ofs += NORTH );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + WEST; board[ofs] == EMPTY; ofs += WEST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + SOUTH; board[ofs] == EMPTY; ofs += SOUTH );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 
     for ( ofs = source + EAST; board[ofs] == EMPTY; ofs += EAST );
-    if ( board[ofs] & BLACK_MASK )
+    if ( board[ofs] & Side::Opponent::Mask )
         ml.AddMove ( source, ofs );
 }
 
 
-void ChessBoard::GenCaps_WQ ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenCaps_Q ( MoveList &ml, int source )
 {
-    int ofs;
-    for ( ofs = source + NORTHEAST; board[ofs] == EMPTY; ofs += NORTHEAST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + NORTHWEST; board[ofs] == EMPTY; ofs += NORTHWEST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + SOUTHWEST; board[ofs] == EMPTY; ofs += SOUTHWEST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + SOUTHEAST; board[ofs] == EMPTY; ofs += SOUTHEAST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + NORTH; board[ofs] == EMPTY; ofs += NORTH );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + WEST; board[ofs] == EMPTY; ofs += WEST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + SOUTH; board[ofs] == EMPTY; ofs += SOUTH );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
-
-    for ( ofs = source + EAST; board[ofs] == EMPTY; ofs += EAST );
-    if ( board[ofs] & BLACK_MASK )
-        ml.AddMove ( source, ofs );
+    GenCaps_B<Side> ( ml, source );
+    GenCaps_R<Side> ( ml, source );
 }
 
 
-void ChessBoard::GenCaps_WK ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenCaps_K ( MoveList &ml, int source )
 {
-    if ( board [source + NORTH] & BLACK_MASK )
+    if ( board [source + NORTH] & Side::Opponent::Mask )
         ml.AddMove ( source, source + NORTH );
 
-    if ( board [source + SOUTH] & BLACK_MASK )
+    if ( board [source + SOUTH] & Side::Opponent::Mask )
         ml.AddMove ( source, source + SOUTH );
 
-    if ( board [source + EAST] & BLACK_MASK )
+    if ( board [source + EAST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + EAST );
 
-    if ( board [source + WEST] & BLACK_MASK )
+    if ( board [source + WEST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + WEST );
 
-    if ( board [source + NORTHEAST] & BLACK_MASK )
+    if ( board [source + NORTHEAST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + NORTHEAST );
 
-    if ( board [source + NORTHWEST] & BLACK_MASK )
+    if ( board [source + NORTHWEST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + NORTHWEST );
 
-    if ( board [source + SOUTHEAST] & BLACK_MASK )
+    if ( board [source + SOUTHEAST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + SOUTHEAST );
 
-    if ( board [source + SOUTHWEST] & BLACK_MASK )
+    if ( board [source + SOUTHWEST] & Side::Opponent::Mask )
         ml.AddMove ( source, source + SOUTHWEST );
 }
 
 
-//---------------------------------------------------------------------------
+template int ChessBoard::GenPseudoCaptures<WhiteSide> ( MoveList & );
+template int ChessBoard::GenPseudoCaptures<BlackSide> ( MoveList & );
 
-int ChessBoard::GenBlackCaptures ( MoveList &ml, ComputerChessPlayer *player )
-{
-    PROFILER_ENTER(PX_GENCAPS);
-    int x, ybase, ofs;
-    SQUARE piece;
 
-    ml.num = 0;    // Make the MoveList empty.
 
-    for ( ybase = OFFSET(2,2); ybase < OFFSET(2,10); ybase += NORTH )
-    {
-        for ( x=0; x < 8; x++ )
-        {
-            piece = board [ofs = ybase + x];
+//---------------------------------------------------------------------------
+// Captures, promotions and checks for the quiescence search.
+// The checks are generated directly, working outward from the enemy
+// king: quiet moves onto the squares from which a piece attacks it,
+// and quiet moves of our pieces that screen one of our sliders from it.
+// Only these candidates are made on the board for the legality test
+// and move ordering.
 
-            if ( piece & BLACK_MASK )
-            {
-                switch ( UPIECE_INDEX(piece) )
-                {
-                case P_INDEX:
-                    GenCaps_BP ( ml, ofs, ybase );
-                    break;
+// Returns the single step leading from 'from' toward 'to' along a rank,
+// file or diagonal, or 0 if the two squares do not share one.
 
-                case N_INDEX:
-                    GenCaps_BN ( ml, ofs );
-                    break;
+static int LineStep ( int from, int to )
+{
+    const int dx = (to % NORTH) - (from % NORTH);
+    const int dy = (to / NORTH) - (from / NORTH);
 
-                case B_INDEX:
-                    GenCaps_BB ( ml, ofs );
-                    break;
+    if ( dx == 0 )
+        return (dy > 0) ? NORTH : ((dy < 0) ? SOUTH : 0);
 
-                case R_INDEX:
-                    GenCaps_BR ( ml, ofs );
-                    break;
+    if ( dy == 0 )
+        return (dx > 0) ? EAST : WEST;
 
-                case Q_INDEX:
-                    GenCaps_BQ ( ml, ofs );
-                    break;
-
-                case K_INDEX:
-                    GenCaps_BK ( ml, ofs );
-                    break;
+    if ( dx == dy )
+        return (dx > 0) ? NORTHEAST : SOUTHWEST;
 
-                default:
-                    ChessFatal ( "Invalid piece in ChessBoard::GenBlackCaptures" );
-                    break;
-                }
-            }
-        }
-    }
+    if ( dx == -dy )
+        return (dx > 0) ? SOUTHEAST : NORTHWEST;
 
-    RemoveIllegalBlack ( ml, player );
-    PROFILER_EXIT();
-    return ml.num;
+    return 0;
 }
 
 
-void ChessBoard::GenCaps_BP ( MoveList &ml, int ofs, int ybase )
+static bool IsOrthogonal ( int step )
 {
-    if ( ybase == OFFSET(2,5) )   // check for en passant and normal captures
-    {
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHEAST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(1,-2) &&
-                  prev_move.dest == ofs + OFFSET(1,0) &&
-                  (board [prev_move.dest] & WP_MASK) )
-            ml.AddMove ( ofs, SPECIAL_MOVE_EP_EAST );
+    return step == NORTH || step == SOUTH || step == EAST || step == WEST;
+}
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHWEST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(-1,-2) &&
-                  prev_move.dest == ofs + OFFSET(-1,0) &&
-                  (board [prev_move.dest] & WP_MASK) )
-            ml.AddMove ( ofs, SPECIAL_MOVE_EP_WEST );
-    }
-    else if ( ybase == OFFSET(2,3) )   // check for pawn promotion
-    {
-        // Count ANY pawn promotion as a capture, even if it is not
-        // capturing an enemy piece.
 
-        if ( board [ofs + SOUTH] == EMPTY )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | N_INDEX );
-        }
+static bool IsKnightJump ( int delta )
+{
+    return delta == OFFSET(1,2)  || delta == OFFSET(-1,2)  ||
+           delta == OFFSET(2,1)  || delta == OFFSET(-2,1)  ||
+           delta == OFFSET(1,-2) || delta == OFFSET(-1,-2) ||
+           delta == OFFSET(2,-1) || delta == OFFSET(-2,-1);
+}
 
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | N_INDEX );
-        }
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | N_INDEX );
-        }
-    }
-    else  // Look for normal captures
-    {
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHEAST );
+static const int KnightJumps [8] =
+{
+    OFFSET( 1, 2), OFFSET( 1,-2), OFFSET(-1, 2), OFFSET(-1,-2),
+    OFFSET( 2, 1), OFFSET( 2,-1), OFFSET(-2, 1), OFFSET(-2,-1)
+};
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHWEST );
-    }
-}
+// The orthogonal steps come first, so 'd < 4' tells a rook's line from a bishop's.
+static const int LineSteps [8] =
+{
+    NORTH, SOUTH, EAST, WEST,
+    NORTHEAST, NORTHWEST, SOUTHEAST, SOUTHWEST
+};
 
 
-void ChessBoard::GenCaps_BN ( MoveList &ml, int source )
+static bool IsListed ( const int list[], int num, int ofs )
 {
-    if ( board [source + OFFSET(1,2)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(1,2) );
+    for ( int i=0; i < num; ++i )
+        if ( list[i] == ofs )
+            return true;
 
-    if ( board [source + OFFSET(-1,2)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(-1,2) );
+    return false;
+}
 
-    if ( board [source + OFFSET(1,-2)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(1,-2) );
 
-    if ( board [source + OFFSET(-1,-2)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(-1,-2) );
+template <class Side>
+bool ChessBoard::MoveMayCheck ( Move move ) const
+{
+    if ( move.dest > OFFSET(9,9) )
+        return true;    // castling: let MakeMove decide
 
-    if ( board [source + OFFSET(2,1)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(2,1) );
+    const int source = move.source & BOARD_OFFSET_MASK;
+    const int dest   = move.dest;
+    const int king   = Side::IsWhite ? bk_offset : wk_offset;
+    const SQUARE piece = board [source];
+    int step, ofs;
 
-    if ( board [source + OFFSET(2,-1)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(2,-1) );
+    // Does the piece attack the king from its new square?
 
-    if ( board [source + OFFSET(-2,1)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(-2,1) );
+    switch ( UPIECE_INDEX(piece) )
+    {
+    case P_INDEX:
+        if ( dest + Side::PawnEast == king || dest + Side::PawnWest == king )
+            return true;
+        break;
+
+    case N_INDEX:
+        if ( IsKnightJump(king - dest) )
+            return true;
+        break;
+
+    case B_INDEX:
+    case R_INDEX:
+    case Q_INDEX:
+        step = LineStep ( dest, king );
+        if ( step &&
+             ((piece & Side::QueenMask) || ((piece & Side::RookMask) != 0) == IsOrthogonal(step)) )
+        {
+            for ( ofs = dest + step; ofs != king; ofs += step )
+                if ( board[ofs] != EMPTY && ofs != source )
+                    break;
 
-    if ( board [source + OFFSET(-2,-1)] & WHITE_MASK )
-        ml.AddMove ( source, source + OFFSET(-2,-1) );
-}
+            if ( ofs == king )
+                return true;
+        }
+        break;
+    }
 
+    // Does leaving the source square uncover a slider aimed at the king?
 
-void ChessBoard::GenCaps_BB ( MoveList &ml, int source )
-{
-    int ofs;
-    for ( ofs = source + NORTHEAST; board[ofs] == EMPTY; ofs += NORTHEAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    step = LineStep ( king, source );
+    if ( step == 0 || LineStep(king,dest) == step )
+        return false;
 
-    for ( ofs = source + NORTHWEST; board[ofs] == EMPTY; ofs += NORTHWEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( ofs = king + step; ofs != source; ofs += step )
+        if ( board[ofs] != EMPTY )
+            return false;
 
-    for ( ofs = source + SOUTHWEST; board[ofs] == EMPTY; ofs += SOUTHWEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( ofs = source + step; board[ofs] == EMPTY; ofs += step )
+        ;
 
-    for ( ofs = source + SOUTHEAST; board[ofs] == EMPTY; ofs += SOUTHEAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    return (board[ofs] & Side::QueenMask) ||
+           (board[ofs] & (IsOrthogonal(step) ? Side::RookMask : Side::BishopMask));
 }
 
 
-void ChessBoard::GenCaps_BR ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuietChecks ( MoveList &ml )
 {
-    int ofs;
-    for ( ofs = source + NORTH; board[ofs] == EMPTY; ofs += NORTH );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    const int king = Side::Opponent::KingOffset ( *this );
+    int screen [8], screenStep [8], numScreens = 0;
+    int d, i, j, ofs, source, dest;
+    MoveList own;
 
-    for ( ofs = source + WEST; board[ofs] == EMPTY; ofs += WEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    // Discovered checks: a piece of ours alone between the enemy king and
+    // one of our sliders checks by stepping off the line.  A queen, or a
+    // rook or bishop on its own kind of line, would already be checking,
+    // so only moves that really leave the line need the test below.
 
-    for ( ofs = source + SOUTH; board[ofs] == EMPTY; ofs += SOUTH );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( d=0; d < 8; d++ )
+    {
+        for ( ofs = king + LineSteps[d]; board[ofs] == EMPTY; ofs += LineSteps[d] )
+            ;
 
-    for ( ofs = source + EAST; board[ofs] == EMPTY; ofs += EAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
-}
+        if ( !(board[ofs] & Side::Mask) )
+            continue;
 
+        source = ofs;
+        for ( ofs += LineSteps[d]; board[ofs] == EMPTY; ofs += LineSteps[d] )
+            ;
 
-void ChessBoard::GenCaps_BQ ( MoveList &ml, int source )
-{
-    int ofs;
-    for ( ofs = source + NORTHEAST; board[ofs] == EMPTY; ofs += NORTHEAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+        if ( board[ofs] & (Side::QueenMask | (d < 4 ? Side::RookMask : Side::BishopMask)) )
+        {
+            screen [numScreens] = source;
+            screenStep [numScreens++] = LineSteps[d];
+        }
+    }
 
-    for ( ofs = source + NORTHWEST; board[ofs] == EMPTY; ofs += NORTHWEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( i=0; i < numScreens; i++ )
+    {
+        own.num = 0;
+        GenQuietsFrom<Side> ( own, screen[i] );
+        for ( j=0; j < own.num; j++ )
+            if ( own.m[j].dest <= OFFSET(9,9) && LineStep(king, own.m[j].dest) != screenStep[i] )
+                ml.AddMove ( own.m[j] );
+    }
 
-    for ( ofs = source + SOUTHWEST; board[ofs] == EMPTY; ofs += SOUTHWEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    // Direct checks by knights, onto the empty knight squares around the king.
+    // The screens are skipped from here on: all their checking moves are in.
 
-    for ( ofs = source + SOUTHEAST; board[ofs] == EMPTY; ofs += SOUTHEAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( i=0; i < 8; i++ )
+    {
+        dest = king + KnightJumps[i];
+        if ( board[dest] == EMPTY )
+        {
+            for ( j=0; j < 8; j++ )
+            {
+                source = dest + KnightJumps[j];
+                if ( (board[source] & Side::KnightMask) && !IsListed(screen, numScreens, source) )
+                    ml.AddMove ( source, dest );
+            }
+        }
+    }
 
-    for ( ofs = source + NORTH; board[ofs] == EMPTY; ofs += NORTH );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    // Direct checks by sliders, onto the empty squares of the king's lines.
+    // Look from each such square for a piece of ours that both reaches it
+    // and, once there, attacks the king along the line.
 
-    for ( ofs = source + WEST; board[ofs] == EMPTY; ofs += WEST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+    for ( d=0; d < 8; d++ )
+    {
+        const SQUARE checkers = Side::QueenMask | (d < 4 ? Side::RookMask : Side::BishopMask);
+        for ( dest = king + LineSteps[d]; board[dest] == EMPTY; dest += LineSteps[d] )
+        {
+            for ( i=0; i < 8; i++ )
+            {
+                if ( LineSteps[i] == -LineSteps[d] )
+                    continue;   // back toward the king: nothing but empty squares
 
-    for ( ofs = source + SOUTH; board[ofs] == EMPTY; ofs += SOUTH );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
+                for ( source = dest + LineSteps[i]; board[source] == EMPTY; source += LineSteps[i] )
+                    ;
 
-    for ( ofs = source + EAST; board[ofs] == EMPTY; ofs += EAST );
-    if ( board[ofs] & WHITE_MASK )
-        ml.AddMove ( source, ofs );
-}
+                if ( (board[source] & checkers & (Side::QueenMask | (i < 4 ? Side::RookMask : Side::BishopMask))) &&
+                     !IsListed(screen, numScreens, source) )
+                    ml.AddMove ( source, dest );
+            }
+        }
+    }
 
+    // Direct checks by pawns, pushed one or two squares onto one of the
+    // squares from which a pawn attacks the king.  Pushes to the last rank
+    // are promotions, which GenPseudoCaptures has already produced.
 
-void ChessBoard::GenCaps_BK ( MoveList &ml, int source )
-{
-    if ( board [source + NORTH] & WHITE_MASK )
-        ml.AddMove ( source, source + NORTH );
+    for ( i=0; i < 2; i++ )
+    {
+        dest = king - (i ? Side::PawnWest : Side::PawnEast);
+        if ( board[dest] != EMPTY )
+            continue;
+
+        source = dest - Side::Forward;
+        if ( board[source] == EMPTY && YPART(source - Side::Forward) == Side::PawnRank )
+            source -= Side::Forward;
+
+        if ( (board[source] & Side::PawnMask) &&
+             YPART(source) != Side::SeventhRank &&
+             !IsListed(screen, numScreens, source) )
+            ml.AddMove ( source, dest );
+    }
 
-    if ( board [source + SOUTH] & WHITE_MASK )
-        ml.AddMove ( source, source + SOUTH );
+    // Castling checks when the rook lands on a line to the king that the
+    // castling itself leaves open.  The king cannot check from its new square.
 
-    if ( board [source + EAST] & WHITE_MASK )
-        ml.AddMove ( source, source + EAST );
+    if ( (flags & (Side::KingMoved | Side::CheckFlag)) == 0 )
+    {
+        const int kingFrom = Side::KingOffset ( *this );
+        own.num = 0;
+        GenQuietsFrom<Side> ( own, kingFrom );
+        for ( j=0; j < own.num; j++ )
+        {
+            if ( own.m[j].dest <= OFFSET(9,9) )
+                continue;
 
-    if ( board [source + WEST] & WHITE_MASK )
-        ml.AddMove ( source, source + WEST );
+            int kingTo, rookFrom, rookTo;
+            switch ( own.m[j].dest & SPECIAL_MOVE_MASK )
+            {
+            case SPECIAL_MOVE_KCASTLE:
+                kingTo   = OFFSET(8, Side::BackRank);
+                rookFrom = OFFSET(9, Side::BackRank);
+                rookTo   = OFFSET(7, Side::BackRank);
+                break;
+
+            case SPECIAL_MOVE_QCASTLE:
+                kingTo   = OFFSET(4, Side::BackRank);
+                rookFrom = OFFSET(2, Side::BackRank);
+                rookTo   = OFFSET(5, Side::BackRank);
+                break;
+
+            default:
+                continue;
+            }
 
-    if ( board [source + NORTHEAST] & WHITE_MASK )
-        ml.AddMove ( source, source + NORTHEAST );
+            const int step = LineStep ( rookTo, king );
+            if ( !IsOrthogonal(step) )
+                continue;
 
-    if ( board [source + NORTHWEST] & WHITE_MASK )
-        ml.AddMove ( source, source + NORTHWEST );
+            for ( ofs = rookTo + step; ofs != king; ofs += step )
+                if ( ofs == kingTo || (board[ofs] != EMPTY && ofs != kingFrom && ofs != rookFrom) )
+                    break;
 
-    if ( board [source + SOUTHEAST] & WHITE_MASK )
-        ml.AddMove ( source, source + SOUTHEAST );
+            if ( ofs == king )
+                ml.AddMove ( own.m[j] );
+        }
+    }
+}
 
-    if ( board [source + SOUTHWEST] & WHITE_MASK )
-        ml.AddMove ( source, source + SOUTHWEST );
+
+template <class Side>
+int ChessBoard::GenCapturesAndChecks (
+    MoveList &ml,
+    ComputerChessPlayer *player )
+{
+    GenPseudoCaptures<Side> ( ml );
+
+    PROFILER_ENTER(PX_GENCAPS)
+    GenQuietChecks<Side> ( ml );
+    PROFILER_EXIT();
+
+    RemoveIllegal<Side> ( ml, player );
+    return ml.num;
 }
 
+template bool ChessBoard::MoveMayCheck<WhiteSide> ( Move ) const;
+template bool ChessBoard::MoveMayCheck<BlackSide> ( Move ) const;
+template int  ChessBoard::GenCapturesAndChecks<WhiteSide> ( MoveList &, ComputerChessPlayer * );
+template int  ChessBoard::GenCapturesAndChecks<BlackSide> ( MoveList &, ComputerChessPlayer * );
+
 
 /*
     $Log: gencaps.cpp,v $
@@ -8,115 +8,169 @@
 ============================================================================*/
 
 #include "chess.h"
+#include "side.h"
 #include "profiler.h"
 
 
 int ChessBoard::GenWhiteMoves (
     MoveList            &ml,
     ComputerChessPlayer *player )
+{
+    GenPseudoMoves<WhiteSide> ( ml );
+    RemoveIllegal<WhiteSide> ( ml, player );
+    return ml.num;
+}
+
+
+int ChessBoard::GenBlackMoves (
+    MoveList             &ml,
+    ComputerChessPlayer  *player )
+{
+    GenPseudoMoves<BlackSide> ( ml );
+    RemoveIllegal<BlackSide> ( ml, player );
+    return ml.num;
+}
+
+
+template <class Side>
+int ChessBoard::GenPseudoMoves ( MoveList &ml )
 {
     PROFILER_ENTER(PX_GENMOVES);
 
-    int x, ybase, ofs;
+    int x, y, ybase, ofs;
     SQUARE  piece;
 
     ml.num = 0;   // make the MoveList empty.
-    for ( ybase = OFFSET(2,2); ybase < OFFSET(2,10); ybase += NORTH )
+
+    // Scan from the side's own back rank toward the enemy.
+    ybase = OFFSET(2, Side::BackRank);
+    for ( y=0; y < 8; y++, ybase += Side::Forward )
     {
         for ( x=0; x < 8; x++ )
         {
             piece = board [ofs = ybase + x];
-            if ( piece & WHITE_MASK )
+            if ( piece & Side::Mask )
             {
                 switch ( UPIECE_INDEX(piece) )
                 {
                 case P_INDEX:
-                    GenMoves_WP ( ml, ofs, ybase );
+                    GenMoves_P<Side> ( ml, ofs, ybase );
                     break;
 
                 case N_INDEX:
-                    GenMoves_WN ( ml, ofs );
+                    GenMoves_N<Side> ( ml, ofs );
                     break;
 
                 case B_INDEX:
-                    GenMoves_WB ( ml, ofs );
+                    GenMoves_B<Side> ( ml, ofs );
                     break;
 
                 case R_INDEX:
-                    GenMoves_WR ( ml, ofs );
+                    GenMoves_R<Side> ( ml, ofs );
                     break;
 
                 case Q_INDEX:
-                    GenMoves_WQ ( ml, ofs );
+                    GenMoves_Q<Side> ( ml, ofs );
                     break;
 
                 case K_INDEX:
-                    GenMoves_WK ( ml, ofs );
+                    GenMoves_K<Side> ( ml, ofs );
                     break;
 
                 default:
-                    ChessFatal ( "Undefined white piece in ChessBoard::GenWhiteMoves" );
+                    ChessFatal ( "Undefined piece in ChessBoard::GenPseudoMoves" );
                     break;
                 }
             }
         }
     }
 
-    RemoveIllegalWhite ( ml, player );
     PROFILER_EXIT();
     return ml.num;
 }
 
 
-void ChessBoard::GenMoves_WP ( MoveList &ml, int ofs, int ybase )
+template <class Side>
+bool ChessBoard::MoveIsPseudoLegal ( Move move )
+{
+    // Generate the moves of just the piece on the source square,
+    // so that a move remembered from some other position (or a
+    // transposition table collision) can be vetted without
+    // generating the whole move list.
+
+    const int source = move.source & BOARD_OFFSET_MASK;
+    const SQUARE piece = board [source];
+    if ( !(piece & Side::Mask) )
+        return false;
+
+    MoveList ml;
+    ml.num = 0;
+    switch ( UPIECE_INDEX(piece) )
+    {
+    case P_INDEX:   GenMoves_P<Side> ( ml, source, OFFSET(2, source/NORTH) );   break;
+    case N_INDEX:   GenMoves_N<Side> ( ml, source );   break;
+    case B_INDEX:   GenMoves_B<Side> ( ml, source );   break;
+    case R_INDEX:   GenMoves_R<Side> ( ml, source );   break;
+    case Q_INDEX:   GenMoves_Q<Side> ( ml, source );   break;
+    case K_INDEX:   GenMoves_K<Side> ( ml, source );   break;
+    }
+
+    return ml.IsLegal ( move );
+}
+
+
+template <class Side>
+void ChessBoard::GenMoves_P ( MoveList &ml, int ofs, int ybase )
 {
-    if ( ybase == OFFSET(2,3) )
+    const int ahead = ofs + Side::Forward;
+
+    if ( ybase == OFFSET(2, Side::PawnRank) )
     {
         // Pawn is on the home row.
 
         // Check for non-capture moves...
-        if ( board [ofs + NORTH] == EMPTY )
+        if ( board [ahead] == EMPTY )
         {
             // It can move one square forward...
-            ml.AddMove ( ofs, ofs + NORTH );
+            ml.AddMove ( ofs, ahead );
 
             // See if we can go two squares!
-            if ( board [ofs + 2*NORTH] == EMPTY )
-                ml.AddMove ( ofs, ofs + 2*NORTH );
+            if ( board [ahead + Side::Forward] == EMPTY )
+                ml.AddMove ( ofs, ahead + Side::Forward );
         }
 
         // Check for capture moves...
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHEAST );
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnEast );
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHWEST );
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnWest );
     }
-    else if ( ybase == OFFSET(2,6) )
+    else if ( ybase == OFFSET(2, Side::EnPassantRank) )
     {
         // Need to look for en passant captures on this rank.
 
-        if ( board [ofs + NORTH] == EMPTY )
-            ml.AddMove ( ofs, ofs + NORTH );
+        if ( board [ahead] == EMPTY )
+            ml.AddMove ( ofs, ahead );
 
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHEAST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(1,2) &&
-                  prev_move.dest == ofs + OFFSET(1,0) &&
-                  (board [prev_move.dest] & BP_MASK) )
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnEast );
+        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + EAST + 2*Side::Forward &&
+                  prev_move.dest == ofs + EAST &&
+                  (board [prev_move.dest] & Side::Opponent::PawnMask) )
             ml.AddMove ( ofs, SPECIAL_MOVE_EP_EAST );
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHWEST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(-1,2) &&
-                  prev_move.dest == ofs + OFFSET(-1,0) &&
-                  (board [prev_move.dest] & BP_MASK) )
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnWest );
+        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + WEST + 2*Side::Forward &&
+                  prev_move.dest == ofs + WEST &&
+                  (board [prev_move.dest] & Side::Opponent::PawnMask) )
             ml.AddMove ( ofs, SPECIAL_MOVE_EP_WEST );
     }
-    else if ( ybase == OFFSET(2,8) )
+    else if ( ybase == OFFSET(2, Side::SeventhRank) )
     {
         // Pawn is one square away from promoting.  See if it can promote...
-        if ( board [ofs + NORTH] == EMPTY )
+        if ( board [ahead] == EMPTY )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | R_INDEX );
@@ -124,7 +178,7 @@ void ChessBoard::GenMoves_WP ( MoveList &ml, int ofs, int ybase )
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | N_INDEX );
         }
 
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | R_INDEX );
@@ -132,7 +186,7 @@ void ChessBoard::GenMoves_WP ( MoveList &ml, int ofs, int ybase )
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | N_INDEX );
         }
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
         {
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | Q_INDEX );
             ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | R_INDEX );
@@ -144,546 +198,372 @@ void ChessBoard::GenMoves_WP ( MoveList &ml, int ofs, int ybase )
     {
         // Normal pawn move away from home square...
 
-        if ( board [ofs + NORTH] == EMPTY )
-            ml.AddMove ( ofs, ofs + NORTH );
+        if ( board [ahead] == EMPTY )
+            ml.AddMove ( ofs, ahead );
 
         // Check for capture moves...
-        if ( board [ofs + NORTHEAST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHEAST );
+        if ( board [ofs + Side::PawnEast] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnEast );
 
-        if ( board [ofs + NORTHWEST] & BLACK_MASK )
-            ml.AddMove ( ofs, ofs + NORTHWEST );
+        if ( board [ofs + Side::PawnWest] & Side::Opponent::Mask )
+            ml.AddMove ( ofs, ofs + Side::PawnWest );
     }
 }
 
 
-void ChessBoard::GenMoves_WN ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenMoves_N ( MoveList &ml, int source )
 {
-    if ( (board [source + OFFSET(1,2)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(1,2)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(1,2) );
 
-    if ( (board [source + OFFSET(1,-2)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(1,-2)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(1,-2) );
 
-    if ( (board [source + OFFSET(-1,2)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(-1,2)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(-1,2) );
 
-    if ( (board [source + OFFSET(-1,-2)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(-1,-2)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(-1,-2) );
 
-    if ( (board [source + OFFSET(2,1)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(2,1)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(2,1) );
 
-    if ( (board [source + OFFSET(2,-1)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(2,-1)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(2,-1) );
 
-    if ( (board [source + OFFSET(-2,1)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(-2,1)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(-2,1) );
 
-    if ( (board [source + OFFSET(-2,-1)] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + OFFSET(-2,-1)] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + OFFSET(-2,-1) );
 }
 
 
-void ChessBoard::GenMoves_WB ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenMoves_B ( MoveList &ml, int source )
 {
     int dest;
     for ( dest = source + NORTHEAST; board[dest] == EMPTY; dest += NORTHEAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + NORTHWEST; board[dest] == EMPTY; dest += NORTHWEST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + SOUTHEAST; board[dest] == EMPTY; dest += SOUTHEAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + SOUTHWEST; board[dest] == EMPTY; dest += SOUTHWEST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 }
 
 
-void ChessBoard::GenMoves_WR ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenMoves_R ( MoveList &ml, int source )
 {
     int dest;
     for ( dest = source + NORTH; board[dest] == EMPTY; dest += NORTH )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + WEST; board[dest] == EMPTY; dest += WEST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + EAST; board[dest] == EMPTY; dest += EAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 
     for ( dest = source + SOUTH; board[dest] == EMPTY; dest += SOUTH )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & BLACK_MASK )
+    if ( board[dest] & Side::Opponent::Mask )
         ml.AddMove ( source, dest );
 }
 
 
-void ChessBoard::GenMoves_WQ ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenMoves_Q ( MoveList &ml, int source )
 {
-    int dest;
-    for ( dest = source + NORTHEAST; board[dest] == EMPTY; dest += NORTHEAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + NORTHWEST; board[dest] == EMPTY; dest += NORTHWEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTHEAST; board[dest] == EMPTY; dest += SOUTHEAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTHWEST; board[dest] == EMPTY; dest += SOUTHWEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + NORTH; board[dest] == EMPTY; dest += NORTH )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + WEST; board[dest] == EMPTY; dest += WEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + EAST; board[dest] == EMPTY; dest += EAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTH; board[dest] == EMPTY; dest += SOUTH )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & BLACK_MASK )
-        ml.AddMove ( source, dest );
+    GenMoves_B<Side> ( ml, source );
+    GenMoves_R<Side> ( ml, source );
 }
 
 
-void ChessBoard::GenMoves_WK ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenMoves_K ( MoveList &ml, int source )
 {
-    if ( (board [source + NORTH] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + NORTH] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + NORTH );
 
-    if ( (board [source + NORTHEAST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + NORTHEAST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + NORTHEAST );
 
-    if ( (board [source + NORTHWEST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + NORTHWEST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + NORTHWEST );
 
-    if ( (board [source + EAST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + EAST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + EAST );
 
-    if ( (board [source + WEST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + WEST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + WEST );
 
-    if ( (board [source + SOUTHEAST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + SOUTHEAST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + SOUTHEAST);
 
-    if ( (board [source + SOUTHWEST] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + SOUTHWEST] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + SOUTHWEST);
 
-    if ( (board [source + SOUTH] & (WHITE_MASK | OFFBOARD)) == 0 )
+    if ( (board [source + SOUTH] & (Side::Mask | OFFBOARD)) == 0 )
         ml.AddMove ( source, source + SOUTH);
 
-    // Check for castling...
-    if ( (flags & (SF_WKMOVED|SF_WCHECK)) == 0 )
+    GenCastling<Side> ( ml, source );
+}
+
+
+template <class Side>
+void ChessBoard::GenCastling ( MoveList &ml, int source )
+{
+    if ( (flags & (Side::KingMoved | Side::CheckFlag)) == 0 )
     {
         // check for O-O
-        if (    (flags & SF_WKRMOVED) == 0  &&
-                (board [OFFSET(9,2)] & WR_MASK)  &&
-                board [OFFSET(8,2)] == EMPTY     &&
-                board [OFFSET(7,2)] == EMPTY     &&
-                !IsAttackedByBlack ( OFFSET(7,2) ) )
+        if (    (flags & Side::KingRookMoved) == 0                  &&
+                (board [OFFSET(9, Side::BackRank)] & Side::RookMask) &&
+                board [OFFSET(8, Side::BackRank)] == EMPTY           &&
+                board [OFFSET(7, Side::BackRank)] == EMPTY           &&
+                !Side::Opponent::Attacks ( *this, OFFSET(7, Side::BackRank) ) )
             ml.AddMove ( source, SPECIAL_MOVE_KCASTLE );
 
         // check for O-O-O
-        if (    (flags & SF_WQRMOVED) == 0  &&
-                (board [OFFSET(2,2)] & WR_MASK)  &&
-                board [OFFSET(3,2)] == EMPTY     &&
-                board [OFFSET(4,2)] == EMPTY     &&
-                board [OFFSET(5,2)] == EMPTY     &&
-                !IsAttackedByBlack ( OFFSET(5,2) ) )
+        if (    (flags & Side::QueenRookMoved) == 0                 &&
+                (board [OFFSET(2, Side::BackRank)] & Side::RookMask) &&
+                board [OFFSET(3, Side::BackRank)] == EMPTY           &&
+                board [OFFSET(4, Side::BackRank)] == EMPTY           &&
+                board [OFFSET(5, Side::BackRank)] == EMPTY           &&
+                !Side::Opponent::Attacks ( *this, OFFSET(5, Side::BackRank) ) )
             ml.AddMove ( source, SPECIAL_MOVE_QCASTLE );
     }
 }
 
-
-
 //--------------------------------------------------------------------------
+// Quiet moves: the moves GenPseudoCaptures does not produce, that is,
+// everything but captures, en passant and promotions.  They come out in
+// the same order as they appear in GenPseudoMoves.
 
-int ChessBoard::GenBlackMoves (
-    MoveList             &ml,
-    ComputerChessPlayer  *player )
+template <class Side>
+int ChessBoard::GenPseudoQuiets ( MoveList &ml )
 {
-    PROFILER_ENTER(PX_GENMOVES)
-    int x, ybase, ofs;
+    PROFILER_ENTER(PX_GENMOVES);
+
+    int x, y, ybase, ofs;
     SQUARE  piece;
 
     ml.num = 0;   // make the MoveList empty.
 
-    for ( ybase = OFFSET(2,9); ybase > OFFSET(2,1); ybase += SOUTH )
+    ybase = OFFSET(2, Side::BackRank);
+    for ( y=0; y < 8; y++, ybase += Side::Forward )
     {
         for ( x=0; x < 8; x++ )
         {
             piece = board [ofs = ybase + x];
-
-            if ( piece & BLACK_MASK )
+            if ( piece & Side::Mask )
             {
                 switch ( UPIECE_INDEX(piece) )
                 {
                 case P_INDEX:
-                    GenMoves_BP ( ml, ofs, ybase );
+                    GenQuiets_P<Side> ( ml, ofs, ybase );
                     break;
 
                 case N_INDEX:
-                    GenMoves_BN ( ml, ofs );
+                    GenQuiets_N<Side> ( ml, ofs );
                     break;
 
                 case B_INDEX:
-                    GenMoves_BB ( ml, ofs );
+                    GenQuiets_B<Side> ( ml, ofs );
                     break;
 
                 case R_INDEX:
-                    GenMoves_BR ( ml, ofs );
+                    GenQuiets_R<Side> ( ml, ofs );
                     break;
 
                 case Q_INDEX:
-                    GenMoves_BQ ( ml, ofs );
+                    GenQuiets_Q<Side> ( ml, ofs );
                     break;
 
                 case K_INDEX:
-                    GenMoves_BK ( ml, ofs );
+                    GenQuiets_K<Side> ( ml, ofs );
                     break;
 
                 default:
-                    ChessFatal ( "Undefined black piece in ChessBoard::GenBlackMoves" );
+                    ChessFatal ( "Undefined piece in ChessBoard::GenPseudoQuiets" );
                     break;
                 }
             }
         }
     }
 
-    RemoveIllegalBlack ( ml, player );
-    PROFILER_EXIT()
+    PROFILER_EXIT();
     return ml.num;
 }
 
 
-void ChessBoard::GenMoves_BP ( MoveList &ml, int ofs, int ybase )
+// The quiet moves of just the piece on 'source', castling included.
+
+template <class Side>
+void ChessBoard::GenQuietsFrom ( MoveList &ml, int source )
 {
-    if ( ybase == OFFSET(2,8) )
+    switch ( UPIECE_INDEX(board[source]) )
     {
-        // Pawn is on the home row.
-
-        // Check for non-capture moves...
-        if ( board [ofs + SOUTH] == EMPTY )
-        {
-            // It can move one square forward...
-            ml.AddMove ( ofs, ofs + SOUTH );
-
-            // See if we can go two squares!
-            if ( board [ofs + 2*SOUTH] == EMPTY )
-                ml.AddMove ( ofs, ofs + 2*SOUTH );
-        }
-
-        // Check for capture moves...
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHEAST );
-
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHWEST );
+    case P_INDEX:   GenQuiets_P<Side> ( ml, source, OFFSET(2, source/NORTH) );   break;
+    case N_INDEX:   GenQuiets_N<Side> ( ml, source );   break;
+    case B_INDEX:   GenQuiets_B<Side> ( ml, source );   break;
+    case R_INDEX:   GenQuiets_R<Side> ( ml, source );   break;
+    case Q_INDEX:   GenQuiets_Q<Side> ( ml, source );   break;
+    case K_INDEX:   GenQuiets_K<Side> ( ml, source );   break;
     }
-    else if ( ybase == OFFSET(2,5) )
-    {
-        // Need to look for en passant captures on this rank.
-
-        if ( board [ofs + SOUTH] == EMPTY )
-            ml.AddMove ( ofs, ofs + SOUTH );
+}
 
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHEAST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(1,-2) &&
-                  prev_move.dest == ofs + OFFSET(1,0) &&
-                  (board [prev_move.dest] & WP_MASK) )
-            ml.AddMove ( ofs, SPECIAL_MOVE_EP_EAST );
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHWEST );
-        else if ( (prev_move.source & BOARD_OFFSET_MASK) == ofs + OFFSET(-1,-2) &&
-                  prev_move.dest == ofs + OFFSET(-1,0) &&
-                  (board [prev_move.dest] & WP_MASK) )
-            ml.AddMove ( ofs, SPECIAL_MOVE_EP_WEST );
-    }
-    else if ( ybase == OFFSET(2,3) )
-    {
-        // Pawn is one square away from promoting.  See if it can promote...
-        if ( board [ofs + SOUTH] == EMPTY )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_NORM | N_INDEX );
-        }
-
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_EAST | N_INDEX );
-        }
+template <class Side>
+void ChessBoard::GenQuiets_P ( MoveList &ml, int ofs, int ybase )
+{
+    // A pawn's only quiet moves are its advances short of promotion.
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-        {
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | Q_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | R_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | B_INDEX );
-            ml.AddMove ( ofs, SPECIAL_MOVE_PROMOTE_CAP_WEST | N_INDEX );
-        }
-    }
-    else
+    const int ahead = ofs + Side::Forward;
+    if ( ybase != OFFSET(2, Side::SeventhRank) && board [ahead] == EMPTY )
     {
-        // Normal pawn move away from home square...
-
-        if ( board [ofs + SOUTH] == EMPTY )
-            ml.AddMove ( ofs, ofs + SOUTH );
-
-        // Check for capture moves...
-        if ( board [ofs + SOUTHEAST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHEAST );
+        ml.AddMove ( ofs, ahead );
 
-        if ( board [ofs + SOUTHWEST] & WHITE_MASK )
-            ml.AddMove ( ofs, ofs + SOUTHWEST );
+        if ( ybase == OFFSET(2, Side::PawnRank) && board [ahead + Side::Forward] == EMPTY )
+            ml.AddMove ( ofs, ahead + Side::Forward );
     }
 }
 
 
-void ChessBoard::GenMoves_BN ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuiets_N ( MoveList &ml, int source )
 {
-    if ( (board [source + OFFSET(1,2)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(1,2)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(1,2) );
 
-    if ( (board [source + OFFSET(1,-2)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(1,-2)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(1,-2) );
 
-    if ( (board [source + OFFSET(-1,2)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(-1,2)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(-1,2) );
 
-    if ( (board [source + OFFSET(-1,-2)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(-1,-2)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(-1,-2) );
 
-    if ( (board [source + OFFSET(2,1)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(2,1)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(2,1) );
 
-    if ( (board [source + OFFSET(2,-1)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(2,-1)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(2,-1) );
 
-    if ( (board [source + OFFSET(-2,1)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(-2,1)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(-2,1) );
 
-    if ( (board [source + OFFSET(-2,-1)] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + OFFSET(-2,-1)] == EMPTY )
         ml.AddMove ( source, source + OFFSET(-2,-1) );
 }
 
 
-void ChessBoard::GenMoves_BB ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuiets_B ( MoveList &ml, int source )
 {
     int dest;
     for ( dest = source + NORTHEAST; board[dest] == EMPTY; dest += NORTHEAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + NORTHWEST; board[dest] == EMPTY; dest += NORTHWEST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + SOUTHEAST; board[dest] == EMPTY; dest += SOUTHEAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + SOUTHWEST; board[dest] == EMPTY; dest += SOUTHWEST )
         ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
 }
 
 
-void ChessBoard::GenMoves_BR ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuiets_R ( MoveList &ml, int source )
 {
     int dest;
     for ( dest = source + NORTH; board[dest] == EMPTY; dest += NORTH )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + WEST; board[dest] == EMPTY; dest += WEST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + EAST; board[dest] == EMPTY; dest += EAST )
         ml.AddMove ( source, dest );
 
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
     for ( dest = source + SOUTH; board[dest] == EMPTY; dest += SOUTH )
         ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
 }
 
 
-void ChessBoard::GenMoves_BQ ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuiets_Q ( MoveList &ml, int source )
 {
-    int dest;
-    for ( dest = source + NORTHEAST; board[dest] == EMPTY; dest += NORTHEAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + NORTHWEST; board[dest] == EMPTY; dest += NORTHWEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTHEAST; board[dest] == EMPTY; dest += SOUTHEAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTHWEST; board[dest] == EMPTY; dest += SOUTHWEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + NORTH; board[dest] == EMPTY; dest += NORTH )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + WEST; board[dest] == EMPTY; dest += WEST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + EAST; board[dest] == EMPTY; dest += EAST )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
-
-    for ( dest = source + SOUTH; board[dest] == EMPTY; dest += SOUTH )
-        ml.AddMove ( source, dest );
-
-    if ( board[dest] & WHITE_MASK )
-        ml.AddMove ( source, dest );
+    GenQuiets_B<Side> ( ml, source );
+    GenQuiets_R<Side> ( ml, source );
 }
 
 
-void ChessBoard::GenMoves_BK ( MoveList &ml, int source )
+template <class Side>
+void ChessBoard::GenQuiets_K ( MoveList &ml, int source )
 {
-    if ( (board [source + NORTH] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + NORTH] == EMPTY )
         ml.AddMove ( source, source + NORTH );
 
-    if ( (board [source + NORTHEAST] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + NORTHEAST] == EMPTY )
         ml.AddMove ( source, source + NORTHEAST );
 
-    if ( (board [source + NORTHWEST] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + NORTHWEST] == EMPTY )
         ml.AddMove ( source, source + NORTHWEST );
 
-    if ( (board [source + EAST] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + EAST] == EMPTY )
         ml.AddMove ( source, source + EAST );
 
-    if ( (board [source + WEST] & (BLACK_MASK | OFFBOARD)) == 0 )
+    if ( board [source + WEST] == EMPTY )
         ml.AddMove ( source, source + WEST );
 
-    if ( (board [source + SOUTHEAST] & (BLACK_MASK | OFFBOARD)) == 0 )
-        ml.AddMove ( source, source + SOUTHEAST);
-
-    if ( (board [source + SOUTHWEST] & (BLACK_MASK | OFFBOARD)) == 0 )
-        ml.AddMove ( source, source + SOUTHWEST);
+    if ( board [source + SOUTHEAST] == EMPTY )
+        ml.AddMove ( source, source + SOUTHEAST );
 
-    if ( (board [source + SOUTH] & (BLACK_MASK | OFFBOARD)) == 0 )
-        ml.AddMove ( source, source + SOUTH);
+    if ( board [source + SOUTHWEST] == EMPTY )
+        ml.AddMove ( source, source + SOUTHWEST );
 
-    // Check for castling...
-    if ( (flags & (SF_BKMOVED|SF_BCHECK)) == 0 )
-    {
-        // check for O-O
-        if (    (flags & SF_BKRMOVED) == 0       &&
-                (board [OFFSET(9,9)] & BR_MASK)  &&
-                board [OFFSET(8,9)] == EMPTY     &&
-                board [OFFSET(7,9)] == EMPTY     &&
-                !IsAttackedByWhite ( OFFSET(7,9) ) )
-            ml.AddMove ( source, SPECIAL_MOVE_KCASTLE );
+    if ( board [source + SOUTH] == EMPTY )
+        ml.AddMove ( source, source + SOUTH );
 
-        // check for O-O-O
-        if (    (flags & SF_BQRMOVED) == 0       &&
-                (board [OFFSET(2,9)] & BR_MASK)  &&
-                board [OFFSET(3,9)] == EMPTY     &&
-                board [OFFSET(4,9)] == EMPTY     &&
-                board [OFFSET(5,9)] == EMPTY     &&
-                !IsAttackedByWhite ( OFFSET(5,9) ) )
-            ml.AddMove ( source, SPECIAL_MOVE_QCASTLE );
-    }
+    GenCastling<Side> ( ml, source );
 }
 
 
-void ChessBoard::RemoveIllegalWhite (
+template <class Side>
+void ChessBoard::RemoveIllegal (
     MoveList &ml,
     ComputerChessPlayer *player )
 {
@@ -696,16 +576,11 @@ void ChessBoard::RemoveIllegalWhite (
     {
         for ( i=0, move = &ml.m[0]; i < ml.num; )
         {
-            MakeWhiteMove ( *move, unmove, true, true );
-            is_illegal = (flags & SF_WCHECK) ? true : false;
+            MakeMove<Side> ( *move, unmove, true, true );
+            is_illegal = (flags & Side::CheckFlag) ? true : false;
             if ( !is_illegal )
-            {
-                player->WhiteMoveOrdering (
-                    *this, *move, unmove,
-                    player->moveOrder_depth,
-                    player->moveOrder_bestPathFlag );
-            }
-            UnmakeWhiteMove ( *move, unmove );
+                Side::MoveOrdering ( player, *this, *move, unmove );
+            UnmakeMove<Side> ( *move, unmove );
 
             if ( is_illegal )
             {
@@ -722,15 +597,15 @@ void ChessBoard::RemoveIllegalWhite (
         {
             ml.Shuffle();
         }
-        ml.WhiteSort();
+        Side::Sort ( ml );
     }
     else
     {
         for ( i=0, move = &ml.m[0]; i < ml.num; )
         {
-            MakeWhiteMove ( *move, unmove, true, true );
-            is_illegal = (flags & SF_WCHECK) ? true : false;
-            UnmakeWhiteMove ( *move, unmove );
+            MakeMove<Side> ( *move, unmove, true, true );
+            is_illegal = (flags & Side::CheckFlag) ? true : false;
+            UnmakeMove<Side> ( *move, unmove );
 
             if ( is_illegal )
             {
@@ -748,69 +623,16 @@ void ChessBoard::RemoveIllegalWhite (
 }
 
 
-void ChessBoard::RemoveIllegalBlack (
-    MoveList            &ml,
-    ComputerChessPlayer *player )
-{
-    UnmoveInfo   unmove;
-    Move        *move;
-    int          i;
-    bool     is_illegal;
-
-    if ( player )
-    {
-        for ( i=0, move = &ml.m[0]; i < ml.num; )
-        {
-            MakeBlackMove ( *move, unmove, true, true );
-            is_illegal = (flags & SF_BCHECK) ? true : false;
-            if ( !is_illegal )
-            {
-                player->BlackMoveOrdering (
-                    *this, *move, unmove,
-                    player->moveOrder_depth,
-                    player->moveOrder_bestPathFlag );
-            }
-            UnmakeBlackMove ( *move, unmove );
-
-            if ( is_illegal )
-            {
-                if ( i < --(ml.num) )
-                    *move = ml.m [ml.num];   // Overwrite this move with the last move...
-            }
-            else
-            {
-                ++i;
-                ++move;
-            }
-        }
-        if (player->IsSearchRandomized())
-        {
-            ml.Shuffle();
-        }
-        ml.BlackSort();
-    }
-    else
-    {
-        for ( i=0, move = &ml.m[0]; i < ml.num; )
-        {
-            MakeBlackMove ( *move, unmove, true, true );
-            is_illegal = (flags & SF_BCHECK) ? true : false;
-            UnmakeBlackMove ( *move, unmove );
-
-            if ( is_illegal )
-            {
-                if ( i < --(ml.num) )
-                    *move = ml.m [ml.num];      // Overwrite this move with the last move...
-            }
-            else
-            {
-                move->score = 0;
-                ++i;
-                ++move;
-            }
-        }
-    }
-}
+template int  ChessBoard::GenPseudoMoves<WhiteSide> ( MoveList & );
+template int  ChessBoard::GenPseudoMoves<BlackSide> ( MoveList & );
+template int  ChessBoard::GenPseudoQuiets<WhiteSide> ( MoveList & );
+template int  ChessBoard::GenPseudoQuiets<BlackSide> ( MoveList & );
+template void ChessBoard::GenQuietsFrom<WhiteSide> ( MoveList &, int );
+template void ChessBoard::GenQuietsFrom<BlackSide> ( MoveList &, int );
+template bool ChessBoard::MoveIsPseudoLegal<WhiteSide> ( Move );
+template bool ChessBoard::MoveIsPseudoLegal<BlackSide> ( Move );
+template void ChessBoard::RemoveIllegal<WhiteSide> ( MoveList &, ComputerChessPlayer * );
+template void ChessBoard::RemoveIllegal<BlackSide> ( MoveList &, ComputerChessPlayer * );
 
 
 /*
@@ -8,31 +8,19 @@
 
 =======================================================================*/
 
-#include <sys/time.h>
+#include <chrono>
 #include "chess.h"
 
 
-static double GetAbsoluteTime()
-{
-    timeval now;
-    gettimeofday ( &now, 0 );
-    return 100.0*double(now.tv_sec) + double(now.tv_usec)/10000.0;
-}
-
-
 INT32 ChessTime()
 {
-    static double baseTime = 0;     // abs time at first call to ChessTime()
-    static bool firstCall = true;   // is this the first call to ChessTime()?
+    // Centiseconds since the first call, measured on a monotonic clock so
+    // that adjustments to the system time cannot make it jump.
 
-    if ( firstCall )
-    {
-        firstCall = false;
-        baseTime = GetAbsoluteTime();
-        return 0;
-    }
+    typedef std::chrono::steady_clock Clock;
+    static const Clock::time_point baseTime = Clock::now();
 
-    return INT32 ( GetAbsoluteTime() - baseTime );
+    return INT32 ( std::chrono::duration_cast<std::chrono::milliseconds> ( Clock::now() - baseTime ).count() / 10 );
 }
 
 
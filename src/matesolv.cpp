@@ -0,0 +1,429 @@
+/*===============================================================================
+
+    matesolv.cpp  -  Proof-number mate solver for Chenard.
+
+    Every node is scored from the point of view of its side to move by a
+    proof number phi (how many more leaves must be proven for the side to
+    move to win) and a disproof number delta (how many to show it loses).
+    A node's phi is the smallest delta among its children, and its delta
+    is the sum of its children's phi.  Expand() always descends into the
+    child with the smallest delta, and only as far as thresholds derived
+    from its siblings allow, so the search follows the most promising
+    line until a sibling looks better, then comes back later.
+
+    "Win" means something different for each side: the attacker (the side
+    to move at the root) wins only by checkmate within the allotted plies;
+    the defender wins by surviving them, including by stalemate.
+
+=============================================================================*/
+
+#include <string.h>
+
+#include "chess.h"
+#include "matesolv.h"
+
+
+static const UINT32 DFPN_INFINITY = 100000000;
+static const UINT32 NO_NODE_LIMIT = 0xffffffff;
+
+
+static inline UINT32 AddProof ( UINT32 a, UINT32 b )
+{
+    return (a >= DFPN_INFINITY - b) ? DFPN_INFINITY : (a + b);
+}
+
+
+MateSolver::MateSolver ( int tableSizeInMegabytes ):
+    table ( 0 ),
+    tableSize ( 0 ),
+    attackerIsWhite ( true ),
+    nodes ( 0 ),
+    nodeLimit ( 0 ),
+    nodeBudget ( NO_NODE_LIMIT ),
+    outOfNodes ( false ),
+    aborted ( false ),
+    stopToken ( 0 ),
+    mateLength ( 0 ),
+    shortest ( false ),
+    lineLength ( 0 )
+{
+    if ( tableSizeInMegabytes < 1 )
+        tableSizeInMegabytes = 1;
+
+    tableSize = UINT32 ( (tableSizeInMegabytes * 1024.0 * 1024.0) / sizeof(Entry) );
+    table = new Entry [tableSize];
+    memset ( table, 0, tableSize * sizeof(Entry) );
+}
+
+
+MateSolver::~MateSolver()
+{
+    delete[] table;
+    table = 0;
+}
+
+
+void MateSolver::AbortSearchCallback ( void *context )
+{
+    static_cast<MateSolver *>(context)->AbortSearch();
+}
+
+
+UINT64 MateSolver::NodeKey ( const ChessBoard &board, int remaining ) const
+{
+    // The same position with a different number of plies left, or a
+    // different attacker, is a different problem.
+    UINT64 key = board.Hash() ^ (UINT64(remaining + 1) * 0x9E3779B97F4A7C15ULL);
+    if ( !attackerIsWhite )
+        key = ~key;
+    return key ? key : 1;   // 0 marks an empty slot
+}
+
+
+bool MateSolver::Lookup ( UINT64 key, UINT32 &phi, UINT32 &delta ) const
+{
+    const Entry &entry = table [key % tableSize];
+    if ( entry.key != key )
+        return false;
+
+    phi = entry.phi;
+    delta = entry.delta;
+    return true;
+}
+
+
+void MateSolver::Store ( UINT64 key, UINT32 phi, UINT32 delta )
+{
+    Entry &entry = table [key % tableSize];
+    entry.key = key;
+    entry.phi = phi;
+    entry.delta = delta;
+}
+
+
+bool MateSolver::Prove ( ChessBoard &board, int moves, UINT32 budget )
+{
+    nodeBudget = budget;
+    outOfNodes = false;
+
+    UINT32 phi, delta;
+    Expand ( board, 2*moves - 1, DFPN_INFINITY, DFPN_INFINITY, phi, delta );
+    return phi == 0;
+}
+
+
+MateSolverResult MateSolver::Solve ( ChessBoard &board, int maxMoves )
+{
+    if ( maxMoves > MATE_SOLVER_MAX_MOVES )
+        maxMoves = MATE_SOLVER_MAX_MOVES;
+
+    attackerIsWhite = board.WhiteToMove();
+    nodes = 0;
+    aborted = false;
+    mateLength = 0;
+    shortest = false;
+    lineLength = 0;
+
+    if ( stopToken )
+        stopToken->addCallback ( AbortSearchCallback, this );   // aborts right away if already stopped
+
+    // Searching for the longest allowed mate first is much faster than
+    // working up from mate in 1: every shorter attempt would have to be
+    // refuted completely, and refutations are the expensive part.
+
+    const UINT32 limit = nodeLimit ? nodeLimit : NO_NODE_LIMIT;
+    MateSolverResult result = MATE_NOT_FOUND;
+
+    if ( maxMoves < 1 )
+    {
+        // nothing to prove
+    }
+    else if ( Prove ( board, maxMoves, limit ) )
+    {
+        // Now try for shorter mates, giving each try no more nodes than
+        // the first proof took, and stop at the first length refuted.
+
+        const UINT32 budget = nodes;
+        mateLength = maxMoves;
+        shortest = (mateLength == 1);
+        while ( !shortest && !aborted )
+        {
+            const UINT32 stopAt = (limit - nodes > budget) ? (nodes + budget) : limit;
+            if ( Prove ( board, mateLength-1, stopAt ) )
+                shortest = (--mateLength == 1);
+            else if ( !outOfNodes && !aborted )
+                shortest = true;
+            else
+                break;
+        }
+
+        nodeBudget = limit;
+        outOfNodes = false;
+        FindLine ( board, 2*mateLength - 1 );
+        result = MATE_FOUND;
+    }
+    else if ( aborted || outOfNodes )
+    {
+        result = MATE_UNKNOWN;
+    }
+
+    if ( stopToken )
+        stopToken->removeCallback ( AbortSearchCallback, this );
+
+    return result;
+}
+
+
+int MateSolver::QueryMateLine ( Move _line[], int maxPlies ) const
+{
+    int n = 0;
+    while ( n < lineLength && n < maxPlies )
+    {
+        _line[n] = line[n];
+        ++n;
+    }
+    return n;
+}
+
+
+void MateSolver::InitChildren (
+    ChessBoard &board,
+    int         remaining,
+    Children   &children )
+{
+    const bool attackerToMove = (board.WhiteToMove() == attackerIsWhite);
+    UnmoveInfo unmove;
+
+    for ( int i=0; i < children.ml.num; ++i )
+    {
+        Move move = children.ml.m[i];
+        UINT32 &phi = children.phi[i];
+        UINT32 &delta = children.delta[i];
+
+        if ( remaining == 1 && !(move.source & CAUSES_CHECK_BIT) )
+        {
+            // The attacker's last move can only mate if it checks.
+            phi = 0;
+            delta = DFPN_INFINITY;
+            continue;
+        }
+
+        board.MakeMove ( move, unmove );
+
+        const UINT64 key = NodeKey ( board, remaining-1 );
+        if ( !Lookup ( key, phi, delta ) )
+        {
+            if ( remaining == 1 )
+            {
+                // The attacker's last move: the defender is mated now or never.
+                if ( board.CurrentPlayerInCheck() && !board.CurrentPlayerCanMove() )
+                {
+                    phi = DFPN_INFINITY;
+                    delta = 0;
+                }
+                else
+                {
+                    phi = 0;
+                    delta = DFPN_INFINITY;
+                }
+                Store ( key, phi, delta );
+            }
+            else if ( attackerToMove )
+            {
+                // Checks leave the defender the fewest replies,
+                // so they are the cheapest moves to try first.
+                phi = 1;
+                delta = (move.source & CAUSES_CHECK_BIT) ? 1 : 2;
+            }
+            else
+            {
+                phi = delta = 1;
+            }
+        }
+
+        board.UnmakeMove ( move, unmove );
+    }
+}
+
+
+void MateSolver::Expand (
+    ChessBoard &board,
+    int         remaining,      // plies the attacker has left to deliver mate
+    UINT32      thPhi,
+    UINT32      thDelta,
+    UINT32     &phi,
+    UINT32     &delta )
+{
+    if ( ++nodes >= nodeBudget )
+        outOfNodes = true;
+
+    const UINT64 key = NodeKey ( board, remaining );
+
+    if ( remaining == 0 )
+    {
+        // Only the defender can run out of plies, and it has survived
+        // unless it is already checkmated.
+        if ( board.CurrentPlayerInCheck() && !board.CurrentPlayerCanMove() )
+        {
+            phi = DFPN_INFINITY;
+            delta = 0;
+        }
+        else
+        {
+            phi = 0;
+            delta = DFPN_INFINITY;
+        }
+        Store ( key, phi, delta );
+        return;
+    }
+
+    Children children;
+    board.GenMoves ( children.ml );
+    const int num = children.ml.num;
+    if ( num == 0 )
+    {
+        // Checkmate loses for whoever is to move.  Stalemate is as good as
+        // a win for the defender, and as bad as a loss for the attacker.
+        const bool attackerToMove = (board.WhiteToMove() == attackerIsWhite);
+        if ( attackerToMove || board.CurrentPlayerInCheck() )
+        {
+            phi = DFPN_INFINITY;
+            delta = 0;
+        }
+        else
+        {
+            phi = 0;
+            delta = DFPN_INFINITY;
+        }
+        Store ( key, phi, delta );
+        return;
+    }
+
+    InitChildren ( board, remaining, children );
+
+    for(;;)
+    {
+        UINT32 minDelta = DFPN_INFINITY;
+        UINT32 secondDelta = DFPN_INFINITY;
+        UINT32 sumPhi = 0;
+        int best = 0;
+
+        for ( int i=0; i < num; ++i )
+        {
+            sumPhi = AddProof ( sumPhi, children.phi[i] );
+            if ( children.delta[i] < minDelta )
+            {
+                secondDelta = minDelta;
+                minDelta = children.delta[i];
+                best = i;
+            }
+            else if ( children.delta[i] < secondDelta )
+            {
+                secondDelta = children.delta[i];
+            }
+        }
+
+        phi = minDelta;
+        delta = sumPhi;
+        if ( phi >= thPhi || delta >= thDelta || aborted || outOfNodes )
+            break;
+
+        // Search the best child until either it stops being the best
+        // (its delta passes the second best, with a little slack so we
+        // don't bounce between two close siblings), or this node reaches
+        // one of its own thresholds.
+
+        UINT32 childThPhi = AddProof ( thDelta - delta, children.phi[best] );
+        UINT32 childThDelta = AddProof ( secondDelta, secondDelta/4 + 1 );
+        if ( childThDelta > thPhi )
+            childThDelta = thPhi;
+
+        Move move = children.ml.m[best];
+        UnmoveInfo unmove;
+        board.MakeMove ( move, unmove );
+        Expand ( board, remaining-1, childThPhi, childThDelta, children.phi[best], children.delta[best] );
+        board.UnmakeMove ( move, unmove );
+    }
+
+    Store ( key, phi, delta );
+}
+
+
+bool MateSolver::FindLine ( ChessBoard &board, int remaining )
+{
+    // Follow the proven nodes in the table down to the checkmate.
+    // An entry that has been overwritten is simply proven again.
+
+    UnmoveInfo unmove [MATE_SOLVER_MAX_PLIES];
+    lineLength = 0;
+
+    while ( remaining > 0 && lineLength < MATE_SOLVER_MAX_PLIES )
+    {
+        MoveList ml;
+        board.GenMoves ( ml );
+        if ( ml.num == 0 )
+            break;
+
+        const bool attackerToMove = (board.WhiteToMove() == attackerIsWhite);
+        int choice = -1;
+        bool resists = false;   // does the defender's choice hold out longer than 2 plies less?
+        for ( int attempt=0; choice < 0 && attempt < 2; ++attempt )
+        {
+            if ( attempt > 0 )
+            {
+                UINT32 phi, delta;
+                Expand ( board, remaining, DFPN_INFINITY, DFPN_INFINITY, phi, delta );
+            }
+
+            for ( int i=0; !resists && i < ml.num; ++i )
+            {
+                Move move = ml.m[i];
+                UnmoveInfo childUnmove;
+                board.MakeMove ( move, childUnmove );
+
+                UINT32 phi, delta;
+                bool won;
+                if ( remaining == 1 )
+                    won = board.CurrentPlayerInCheck() && !board.CurrentPlayerCanMove();
+                else if ( !Lookup ( NodeKey ( board, remaining-1 ), phi, delta ) )
+                    won = false;
+                else if ( attackerToMove )
+                    won = (delta == 0);     // the defender cannot escape from here
+                else
+                    won = (phi == 0);       // the attacker still mates from here
+
+                if ( won && choice < 0 )
+                    choice = i;
+
+                // The attacker takes the first mating move, but the defender
+                // prefers a move that was refuted with 2 fewer plies left,
+                // so the line shows its best resistance.
+                if ( won && !attackerToMove && remaining >= 4 &&
+                     Lookup ( NodeKey ( board, remaining-3 ), phi, delta ) && phi == DFPN_INFINITY )
+                {
+                    choice = i;
+                    resists = true;
+                }
+
+                board.UnmakeMove ( move, childUnmove );
+                if ( attackerToMove && choice >= 0 )
+                    break;
+            }
+        }
+
+        if ( choice < 0 )
+            break;
+
+        Move move = ml.m[choice];
+        board.MakeMove ( move, unmove[lineLength] );
+        line[lineLength++] = move;
+        --remaining;
+    }
+
+    const bool mated = board.CurrentPlayerInCheck() && !board.CurrentPlayerCanMove();
+
+    for ( int i = lineLength-1; i >= 0; --i )
+        board.UnmakeMove ( line[i], unmove[i] );
+
+    return mated;
+}
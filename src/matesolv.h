@@ -0,0 +1,102 @@
+/*===============================================================================
+
+    matesolv.h  -  Proof-number mate solver for Chenard.
+
+    MateSolver answers "can the side to move force checkmate within N moves?"
+    without the evaluation function or the alpha-beta search.  It uses
+    depth-first proof-number search (df-pn): instead of searching every
+    move to a fixed depth, it keeps expanding whichever line is cheapest
+    to prove or refute, which is usually a forcing sequence of checks.
+    Deep mates that the normal search only stumbles upon take it a small
+    fraction of the time.
+
+=============================================================================*/
+#ifndef __ddc_chenard_matesolv_h
+#define __ddc_chenard_matesolv_h
+
+#include <atomic>
+
+#define MATE_SOLVER_MAX_MOVES    20     // upper limit for MateSolver::Solve
+#define MATE_SOLVER_MAX_PLIES    (2 * MATE_SOLVER_MAX_MOVES)
+
+
+enum MateSolverResult
+{
+    MATE_FOUND,         // the side to move mates in QueryMateLength() moves
+    MATE_NOT_FOUND,     // there is no forced mate within the requested number of moves
+    MATE_UNKNOWN        // gave up: node limit reached or search stopped
+};
+
+
+class MateSolver
+{
+public:
+    explicit MateSolver ( int tableSizeInMegabytes = 16 );
+    ~MateSolver();
+
+    // Looks for a checkmate by the side to move that takes at most
+    // 'maxMoves' of its own moves, then spends up to as many nodes again
+    // looking for shorter ones.  The board is left as it was found.
+    MateSolverResult Solve ( ChessBoard &board, int maxMoves );
+
+    // After MATE_FOUND: the number of moves the mating side needs, whether
+    // that is known to be the shortest mate, and the moves of one mating
+    // line (both sides, starting with the mating side).
+    int QueryMateLength() const { return mateLength; }
+    bool IsShortestMate() const { return shortest; }
+    int QueryMateLine ( Move line[], int maxPlies ) const;
+
+    UINT32 QueryNodes() const { return nodes; }
+
+    void SetNodeLimit ( UINT32 limit ) { nodeLimit = limit; }     // 0 = no limit
+    void AbortSearch() { aborted = true; }      // may be called from any thread
+
+    // Subsequent calls to Solve also stop when 'token' is stopped.  NULL for none.
+    void SetStopToken ( SearchStopToken *token ) { stopToken = token; }
+
+private:
+    struct Entry
+    {
+        UINT64  key;
+        UINT32  phi;        // proof number for the side to move
+        UINT32  delta;      // disproof number for the side to move
+    };
+
+    // Children of one node, kept on the stack while the node is expanded.
+    struct Children
+    {
+        MoveList    ml;
+        UINT32      phi   [MAX_MOVES];
+        UINT32      delta [MAX_MOVES];
+    };
+
+    Entry   *table;
+    UINT32   tableSize;
+    bool     attackerIsWhite;
+    UINT32   nodes;
+    UINT32   nodeLimit;
+    UINT32   nodeBudget;        // stop expanding here; nodeLimit or the budget for a shorter mate
+    bool     outOfNodes;
+    std::atomic<bool>  aborted;
+    SearchStopToken   *stopToken;
+    int      mateLength;
+    bool     shortest;
+    int      lineLength;
+    Move     line [MATE_SOLVER_MAX_PLIES];
+
+    MateSolver ( const MateSolver & );              // not implemented
+    MateSolver & operator= ( const MateSolver & );  // not implemented
+
+    static void AbortSearchCallback ( void *context );     // for SearchStopToken
+    UINT64 NodeKey ( const ChessBoard &, int remaining ) const;
+    bool Lookup ( UINT64 key, UINT32 &phi, UINT32 &delta ) const;
+    void Store ( UINT64 key, UINT32 phi, UINT32 delta );
+    bool Prove ( ChessBoard &, int moves, UINT32 budget );
+
+    void Expand ( ChessBoard &, int remaining, UINT32 thPhi, UINT32 thDelta, UINT32 &phi, UINT32 &delta );
+    void InitChildren ( ChessBoard &, int remaining, Children & );
+    bool FindLine ( ChessBoard &, int remaining );
+};
+
+
+#endif /* __ddc_chenard_matesolv_h */
@@ -0,0 +1,368 @@
+/*===============================================================================
+
+    microbench.cpp  -  Timings of Chenard's board primitives, one at a time.
+
+    A search benchmark (chenard --bench) tells whether the engine got
+    faster, but not which part did.  This program times each primitive the
+    search leans on, in isolation, over positions from real games, and
+    reports nanoseconds and CPU cycles per call.
+
+    Use:  microbench [millisecondsPerPrimitive]
+
+    Built by linux/mbuild.  Cycle counts come from the processor's time
+    stamp counter, so they are shown only on x86 processors.
+
+=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "chess.h"
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define MICROBENCH_CYCLES  1
+    static inline UINT64 ReadCycleCounter() { return __rdtsc(); }
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define MICROBENCH_CYCLES  1
+    static inline UINT64 ReadCycleCounter() { return __rdtsc(); }
+#else
+    #define MICROBENCH_CYCLES  0
+    static inline UINT64 ReadCycleCounter() { return 0; }
+#endif
+
+
+#define  MICROBENCH_DEFAULT_MILLIS   300
+
+
+// The corpus: every position from these games, in PGN notation.
+
+static const char * const MicroBenchGames[] =
+{
+    // Anderssen - Kieseritzky, London 1851
+    "e4 e5 f4 exf4 Bc4 Qh4+ Kf1 b5 Bxb5 Nf6 Nf3 Qh6 d3 Nh5 Nh4 Qg5 Nf5 c6 "
+    "g4 Nf6 Rg1 cxb5 h4 Qg6 h5 Qg5 Qf3 Ng8 Bxf4 Qf6 Nc3 Bc5 Nd5 Qxb2 Bd6 Bxg1 "
+    "e5 Qxa1+ Ke2 Na6 Nxg7+ Kd8 Qf6+ Nxf6 Be7#",
+
+    // Anderssen - Dufresne, Berlin 1852
+    "e4 e5 Nf3 Nc6 Bc4 Bc5 b4 Bxb4 c3 Ba5 d4 exd4 O-O d3 Qb3 Qf6 e5 Qg6 Re1 Nge7 "
+    "Ba3 b5 Qxb5 Rb8 Qa4 Bb6 Nbd2 Bb7 Ne4 Qf5 Bxd3 Qh5 Nf6+ gxf6 exf6 Rg8 "
+    "Rad1 Qxf3 Rxe7+ Nxe7 Qxd7+ Kxd7 Bf5+ Ke8 Bd7+ Kf8 Bxe7#",
+
+    // Morphy - Duke of Brunswick and Count Isouard, Paris 1858
+    "e4 e5 Nf3 d6 d4 Bg4 dxe5 Bxf3 Qxf3 dxe5 Bc4 Nf6 Qb3 Qe7 Nc3 c6 Bg5 b5 "
+    "Nxb5 cxb5 Bxb5+ Nbd7 O-O-O Rd8 Rxd7 Rxd7 Rd1 Qe6 Bxd7+ Nxd7 Qb8+ Nxb8 Rd8#",
+
+    // Reti - Tartakower, Vienna 1910
+    "e4 c6 d4 d5 Nc3 dxe4 Nxe4 Nf6 Qd3 e5 dxe5 Qa5+ Bd2 Qxe5 O-O-O Nxe4 "
+    "Qd8+ Kxd8 Bg5+ Kc7 Bd8#",
+
+    // Lasker - Thomas, London 1912
+    "d4 e6 Nf3 f5 Nc3 Nf6 Bg5 Be7 Bxf6 Bxf6 e4 fxe4 Nxe4 b6 Ne5 O-O Bd3 Bb7 "
+    "Qh5 Qe7 Qxh7+ Kxh7 Nxf6+ Kh6 Neg4+ Kg5 h4+ Kf4 g3+ Kf3 Be2+ Kg2 Rh2+ Kg1 Kd2#",
+};
+
+
+struct MicroBenchPosition
+{
+    ChessBoard  board;
+    MoveList    legal;
+    char        notation [MAX_MOVES][MAX_MOVE_STRLEN + 1];     // PGN of each legal move
+};
+
+
+class MicroBenchmark
+{
+public:
+    MicroBenchmark ( int _millis ):
+        millis ( _millis ),
+        player ( ui ),
+        table ( 16 ),
+        sink ( 0 )
+    {
+    }
+
+    bool LoadCorpus();
+    void Run();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef UINT64 (MicroBenchmark::*Pass)();     // runs once over the corpus, returns number of operations
+
+    int   millis;
+    ChessUI_Silent       ui;       // the evaluator needs a player, and a player needs a user interface
+    ComputerChessPlayer  player;
+    TranspositionTable   table;
+    std::vector<MicroBenchPosition *>  positions;       // all of them
+    std::vector<MicroBenchPosition *>  whiteToMove;     // the ones with White to move
+    volatile UINT64  sink;      // keeps the compiler from discarding results
+
+    void Time ( const char *name, Pass pass );
+
+    UINT64 GenMovesPass();
+    UINT64 GenCapturesPass();
+    UINT64 MakeUnmakePass();
+    UINT64 AttackPass();
+    UINT64 CanMovePass();
+    UINT64 EvalPass();
+    UINT64 TableStorePass();
+    UINT64 TableProbePass();
+    UINT64 FormatPass();
+    UINT64 ParsePass();
+};
+
+
+bool MicroBenchmark::LoadCorpus()
+{
+    const int numGames = int ( sizeof(MicroBenchGames) / sizeof(MicroBenchGames[0]) );
+    for ( int g=0; g < numGames; ++g )
+    {
+        ChessBoard board;
+        char text [1024];
+        strcpy ( text, MicroBenchGames[g] );
+        for ( char *token = strtok(text, " "); ; token = strtok(0, " ") )
+        {
+            MicroBenchPosition *p = new MicroBenchPosition;
+            p->board = board;
+            p->board.GenMoves ( p->legal );
+            for ( int i=0; i < p->legal.num; ++i )
+                FormatChessMove ( p->board, p->legal, p->legal.m[i], p->notation[i] );
+
+            positions.push_back ( p );
+            if ( p->board.WhiteToMove() )
+                whiteToMove.push_back ( p );
+
+            if ( !token )
+                break;
+
+            Move move;
+            UnmoveInfo unmove;
+            if ( !ParseFancyMove ( token, board, move ) )
+            {
+                fprintf ( stderr, "Error:  cannot parse move '%s' in game %d\n", token, g+1 );
+                return false;
+            }
+            board.MakeMove ( move, unmove );
+        }
+    }
+
+    printf ( "%d positions, %d with White to move.\n\n", int(positions.size()), int(whiteToMove.size()) );
+    return true;
+}
+
+
+void MicroBenchmark::Time ( const char *name, Pass pass )
+{
+    (this->*pass)();    // warm up the caches
+
+    UINT64 ops = 0;
+    const INT64 limit = INT64(millis) * 1000;
+    const Clock::time_point start = Clock::now();
+    const UINT64 startCycles = ReadCycleCounter();
+    INT64 elapsed;
+    do
+    {
+        ops += (this->*pass)();
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds> ( Clock::now() - start ).count();
+    }
+    while ( elapsed < limit );
+    const UINT64 cycles = ReadCycleCounter() - startCycles;
+
+    printf ( "%-30s %12llu %10.1lf", name, (unsigned long long) ops, (1000.0 * elapsed) / ops );
+    if ( MICROBENCH_CYCLES )
+        printf ( " %10.1lf", double(cycles) / ops );
+    printf ( "\n" );
+}
+
+
+void MicroBenchmark::Run()
+{
+    printf ( "%-30s %12s %10s%s\n", "Primitive", "Calls", "ns/call", MICROBENCH_CYCLES ? "  cycles/call" : "" );
+
+    Time ( "GenWhiteMoves",              &MicroBenchmark::GenMovesPass );
+    Time ( "GenWhiteCaptures",           &MicroBenchmark::GenCapturesPass );
+    Time ( "MakeWhiteMove+Unmake",       &MicroBenchmark::MakeUnmakePass );
+    Time ( "IsAttackedByWhite",          &MicroBenchmark::AttackPass );
+    Time ( "WhiteCanMove",               &MicroBenchmark::CanMovePass );
+    Time ( "CommonMidgameEval",          &MicroBenchmark::EvalPass );
+    Time ( "TranspositionTable store",   &MicroBenchmark::TableStorePass );
+    Time ( "TranspositionTable probe",   &MicroBenchmark::TableProbePass );
+    Time ( "FormatChessMove",            &MicroBenchmark::FormatPass );
+    Time ( "ParseMove",                  &MicroBenchmark::ParsePass );
+}
+
+
+UINT64 MicroBenchmark::GenMovesPass()
+{
+    MoveList ml;
+    for ( size_t i=0; i < whiteToMove.size(); ++i )
+        sink += whiteToMove[i]->board.GenWhiteMoves ( ml );
+    return whiteToMove.size();
+}
+
+
+UINT64 MicroBenchmark::GenCapturesPass()
+{
+    MoveList ml;
+    for ( size_t i=0; i < whiteToMove.size(); ++i )
+        sink += whiteToMove[i]->board.GenWhiteCaptures ( ml );
+    return whiteToMove.size();
+}
+
+
+UINT64 MicroBenchmark::MakeUnmakePass()
+{
+    UINT64 ops = 0;
+    UnmoveInfo unmove;
+    for ( size_t i=0; i < whiteToMove.size(); ++i )
+    {
+        MicroBenchPosition &p = *whiteToMove[i];
+        for ( int k=0; k < p.legal.num; ++k )
+        {
+            Move move = p.legal.m[k];
+            p.board.MakeWhiteMove ( move, unmove, true, true );
+            p.board.UnmakeWhiteMove ( move, unmove );
+        }
+        ops += p.legal.num;
+    }
+    return ops;
+}
+
+
+UINT64 MicroBenchmark::AttackPass()
+{
+    UINT64 attacked = 0;
+    for ( size_t i=0; i < positions.size(); ++i )
+    {
+        const ChessBoard &board = positions[i]->board;
+        for ( int y=2; y < 10; ++y )
+            for ( int x=2; x < 10; ++x )
+                attacked += board.IsAttackedByWhite ( OFFSET(x,y) );
+    }
+    sink += attacked;
+    return 64 * positions.size();
+}
+
+
+UINT64 MicroBenchmark::CanMovePass()
+{
+    for ( size_t i=0; i < whiteToMove.size(); ++i )
+        sink += whiteToMove[i]->board.WhiteCanMove();
+    return whiteToMove.size();
+}
+
+
+UINT64 MicroBenchmark::EvalPass()
+{
+    for ( size_t i=0; i < positions.size(); ++i )
+        sink += player.CommonMidgameEval ( positions[i]->board );
+    return positions.size();
+}
+
+
+UINT64 MicroBenchmark::TableStorePass()
+{
+    for ( size_t i=0; i < positions.size(); ++i )
+    {
+        MicroBenchPosition &p = *positions[i];
+        if ( p.legal.num == 0 )
+            continue;
+
+        if ( p.board.WhiteToMove() )
+            table.rememberWhiteMove ( p.board, 4, 2, p.legal.m[0], NEGINF, POSINF );
+        else
+            table.rememberBlackMove ( p.board, 4, 2, p.legal.m[0], NEGINF, POSINF );
+    }
+    return positions.size();
+}
+
+
+UINT64 MicroBenchmark::TableProbePass()
+{
+    TranspositionEntry copy;
+    for ( size_t i=0; i < positions.size(); ++i )
+    {
+        ChessBoard &board = positions[i]->board;
+        const TranspositionEntry *entry = table.locateMove ( board, copy );
+        sink += (entry != 0);
+    }
+    return positions.size();
+}
+
+
+UINT64 MicroBenchmark::FormatPass()
+{
+    UINT64 ops = 0;
+    char movestr [MAX_MOVE_STRLEN + 1];
+    for ( size_t i=0; i < positions.size(); ++i )
+    {
+        const MicroBenchPosition &p = *positions[i];
+        for ( int k=0; k < p.legal.num; ++k )
+        {
+            FormatChessMove ( p.board, p.legal.m[k], movestr );
+            sink += movestr[0];
+        }
+        ops += p.legal.num;
+    }
+    return ops;
+}
+
+
+UINT64 MicroBenchmark::ParsePass()
+{
+    UINT64 ops = 0;
+    Move move;
+    for ( size_t i=0; i < positions.size(); ++i )
+    {
+        MicroBenchPosition &p = *positions[i];
+        for ( int k=0; k < p.legal.num; ++k )
+            sink += ParseFancyMove ( p.notation[k], p.board, move );
+        ops += p.legal.num;
+    }
+    return ops;
+}
+
+
+int main ( int argc, const char *argv[] )
+{
+    int millis = MICROBENCH_DEFAULT_MILLIS;
+    if ( argc > 1 )
+    {
+        millis = atoi ( argv[1] );
+        if ( argc > 2 || millis < 1 )
+        {
+            fprintf ( stderr, "Use:  %s [millisecondsPerPrimitive]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    MicroBenchmark bench ( millis );
+    if ( !bench.LoadCorpus() )
+        return 1;
+
+    bench.Run();
+    return 0;
+}
+
+
+void ChessFatal ( const char *message )
+{
+    fprintf ( stderr, "Fatal chess engine error: %s\n", message );
+    exit ( 1 );
+}
+
+
+const char *GetWhitePlayerString()
+{
+    return "White Player";
+}
+
+
+const char *GetBlackPlayerString()
+{
+    return "Black Player";
+}
@@ -8,6 +8,7 @@
 
 #include "chess.h"
 #include "profiler.h"
+#include "side.h"
 
 #define  PREV_SQUARE_BONUS      (gene.v[73])
 #define  CHECK_BONUS            (gene.v[74])
@@ -197,6 +198,269 @@ void ComputerChessPlayer::BlackMoveOrdering (
 }
 
 
+//----------------------------------------------------------------------
+// Staged move picker for the interior search (ComputerChessPlayer::Search).
+// See the comments for MovePicker in chess.h.
+
+void ComputerChessPlayer::StartMovePicker (
+    MovePicker &picker,
+    int depth,
+    bool bestPathFlag )
+{
+    picker.stage = MPS_BEST_PATH;
+    picker.depth = depth;
+    picker.index = 0;
+    picker.numLegal = 0;
+    picker.numSpecial = 0;
+    picker.ml.num = 0;
+
+    // A zero source never matches a pseudo-legal move, so it disables a stage.
+
+    picker.bestPathMove.source = 0;
+    if ( bestPathFlag &&
+        depth <= currentBestPath.depth &&
+        depth < MAX_BESTPATH_DEPTH )
+        picker.bestPathMove = currentBestPath.m[depth];
+
+    picker.xposMove = moveOrder_xposBestMove;
+
+    picker.killerMove.source = 0;
+    if ( depth > 0 && depth < MAX_BESTPATH_DEPTH &&
+         depth <= nextBestPath[depth-1].depth )
+        picker.killerMove = nextBestPath[depth-1].m[depth];
+}
+
+
+template <class Side>
+bool ComputerChessPlayer::MoveIsLegal ( ChessBoard &board, Move &move )
+{
+    // Making the move with both check tests also records in move.source
+    // whether it checks the opponent, which the search relies on when it
+    // re-makes the move without the tests.
+
+    UnmoveInfo unmove;
+    move.source &= BOARD_OFFSET_MASK;
+    board.MakeMove<Side> ( move, unmove, true, true );
+    const bool legal = (board.flags & Side::CheckFlag) == 0;
+    board.UnmakeMove<Side> ( move, unmove );
+    return legal;
+}
+
+template bool ComputerChessPlayer::MoveIsLegal<WhiteSide> ( ChessBoard &, Move & );
+template bool ComputerChessPlayer::MoveIsLegal<BlackSide> ( ChessBoard &, Move & );
+
+
+template <class Side>
+void ComputerChessPlayer::PickerOrdering (
+    const ChessBoard &board,
+    Move &move )
+{
+#ifndef NO_SEARCH
+    PROFILER_ENTER(PX_MOVEORDER)
+
+    // Unlike WhiteMoveOrdering/BlackMoveOrdering, the move has not been
+    // made (or even tested for legality) yet, so everything here is read
+    // from the board before the move.  Captures and promotions are ordered
+    // by most valuable victim, then least valuable attacker, except that
+    // captures which lose the exchange come last.  Quiet moves get the
+    // same positional hints the other move ordering gives them.
+    //
+    // The score is worked out from the mover's point of view, then
+    // turned around for Black, since move scores favor White.
+
+    const int source = move.source & BOARD_OFFSET_MASK;
+    const SQUARE piece = board.board [source];
+    const SCORE *hist = Side::IsWhite ? whiteHist : blackHist;
+
+    if ( move.dest <= OFFSET(9,9) )
+    {
+        const SQUARE victim = board.board [move.dest];
+        if ( victim != EMPTY )
+        {
+            // Winning and even captures by MVV/LVA; losing captures
+            // go to the back of the stage, least bad first.
+            move.score = 8*RAW_PIECE_VALUE(victim) - UPIECE_INDEX(piece);
+            if ( RAW_PIECE_VALUE(piece) > RAW_PIECE_VALUE(victim) )
+            {
+                const SCORE see = board.CaptureSEE<Side> ( move );
+                if ( see < 0 )
+                    move.score = see;
+            }
+        }
+        else
+        {
+            move.score = -UPIECE_INDEX(piece);
+
+            if ( !(piece & Side::PawnMask) )
+            {
+                const SQUARE *p = & board.board [move.dest];
+                if ( (p[Side::PawnEast] | p[Side::PawnWest]) & Side::Opponent::PawnMask )
+                    move.score -= PAWN_DANGER_PENALTY;
+            }
+
+            if ( Side::AdvancesFromHome ( source, move.dest ) )
+                move.score += FORWARD_BONUS;
+
+            move.score += hist [ Side::HistoryIndex(move) ] >> HASH_HIST_SHIFT;
+        }
+    }
+    else
+    {
+        const int special = move.dest & SPECIAL_MOVE_MASK;
+        if ( special == SPECIAL_MOVE_KCASTLE ||
+             special == SPECIAL_MOVE_QCASTLE )
+        {
+            move.score = CASTLE_BONUS + (hist [ Side::HistoryIndex(move) ] >> HASH_HIST_SHIFT);
+        }
+        else if ( special == SPECIAL_MOVE_EP_EAST ||
+                  special == SPECIAL_MOVE_EP_WEST )
+        {
+            move.score = 8*PAWN_VAL;
+        }
+        else
+        {
+            SCORE gain = RawPieceValues [move.dest & PIECE_MASK] - PAWN_VAL;
+            if ( special == SPECIAL_MOVE_PROMOTE_CAP_EAST )
+                gain += RAW_PIECE_VALUE ( board.board [source + Side::PawnEast] );
+            else if ( special == SPECIAL_MOVE_PROMOTE_CAP_WEST )
+                gain += RAW_PIECE_VALUE ( board.board [source + Side::PawnWest] );
+
+            move.score = 8*gain;
+        }
+    }
+
+    if ( !Side::IsWhite )
+        move.score = -move.score;
+
+    PROFILER_EXIT();
+#endif
+}
+
+
+template <class Side>
+bool ComputerChessPlayer::NextMove (
+    ChessBoard &board,
+    MovePicker &picker,
+    Move &move )
+{
+    int i, keep, stageMoves;
+
+    for(;;)
+    {
+        switch ( picker.stage )
+        {
+        case MPS_BEST_PATH:
+            picker.stage = MPS_XPOS;
+            move = picker.bestPathMove;
+            if ( board.MoveIsPseudoLegal<Side>(move) && MoveIsLegal<Side>(board,move) )
+            {
+                picker.special [picker.numSpecial++] = move;
+                ++picker.numLegal;
+                return true;
+            }
+            break;
+
+        case MPS_XPOS:
+            picker.stage = MPS_GEN_CAPTURES;
+            move = picker.xposMove;
+            if ( !picker.AlreadyTried(move) &&
+                 board.MoveIsPseudoLegal<Side>(move) &&
+                 MoveIsLegal<Side>(board,move) )
+            {
+                picker.special [picker.numSpecial++] = move;
+                ++picker.numLegal;
+                return true;
+            }
+            break;
+
+        case MPS_GEN_CAPTURES:
+        case MPS_GEN_QUIET:
+            if ( picker.stage == MPS_GEN_CAPTURES )
+                stageMoves = board.GenPseudoCaptures<Side> ( picker.ml );
+            else
+                stageMoves = board.GenPseudoQuiets<Side> ( picker.ml );
+
+            for ( i = keep = 0; i < picker.ml.num; ++i )
+            {
+                Move &m = picker.ml.m[i];
+                if ( !picker.AlreadyTried(m) )
+                {
+                    PickerOrdering<Side> ( board, m );
+                    picker.ml.m[keep++] = m;
+                }
+            }
+            picker.ml.num = keep;
+
+            generated += stageMoves;
+            if ( picker.depth < NODES_ARRAY_SIZE )
+                gennodes[picker.depth] += stageMoves;
+            picker.index = 0;
+            picker.stage = (picker.stage == MPS_GEN_CAPTURES) ? MPS_CAPTURES : MPS_QUIET;
+            break;
+
+        case MPS_CAPTURES:
+        case MPS_QUIET:
+            while ( picker.index < picker.ml.num )
+            {
+                picker.Select<Side>();
+                move = picker.ml.m [picker.index++];
+                if ( MoveIsLegal<Side>(board,move) )
+                {
+                    ++picker.numLegal;
+                    return true;
+                }
+            }
+            picker.stage = (picker.stage == MPS_CAPTURES) ? MPS_KILLER : MPS_DONE;
+            break;
+
+        case MPS_KILLER:
+            picker.stage = MPS_GEN_QUIET;
+            move = picker.killerMove;
+
+            // A killer that captures was already tried with the captures.
+            if ( (move.dest <= OFFSET(9,9))
+                    ? (board.board[move.dest] == EMPTY)
+                    : ((move.dest & SPECIAL_MOVE_MASK) == SPECIAL_MOVE_KCASTLE ||
+                       (move.dest & SPECIAL_MOVE_MASK) == SPECIAL_MOVE_QCASTLE) )
+            {
+                if ( !picker.AlreadyTried(move) &&
+                     board.MoveIsPseudoLegal<Side>(move) &&
+                     MoveIsLegal<Side>(board,move) )
+                {
+                    picker.special [picker.numSpecial++] = move;
+                    ++picker.numLegal;
+                    return true;
+                }
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
+
+template bool ComputerChessPlayer::NextMove<WhiteSide> ( ChessBoard &, MovePicker &, Move & );
+template bool ComputerChessPlayer::NextMove<BlackSide> ( ChessBoard &, MovePicker &, Move & );
+
+
+template <class Side>
+void MovePicker::Select()
+{
+    int besti = index;
+    for ( int i = index + 1; i < ml.num; ++i )
+        if ( Side::Better ( ml.m[i].score, ml.m[besti].score ) )
+            besti = i;
+
+    if ( besti != index )
+    {
+        Move t = ml.m[index];
+        ml.m[index] = ml.m[besti];
+        ml.m[besti] = t;
+    }
+}
+
+
 //----------------------------------------------------------------------
 
 void MoveList::WhiteSort()
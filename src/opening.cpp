@@ -136,6 +136,7 @@ bool OB_FindMove (
 
 bool OB_FindContinuation (
     ChessBoard &board,
+    ChessBoard &localBoard,     // scratch board supplied by caller
     big &oindex )
 {
     // Start from beginning of game and try to find the continuation
@@ -145,7 +146,6 @@ bool OB_FindContinuation (
     int plyIndex;
     oindex = 0;
 
-    static ChessBoard localBoard;
     localBoard.Init();
 
     for ( plyIndex=0; plyIndex < currentPly; plyIndex++ )
@@ -219,7 +219,7 @@ bool ComputerChessPlayer::WhiteOpening (
     bool foundMove = false;
 
     big nodeIndex = 0;
-    if ( OB_FindContinuation ( board, nodeIndex ) )
+    if ( OB_FindContinuation ( board, engine.GetOpeningBookBoard(), nodeIndex ) )
         if ( OB_PickMove ( nodeIndex, bestmove, board ) )
             foundMove = true;
 
@@ -249,7 +249,7 @@ bool ComputerChessPlayer::BlackOpening (
     bool foundMove = false;
 
     big nodeIndex;
-    if ( OB_FindContinuation ( board, nodeIndex ) )
+    if ( OB_FindContinuation ( board, engine.GetOpeningBookBoard(), nodeIndex ) )
         if ( OB_PickMove ( nodeIndex, bestmove, board ) )
             foundMove = true;
 
@@ -0,0 +1,229 @@
+/*===============================================================================
+
+    perft.cpp  -  Move generator test for Chenard.
+
+    "chenard --perft fen depth [threads] [hashMB]" counts the leaves of the
+    tree of legal moves to the given depth, and prints the count below each
+    root move ("divide"), so a wrong count can be narrowed down to a move.
+    The totals for well-known positions are published, which makes this the
+    quickest check that the move generator and MakeMove/UnmakeMove agree
+    with the rules, and a measure of how fast they are.
+
+    - Leaves are not visited: at depth 1 the number of legal moves is the
+      count (bulk counting).
+    - Root moves are shared out among the threads, each with its own board.
+    - With hashMB > 0, the counts of subtrees are remembered in a table
+      shared by all threads, so transpositions are counted only once.
+
+=============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "chess.h"
+
+
+// A table of subtree counts that threads can share without locks.  Each
+// entry stores its key XORed with its count, so an entry torn by two
+// threads writing it at the same time just fails to match.
+
+class PerftTable
+{
+public:
+    explicit PerftTable ( int megabytes ):
+        size ( (size_t(ClampMegabytes(megabytes)) << 20) / sizeof(Entry) ),
+        table ( new Entry [size] )
+    {
+        for ( size_t i=0; i < size; ++i )
+        {
+            table[i].check = 0;
+            table[i].count = 0;
+        }
+    }
+
+    ~PerftTable()
+    {
+        delete[] table;
+    }
+
+    bool lookup ( UINT64 key, UINT64 &count ) const
+    {
+        const Entry &entry = table [key % size];
+        const UINT64 c = entry.count.load ( std::memory_order_relaxed );
+        if ( (entry.check.load ( std::memory_order_relaxed ) ^ c) != key )
+            return false;
+
+        count = c;
+        return true;
+    }
+
+    void store ( UINT64 key, UINT64 count )
+    {
+        Entry &entry = table [key % size];
+        entry.check.store ( key ^ count, std::memory_order_relaxed );
+        entry.count.store ( count, std::memory_order_relaxed );
+    }
+
+private:
+    static int ClampMegabytes ( int megabytes )
+    {
+        if ( sizeof(size_t) < 8 && megabytes > 1024 )
+            return 1024;    // enforce a 1GB limit to avoid integer overflow on 32-bit platforms
+
+        return megabytes;
+    }
+
+    struct Entry
+    {
+        std::atomic<UINT64>  check;     // key ^ count
+        std::atomic<UINT64>  count;
+    };
+
+    size_t  size;
+    Entry  *table;
+
+    PerftTable ( const PerftTable & );              // not implemented
+    PerftTable & operator= ( const PerftTable & );  // not implemented
+};
+
+
+static UINT64 PerftKey ( const ChessBoard &board, int depth )
+{
+    // The same position counts differently at different depths.
+    UINT64 key = board.Hash() ^ (UINT64(depth) * 0x9E3779B97F4A7C15ULL);
+    return key ? key : 1;   // an empty entry must never match
+}
+
+
+static UINT64 Perft ( ChessBoard &board, int depth, PerftTable *table )
+{
+    UINT64 key = 0;
+    UINT64 count = 0;
+    if ( table && depth > 1 )
+    {
+        key = PerftKey ( board, depth );
+        if ( table->lookup ( key, count ) )
+            return count;
+    }
+
+    MoveList ml;
+    board.GenMoves ( ml );
+    if ( depth <= 1 )
+        return ml.num;
+
+    UnmoveInfo unmove;
+    for ( int i=0; i < ml.num; ++i )
+    {
+        board.MakeMove ( ml.m[i], unmove );
+        count += Perft ( board, depth-1, table );
+        board.UnmakeMove ( ml.m[i], unmove );
+    }
+
+    if ( table )
+        table->store ( key, count );
+
+    return count;
+}
+
+
+struct PerftRootMove
+{
+    Move    move;
+    char    notation [LONGMOVE_MAX_CHARS];
+    UINT64  count;
+};
+
+
+static bool PerftRootOrder ( const PerftRootMove &a, const PerftRootMove &b )
+{
+    return strcmp ( a.notation, b.notation ) < 0;
+}
+
+
+static void PerftWorker (
+    ChessBoard                   board,     // each thread gets its own copy
+    int                          depth,
+    PerftTable                  *table,
+    std::vector<PerftRootMove>  &root,
+    std::atomic<int>            &next )
+{
+    int i;
+    while ( (i = next++) < int(root.size()) )
+    {
+        UnmoveInfo unmove;
+        board.MakeMove ( root[i].move, unmove );
+        root[i].count = Perft ( board, depth-1, table );
+        board.UnmakeMove ( root[i].move, unmove );
+    }
+}
+
+
+int RunPerft (
+    const char *fen,
+    int depth,
+    int numThreads,
+    int hashMegabytes )     // 0 = no table
+{
+    typedef std::chrono::steady_clock Clock;
+
+    ChessBoard board;
+    if ( !board.SetForsythEdwardsNotation ( fen ) )
+    {
+        fprintf ( stderr, "Error:  Invalid FEN '%s'\n", fen );
+        return 1;
+    }
+
+    MoveList ml;
+    board.GenMoves ( ml );
+
+    std::vector<PerftRootMove> root ( ml.num );
+    for ( int i=0; i < ml.num; ++i )
+    {
+        root[i].move = ml.m[i];
+        root[i].count = 1;      // what depth 1 comes to
+        FormatLongMove ( board.WhiteToMove(), ml.m[i], root[i].notation );
+    }
+
+    PerftTable *table = (hashMegabytes > 0) ? new PerftTable ( hashMegabytes ) : 0;
+
+    const Clock::time_point start = Clock::now();
+    if ( depth > 1 )
+    {
+        std::atomic<int> next ( 0 );
+        std::vector<std::thread> threads;
+        for ( int t=1; t < numThreads; ++t )
+            threads.push_back ( std::thread ( PerftWorker, board, depth, table, std::ref(root), std::ref(next) ) );
+
+        PerftWorker ( board, depth, table, root, next );
+
+        for ( size_t t=0; t < threads.size(); ++t )
+            threads[t].join();
+    }
+    const INT64 microseconds = std::chrono::duration_cast<std::chrono::microseconds> ( Clock::now() - start ).count();
+
+    delete table;
+
+    std::sort ( root.begin(), root.end(), PerftRootOrder );
+
+    UINT64 total = 0;
+    for ( size_t i=0; i < root.size(); ++i )
+    {
+        printf ( "%s: %llu\n", root[i].notation, (unsigned long long) root[i].count );
+        total += root[i].count;
+    }
+
+    const double seconds = microseconds / 1.0e+6;
+    printf ( "\n" );
+    printf ( "Moves:  %d\n", ml.num );
+    printf ( "Nodes:  %llu\n", (unsigned long long) total );
+    printf ( "Time:   %0.3lf seconds\n", seconds );
+    if ( microseconds > 0 )
+        printf ( "Speed:  %0.0lf nodes/second\n", total / seconds );
+
+    return 0;
+}
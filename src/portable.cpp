@@ -16,12 +16,31 @@
 #include "chenga.h"
 #include "uistdio.h"
 #include "lrntree.h"
+#include "matesolv.h"
 
 
+int SolveMateProblem (
+    int maxMoves,
+    const char *fen );
+
+int RunBenchmark (          // see bench.cpp
+    int depth,
+    int numThreads,
+    int hashMegabytes );
+
+int RunPerft (              // see perft.cpp
+    const char *fen,
+    int depth,
+    int numThreads,
+    int hashMegabytes );
+
+int RunSelfTest();          // see selftest.cpp
+
 int AnalyzeGameFile (
     double thinkTimeInSeconds,
     const char *inGameFilename,
-    const char *outListFilename );
+    const char *outListFilename,
+    int multiPV );
 
 const char * const CHENARD_VERSION = ConvertDateToVersion(__DATE__);
 
@@ -333,6 +352,43 @@ int main ( int argc, const char *argv[] )
 
     Advertise();
 
+    // Options that configure the engine may come before any of the modes below.
+    while ( argc >= 3 && argv[1][0] == '-' )
+    {
+        if ( strcmp ( argv[1], "--threads" ) == 0 )
+        {
+            const int numThreads = atoi ( argv[2] );
+            if ( numThreads < 1 || numThreads > MAX_SEARCH_THREADS )
+            {
+                fprintf ( stderr, "Invalid thread count '%s'\n", argv[2] );
+                return 1;
+            }
+            ChessEngineContext::Default().SetDefaultThreadCount ( numThreads );
+        }
+        else if ( strcmp ( argv[1], "--hash" ) == 0 )
+        {
+            const int megabytes = atoi ( argv[2] );
+            if ( megabytes < 1 || megabytes > MAX_XPOS_MEGABYTES )
+            {
+                fprintf ( stderr, "Invalid hash table size '%s' (megabytes)\n", argv[2] );
+                return 1;
+            }
+            ChessEngineContext::Default().SetTranspositionTableSize ( megabytes );
+        }
+        else if ( strcmp ( argv[1], "--stats" ) == 0 )
+        {
+            // Append the statistics of every search to a file, one line of JSON each.
+            theUserInterface.SetStatsFilename ( argv[2] );
+        }
+        else
+            break;
+
+        // Remove the option from the command line, keeping the program name in argv[0].
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
     if ( argc == 1 ||
          (argc>1 && argv[1][0] != '-') )
     {
@@ -590,12 +646,12 @@ int main ( int argc, const char *argv[] )
         }
         else if ( strcmp ( argv[1], "-a" ) == 0 )
         {
-            // chenard -a thinkTimeSeconds inGameFile outListingFile
+            // chenard -a thinkTimeSeconds inGameFile outListingFile [numLines]
 
-            if ( argc != 5 )
+            if ( argc != 5 && argc != 6 )
             {
                 fprintf ( stderr,
-                          "Use:  %s -a thinkTimeSeconds inGameFile outListingFile\n\n",
+                          "Use:  %s -a thinkTimeSeconds inGameFile outListingFile [numLines]\n\n",
                           argv[0] );
 
                 return 0;
@@ -611,9 +667,128 @@ int main ( int argc, const char *argv[] )
                 return 1;
             }
 
+            int multiPV = 1;
+            if ( argc == 6 )
+            {
+                multiPV = atoi ( argv[5] );
+                if ( multiPV < 1 || multiPV > MAX_MULTI_PV )
+                {
+                    fprintf ( stderr,
+                              "Invalid number of lines '%s': must be 1..%d\n",
+                              argv[5],
+                              MAX_MULTI_PV );
+
+                    return 1;
+                }
+            }
+
             const char *inGameFilename = argv[3];
             const char *outListFilename = argv[4];
-            return AnalyzeGameFile ( thinkTimeSeconds, inGameFilename, outListFilename );
+            return AnalyzeGameFile ( thinkTimeSeconds, inGameFilename, outListFilename, multiPV );
+        }
+        else if ( strcmp ( argv[1], "--mate" ) == 0 )
+        {
+            // chenard --mate N "fen"
+
+            if ( argc != 4 )
+            {
+                fprintf ( stderr,
+                          "Use:  %s --mate N \"fen\"\n\n",
+                          argv[0] );
+
+                return 1;
+            }
+
+            const int maxMoves = atoi ( argv[2] );
+            if ( maxMoves < 1 || maxMoves > MATE_SOLVER_MAX_MOVES )
+            {
+                fprintf ( stderr,
+                          "Invalid number of moves '%s': must be 1..%d\n",
+                          argv[2],
+                          MATE_SOLVER_MAX_MOVES );
+
+                return 1;
+            }
+
+            return SolveMateProblem ( maxMoves, argv[3] );
+        }
+        else if ( strcmp ( argv[1], "--bench" ) == 0 )
+        {
+            // chenard --bench [depth] [threads] [hashMB]
+
+            if ( argc > 5 )
+            {
+                fprintf ( stderr,
+                          "Use:  %s --bench [depth] [threads] [hashMB]\n\n",
+                          argv[0] );
+
+                return 1;
+            }
+
+            const int depth = (argc > 2) ? atoi ( argv[2] ) : 0;
+            const int numThreads = (argc > 3) ? atoi ( argv[3] ) : 1;
+            const int megabytes = (argc > 4) ? atoi ( argv[4] ) : 0;
+
+            if ( argc > 2 && (depth < 1 || depth > NODES_ARRAY_SIZE/4 - 1) )
+            {
+                fprintf ( stderr, "Invalid search depth '%s'\n", argv[2] );
+                return 1;
+            }
+
+            if ( numThreads < 1 || numThreads > MAX_SEARCH_THREADS )
+            {
+                fprintf ( stderr, "Invalid thread count '%s'\n", argv[3] );
+                return 1;
+            }
+
+            if ( argc > 4 && (megabytes < 1 || megabytes > MAX_XPOS_MEGABYTES) )
+            {
+                fprintf ( stderr, "Invalid hash table size '%s' (megabytes)\n", argv[4] );
+                return 1;
+            }
+
+            return RunBenchmark ( depth, numThreads, megabytes );
+        }
+        else if ( strcmp ( argv[1], "--perft" ) == 0 )
+        {
+            // chenard --perft "fen" depth [threads] [hashMB]
+
+            if ( argc < 4 || argc > 6 )
+            {
+                fprintf ( stderr,
+                          "Use:  %s --perft \"fen\" depth [threads] [hashMB]\n\n",
+                          argv[0] );
+
+                return 1;
+            }
+
+            const int depth = atoi ( argv[3] );
+            const int numThreads = (argc > 4) ? atoi ( argv[4] ) : 1;
+            const int megabytes = (argc > 5) ? atoi ( argv[5] ) : 0;
+
+            if ( depth < 1 )
+            {
+                fprintf ( stderr, "Invalid depth '%s'\n", argv[3] );
+                return 1;
+            }
+
+            if ( numThreads < 1 || numThreads > MAX_SEARCH_THREADS )
+            {
+                fprintf ( stderr, "Invalid thread count '%s'\n", argv[4] );
+                return 1;
+            }
+
+            if ( megabytes < 0 || megabytes > MAX_XPOS_MEGABYTES )
+            {
+                fprintf ( stderr, "Invalid hash table size '%s' (megabytes)\n", argv[5] );
+                return 1;
+            }
+
+            return RunPerft ( argv[2], depth, numThreads, megabytes );
+        }
+        else if ( strcmp ( argv[1], "--selftest" ) == 0 )
+        {
+            return RunSelfTest();
         }
         else if (strcmp(argv[1], "--flytest") == 0)
         {
@@ -646,6 +821,27 @@ int main ( int argc, const char *argv[] )
             fprintf ( stderr,
                       "The option '-s' causes Chenard to play against itself.\n" );
 
+            fprintf ( stderr,
+                      "Put '--threads n' before any other option to search using n threads.\n" );
+
+            fprintf ( stderr,
+                      "Put '--hash MB' before any other option to set the transposition table size.\n" );
+
+            fprintf ( stderr,
+                      "Put '--stats file' before any other option to append search statistics to a file as JSON.\n" );
+
+            fprintf ( stderr,
+                      "Use '%s --mate N \"fen\"' to look for a mate in N moves.\n", argv[0] );
+
+            fprintf ( stderr,
+                      "Use '%s --bench [depth] [threads] [hashMB]' to measure search speed.\n", argv[0] );
+
+            fprintf ( stderr,
+                      "Use '%s --perft \"fen\" depth [threads] [hashMB]' to test the move generator.\n", argv[0] );
+
+            fprintf ( stderr,
+                      "Use '%s --selftest' to run the regression tests.\n", argv[0] );
+
             return 1;
         }
     }
@@ -654,6 +850,56 @@ int main ( int argc, const char *argv[] )
 }
 
 
+int SolveMateProblem (
+    int maxMoves,
+    const char *fen )
+{
+    ChessBoard board;
+    if ( !board.SetForsythEdwardsNotation ( fen ) )
+    {
+        fprintf ( stderr, "Error:  Invalid FEN '%s'\n", fen );
+        return 1;
+    }
+
+    MateSolver solver;
+    const INT32 startTime = ChessTime();
+    MateSolverResult result = solver.Solve ( board, maxMoves );
+    const INT32 elapsed = ChessTime() - startTime;
+
+    switch ( result )
+    {
+        case MATE_FOUND:
+        {
+            printf ( "Mate in %s%d:", (solver.IsShortestMate() ? "" : "at most "), solver.QueryMateLength() );
+
+            Move line [MATE_SOLVER_MAX_PLIES];
+            const int numPlies = solver.QueryMateLine ( line, MATE_SOLVER_MAX_PLIES );
+            char moveString [64];
+            UnmoveInfo unmove;
+            for ( int i=0; i < numPlies; ++i )
+            {
+                FormatChessMove ( board, line[i], moveString );
+                printf ( " %s", moveString );
+                board.MakeMove ( line[i], unmove );
+            }
+            printf ( "\n" );
+        }
+        break;
+
+        case MATE_NOT_FOUND:
+            printf ( "No mate in %d.\n", maxMoves );
+            break;
+
+        default:
+            printf ( "Search stopped before finding an answer.\n" );
+            break;
+    }
+
+    printf ( "%u nodes in %0.2lf seconds.\n", unsigned(solver.QueryNodes()), 0.01 * elapsed );
+    return 0;
+}
+
+
 class ChessUI_stdio_InterceptBestPath: public ChessUI_stdio
 {
 public:
@@ -692,47 +938,75 @@ void ChessUI_stdio_InterceptBestPath::DisplayBestPath (
 }
 
 
-void AnalyzePosition (
-    ChessUI_stdio_InterceptBestPath &ui,
-    ComputerChessPlayer &thinker,
-    ChessBoard &_board,
+static void PrintAnalysisLine (
+    const ChessBoard &_board,
+    const BestPath &path,
+    SCORE score,
     FILE *listFile,
     int column )
 {
-    INT32 timeSpent = 0;
-    Move bestMove;
-    bool gotMove = thinker.GetMove ( _board, bestMove, timeSpent );
-
     char moveString [64];
     ChessBoard board = _board;
 
-    const BestPath &path = ui.snagBestPath;
-    if ( gotMove && path.depth >= 0 )
+    column += fprintf ( listFile, "[%d: ", int(score) );
+
+    for ( int i=0; i <= path.depth; i++ )
     {
-        column += fprintf ( listFile, "[%d: ", int(bestMove.score) );
+        Move move = path.m[i];
+        UnmoveInfo unmove;
+
+        FormatChessMove ( board, move, moveString );
+        board.MakeMove ( move, unmove );
 
-        for ( int i=0; i <= path.depth; i++ )
+        int newcol = (int) (column + strlen(moveString) + 2);
+        if ( newcol > 78 )
         {
-            Move move = path.m[i];
-            UnmoveInfo unmove;
+            fprintf ( listFile, "\n" );
+            column = fprintf ( listFile, "                   " );
+        }
 
-            FormatChessMove ( board, move, moveString );
-            board.MakeMove ( move, unmove );
+        column += fprintf ( listFile, "%s", moveString );
 
-            int newcol = (int) (column + strlen(moveString) + 2);
-            if ( newcol > 78 )
-            {
-                fprintf ( listFile, "\n" );
-                column = fprintf ( listFile, "                   " );
-            }
+        if ( i < path.depth )
+            column += fprintf ( listFile, ", " );
+    }
 
-            column += fprintf ( listFile, "%s", moveString );
+    column += fprintf ( listFile, "]" );
+}
 
-            if ( i < path.depth )
-                column += fprintf ( listFile, ", " );
-        }
 
-        column += fprintf ( listFile, "]" );
+void AnalyzePosition (
+    ChessUI_stdio_InterceptBestPath &ui,
+    ComputerChessPlayer &thinker,
+    ChessBoard &board,
+    FILE *listFile,
+    int column )
+{
+    INT32 timeSpent = 0;
+    Move bestMove;
+    bool gotMove = thinker.GetMove ( board, bestMove, timeSpent );
+    if ( !gotMove )
+        return;
+
+    BestPath lines [MAX_MULTI_PV];
+    int numLines = 0;
+    if ( thinker.QueryMultiPV() > 1 )
+        numLines = thinker.GetPrincipalVariations ( lines, MAX_MULTI_PV );
+
+    if ( numLines > 1 )
+    {
+        // Each line after the first goes on a row of its own, lined up under the first.
+        for ( int i=0; i < numLines; ++i )
+        {
+            if ( i > 0 )
+                fprintf ( listFile, "\n%*s", column, "" );
+
+            PrintAnalysisLine ( board, lines[i], lines[i].m[0].score, listFile, column );
+        }
+    }
+    else if ( ui.snagBestPath.depth >= 0 )
+    {
+        PrintAnalysisLine ( board, ui.snagBestPath, bestMove.score, listFile, column );
     }
 }
 
@@ -740,7 +1014,8 @@ void AnalyzePosition (
 int AnalyzeGameFile (
     double thinkTimeInSeconds,
     const char *inGameFilename,
-    const char *outListFilename )
+    const char *outListFilename,
+    int multiPV )
 {
     FILE *gameFile = fopen ( inGameFilename, "rb" );
     if ( !gameFile )
@@ -760,7 +1035,10 @@ int AnalyzeGameFile (
     }
 
     fprintf ( listFile, "Chenard auto-analysis of game file '%s'\n", inGameFilename );
-    fprintf ( listFile, "Think time = %0.2lf seconds.\n\n", thinkTimeInSeconds );
+    fprintf ( listFile, "Think time = %0.2lf seconds.\n", thinkTimeInSeconds );
+    if ( multiPV > 1 )
+        fprintf ( listFile, "Lines per position = %d.\n", multiPV );
+    fprintf ( listFile, "\n" );
 
     ChessUI_stdio_InterceptBestPath ui;
     ui.listFile = NULL; // !!! temp debug: causes thinking output to be dumped to output file
@@ -771,6 +1049,7 @@ int AnalyzeGameFile (
     thinker.setExtendedSearchFlag (false);
     thinker.setResignFlag (false);
     thinker.SetTimeLimit ( INT32(100.0 * thinkTimeInSeconds) );
+    thinker.SetMultiPV ( multiPV );
 
     ChessBoard board;
     Move move;
@@ -7,44 +7,263 @@
     need to be optimized.
 
 =======================================================================*/
-#include <windows.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "chess.h"
-#include "winguich.h"
 #include "profiler.h"
 
-#define PROFILE_ARRAY_SIZE 64
-int ProfilerHitCount [PROFILE_ARRAY_SIZE];
-int ProfilerCallCount [PROFILE_ARRAY_SIZE];
-int ProfilerIndex = PX_UNDEFINED;
-static int TimerEnabledFlag = 0;
-
 #ifdef CHENARD_PROFILER
 
-void StartProfiler()
+thread_local ProfilerThread *ProfilerCurrentThread = 0;
+
+static const char * const ProfilerRegionNames [PX_COUNT] =
+{
+    "(other)",      // PX_UNDEFINED
+    "search",       // PX_SEARCH
+    "eval",         // PX_EVAL
+    "genmoves",     // PX_GENMOVES
+    "gencaps",      // PX_GENCAPS
+    "makemove",     // PX_MAKEMOVE
+    "unmove",       // PX_UNMOVE
+    "canmove",      // PX_CANMOVE
+    "moveorder",    // PX_MOVEORDER
+    "attack",       // PX_ATTACK
+    "xpos"          // PX_XPOS
+};
+
+
+// Everything the threads share.  Threads that have finished have their
+// counters added to 'exited', so the totals survive them.
+
+class ProfilerRegistry
+{
+public:
+    ProfilerRegistry():
+        startTicks ( ProfilerTicks() ),
+        startTime ( std::chrono::steady_clock::now() ),
+        threadCount ( 0 )
+    {
+        Clear ( exited );
+    }
+
+    ~ProfilerRegistry()
+    {
+        ProfilerTotals totals [PX_COUNT];
+        ProfilerQueryTotals ( totals );
+        for ( int r=0; r < PX_COUNT; ++r )
+        {
+            if ( totals[r].calls > 0 )
+            {
+                fputs ( ProfilerReport().c_str(), stderr );
+                break;
+            }
+        }
+    }
+
+    static void Clear ( ProfilerTotals totals [PX_COUNT] )
+    {
+        for ( int r=0; r < PX_COUNT; ++r )
+            totals[r].calls = totals[r].inclusive = totals[r].exclusive = 0;
+    }
+
+    static void Accumulate ( ProfilerTotals totals [PX_COUNT], const ProfilerThread &thread )
+    {
+        for ( int r=0; r < PX_COUNT; ++r )
+        {
+            totals[r].calls     += thread.region[r].calls.load ( std::memory_order_relaxed );
+            totals[r].inclusive += thread.region[r].inclusive.load ( std::memory_order_relaxed );
+            totals[r].exclusive += thread.region[r].exclusive.load ( std::memory_order_relaxed );
+        }
+    }
+
+    double TicksPerSecond() const
+    {
+        const double seconds = std::chrono::duration<double> ( std::chrono::steady_clock::now() - startTime ).count();
+        return (seconds > 0.0) ? (ProfilerTicks() - startTicks) / seconds : 1.0;
+    }
+
+    std::mutex  mutex;
+    std::vector<ProfilerThread *>  threads;     // the threads still running
+    ProfilerTotals  exited [PX_COUNT];
+    const UINT64  startTicks;
+    const std::chrono::steady_clock::time_point  startTime;
+    int  threadCount;
+};
+
+static ProfilerRegistry TheProfilerRegistry;
+
+
+// Registers a thread's counters when it first enters a region, and
+// retires them when the thread ends.
+
+class ProfilerThreadOwner
 {
-    // reset the table of counters...
+public:
+    ProfilerThreadOwner():
+        thread ( new ProfilerThread )
+    {
+        for ( int r=0; r < PX_COUNT; ++r )
+        {
+            thread->region[r].calls = 0;
+            thread->region[r].inclusive = 0;
+            thread->region[r].exclusive = 0;
+            thread->active[r] = 0;
+        }
+        thread->childTicks = 0;
+
+        std::lock_guard<std::mutex> lock ( TheProfilerRegistry.mutex );
+        thread->number = ++TheProfilerRegistry.threadCount;
+        TheProfilerRegistry.threads.push_back ( thread );
+    }
+
+    ~ProfilerThreadOwner()
+    {
+        {
+            std::lock_guard<std::mutex> lock ( TheProfilerRegistry.mutex );
+            ProfilerRegistry::Accumulate ( TheProfilerRegistry.exited, *thread );
+            std::vector<ProfilerThread *> &threads = TheProfilerRegistry.threads;
+            for ( size_t i=0; i < threads.size(); ++i )
+            {
+                if ( threads[i] == thread )
+                {
+                    threads.erase ( threads.begin() + i );
+                    break;
+                }
+            }
+        }
+        ProfilerCurrentThread = 0;
+        delete thread;
+    }
+
+    ProfilerThread * const thread;
+};
 
-    for ( int i=0; i<PROFILE_ARRAY_SIZE; i++ )
-        ProfilerHitCount[i] = ProfilerCallCount[i] = 0;
 
-    ProfilerIndex = PX_UNDEFINED;
+ProfilerThread *ProfilerAttachThread()
+{
+    static thread_local ProfilerThreadOwner owner;
+    return ProfilerCurrentThread = owner.thread;
+}
 
-    // start the Win32 timer...
 
-    TimerEnabledFlag = (SetTimer(HwndMain,1,55,NULL) != NULL);
+void StartProfiler()
+{
+    // Threads in the middle of a search keep running; at worst a few of
+    // their counts from before the reset survive it.
+    std::lock_guard<std::mutex> lock ( TheProfilerRegistry.mutex );
+    ProfilerRegistry::Clear ( TheProfilerRegistry.exited );
+    for ( size_t i=0; i < TheProfilerRegistry.threads.size(); ++i )
+    {
+        ProfilerThread *thread = TheProfilerRegistry.threads[i];
+        for ( int r=0; r < PX_COUNT; ++r )
+        {
+            thread->region[r].calls.store ( 0, std::memory_order_relaxed );
+            thread->region[r].inclusive.store ( 0, std::memory_order_relaxed );
+            thread->region[r].exclusive.store ( 0, std::memory_order_relaxed );
+        }
+    }
 }
 
 
 void StopProfiler()
 {
-    if ( TimerEnabledFlag )
+    // The counters are always running; nothing to do.
+}
+
+
+void ProfilerQueryTotals ( ProfilerTotals totals [PX_COUNT] )
+{
+    std::lock_guard<std::mutex> lock ( TheProfilerRegistry.mutex );
+    for ( int r=0; r < PX_COUNT; ++r )
+        totals[r] = TheProfilerRegistry.exited[r];
+
+    for ( size_t i=0; i < TheProfilerRegistry.threads.size(); ++i )
+        ProfilerRegistry::Accumulate ( totals, *TheProfilerRegistry.threads[i] );
+}
+
+
+const char *ProfilerRegionName ( int region )
+{
+    return (region >= 0 && region < PX_COUNT) ? ProfilerRegionNames[region] : "?";
+}
+
+
+static void FormatProfilerTable (
+    std::string          &text,
+    const char           *linePrefix,
+    const char           *title,
+    const ProfilerTotals  totals [PX_COUNT],
+    double                ticksPerSecond )
+{
+    UINT64 exclusiveSum = 0;
+    for ( int r=0; r < PX_COUNT; ++r )
+        exclusiveSum += totals[r].exclusive;
+
+    char line [200];
+    sprintf ( line, "%s%s\n", linePrefix, title );
+    text += line;
+    sprintf ( line, "%s%-10s %12s %12s %12s %7s %12s\n", linePrefix,
+              "region", "calls", "incl ms", "excl ms", "excl %", "ticks/call" );
+    text += line;
+
+    for ( int r=0; r < PX_COUNT; ++r )
     {
-        KillTimer ( HwndMain, 1 );
+        const ProfilerTotals &t = totals[r];
+        if ( t.calls == 0 )
+            continue;
+
+        sprintf ( line, "%s%-10s %12llu %12.1lf %12.1lf %7.2lf %12.1lf\n", linePrefix,
+                  ProfilerRegionNames[r],
+                  (unsigned long long) t.calls,
+                  1000.0 * t.inclusive / ticksPerSecond,
+                  1000.0 * t.exclusive / ticksPerSecond,
+                  exclusiveSum ? (100.0 * t.exclusive / exclusiveSum) : 0.0,
+                  double(t.exclusive) / t.calls );
+        text += line;
     }
 }
 
-#endif
+
+std::string ProfilerReport ( const char *linePrefix )
+{
+    const double ticksPerSecond = TheProfilerRegistry.TicksPerSecond();
+    std::string text;
+
+    ProfilerTotals totals [PX_COUNT];
+    ProfilerQueryTotals ( totals );
+    FormatProfilerTable ( text, linePrefix, "Profile of all threads:", totals, ticksPerSecond );
+
+    std::lock_guard<std::mutex> lock ( TheProfilerRegistry.mutex );
+    const std::vector<ProfilerThread *> &threads = TheProfilerRegistry.threads;
+
+    bool anyExited = false;
+    for ( int r=0; r < PX_COUNT; ++r )
+        anyExited = anyExited || (TheProfilerRegistry.exited[r].calls > 0);
+
+    // With only one thread, the table above is already that thread's.
+    if ( threads.size() + (anyExited ? 1 : 0) > 1 )
+    {
+        for ( size_t i=0; i < threads.size(); ++i )
+        {
+            char title [64];
+            sprintf ( title, "Thread %d:", threads[i]->number );
+            ProfilerRegistry::Clear ( totals );
+            ProfilerRegistry::Accumulate ( totals, *threads[i] );
+            FormatProfilerTable ( text, linePrefix, title, totals, ticksPerSecond );
+        }
+
+        if ( anyExited )
+            FormatProfilerTable ( text, linePrefix, "Threads that have exited:", TheProfilerRegistry.exited, ticksPerSecond );
+    }
+
+    return text;
+}
+
+#endif  // CHENARD_PROFILER
 
 /*
     $Log: profiler.cpp,v $
@@ -21,22 +21,138 @@
 #define  PX_MOVEORDER    8
 #define  PX_ATTACK       9
 #define  PX_XPOS        10
+#define  PX_COUNT       11      // number of PX_... regions
 
 #ifdef CHENARD_PROFILER
-    void StartProfiler();
+    // Each PROFILER_ENTER/PROFILER_EXIT pair counts a call to its region and
+    // the time spent inside it, both including ("inclusive") and excluding
+    // ("exclusive") the time spent in other regions entered from it.
+    // Counters are kept separately for each thread, so threads never
+    // contend for them.  Time is in ticks: CPU cycles on x86 processors,
+    // nanoseconds elsewhere.  A report is written to stderr at exit.
+
+    #include <atomic>
+    #include <string>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #elif defined(__x86_64__) || defined(__i386__)
+        #include <x86intrin.h>
+    #endif
+
+    void StartProfiler();   // zeroes all counters
     void StopProfiler();
 
-    // all of the PX_... symbols are indices into the profiler array.
-
-    extern int ProfilerHitCount[];
-    extern int ProfilerCallCount[];
-    extern int ProfilerIndex;
-
+    struct ProfilerTotals
+    {
+        UINT64  calls;
+        UINT64  inclusive;  // ticks
+        UINT64  exclusive;  // ticks
+    };
+
+    // Sums the counters of all threads, past and present.
+    void ProfilerQueryTotals ( ProfilerTotals totals [PX_COUNT] );
+    const char *ProfilerRegionName ( int region );
+
+    // A table of all regions for all threads, then for each thread.
+    // Every line starts with 'linePrefix'.
+    std::string ProfilerReport ( const char *linePrefix = "" );
+
+    inline UINT64 ProfilerTicks()
+    {
+    #if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #else
+        return std::chrono::duration_cast<std::chrono::nanoseconds> (
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+    #endif
+    }
+
+    struct ProfilerThread
+    {
+        struct Counters
+        {
+            std::atomic<UINT64>  calls;
+            std::atomic<UINT64>  inclusive;
+            std::atomic<UINT64>  exclusive;
+        };
+
+        Counters  region [PX_COUNT];    // only this thread writes; the report reads
+        int       active [PX_COUNT];    // how deep each region is nested, so recursion counts once toward inclusive time
+        UINT64    childTicks;           // time spent in regions entered from the current one
+        int       number;               // 1 for the first thread that entered a region, and so on
+
+        static void Add ( std::atomic<UINT64> &counter, UINT64 amount )
+        {
+            // Not an atomic increment: only one thread ever writes a counter.
+            counter.store ( counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed );
+        }
+    };
+
+    extern thread_local ProfilerThread *ProfilerCurrentThread;
+    ProfilerThread *ProfilerAttachThread();     // called the first time a thread enters a region
+
+    class ProfilerScope
+    {
+    public:
+        explicit ProfilerScope ( int _region ):
+            thread ( ProfilerCurrentThread ? ProfilerCurrentThread : ProfilerAttachThread() ),
+            region ( _region ),
+            savedChildTicks ( thread->childTicks ),
+            open ( true )
+        {
+            ++thread->active[region];
+            thread->childTicks = 0;
+            start = ProfilerTicks();
+        }
+
+        ~ProfilerScope()
+        {
+            Exit();
+        }
+
+        void Exit()     // PROFILER_EXIT(); may be called before the scope ends
+        {
+            if ( open )
+            {
+                open = false;
+                const UINT64 elapsed = ProfilerTicks() - start;
+                ProfilerThread::Counters &counters = thread->region[region];
+                ProfilerThread::Add ( counters.calls, 1 );
+                ProfilerThread::Add ( counters.exclusive, elapsed - thread->childTicks );
+                if ( --thread->active[region] == 0 )
+                    ProfilerThread::Add ( counters.inclusive, elapsed );
+                thread->childTicks = savedChildTicks + elapsed;
+            }
+        }
+
+    private:
+        ProfilerThread * const thread;
+        const int  region;
+        const UINT64  savedChildTicks;
+        bool    open;
+        UINT64  start;
+    };
+
+    // A region ends at PROFILER_EXIT or at the end of the enclosing block,
+    // whichever comes first, so an early return cannot leave it open.
     #define PROFILER_ENTER(newIndex)  \
-        int ___oldIndex=ProfilerIndex; ProfilerIndex=(newIndex); ++ProfilerCallCount[newIndex];
+        ProfilerScope ___profilerScope (newIndex);
 
     #define PROFILER_EXIT()  \
-        ProfilerIndex = ___oldIndex;
+        ___profilerScope.Exit();
+
+    // The regions around the smallest primitives (making and unmaking moves,
+    // attack tests) are entered tens of millions of times per search, and
+    // timing them nearly doubles the run time.  They are measured only when
+    // CHENARD_PROFILER_DETAIL is defined too; otherwise their time counts
+    // toward the regions they are called from.
+    #ifdef CHENARD_PROFILER_DETAIL
+        #define PROFILER_DETAIL_ENTER(newIndex)  PROFILER_ENTER(newIndex)
+        #define PROFILER_DETAIL_EXIT()  PROFILER_EXIT()
+    #else
+        #define PROFILER_DETAIL_ENTER(newIndex)
+        #define PROFILER_DETAIL_EXIT()
+    #endif
 
 #else   // CHENARD_PROFILER is not defined
     inline void StartProfiler() {}
@@ -44,6 +160,8 @@
 
     #define PROFILER_ENTER(newIndex) 
     #define PROFILER_EXIT() 
+    #define PROFILER_DETAIL_ENTER(newIndex) 
+    #define PROFILER_DETAIL_EXIT() 
 #endif  // CHENARD_PROFILER
 
 
@@ -7,11 +7,17 @@
 
 ===========================================================================*/
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
 
 #include "chess.h"
 #include "lrntree.h"
 #include "profiler.h"
+#include "side.h"
 
 
 #define  ESCAPE_CHECK_DEPTH   (gene.v[0])
@@ -20,10 +26,352 @@
 #define  HASH_HIST_MAX          (gene.v[2])
 #define  HASH_HIST_FUNC(h,d)    (gene.v[3])
 
+#define  NULL_MOVE_REDUCTION    (gene.v[82])
+
+#define  LMR_MIN_DEPTH          (gene.v[83])    // remaining depth needed to reduce
+#define  LMR_MIN_MOVES          (gene.v[84])    // moves searched in full before reducing
+#define  LMR_BASE               (gene.v[85])    // hundredths of a ply
+#define  LMR_DIVISOR            (gene.v[86])    // hundredths
+
 #define DEBUG_BOARD_CORRUPTION  0
 
+// ChessUI::DebugPly and DebugExit are virtual calls made at every node,
+// so the search makes them only when the user interface asked for them
+// at the start of the search (see ChessUI::WantsDebugPly).  Building with
+// SEARCH_DEBUG_HOOKS defined as 0 removes them from the search entirely.
+
+#ifndef SEARCH_DEBUG_HOOKS
+#define SEARCH_DEBUG_HOOKS  1
+#endif
+
+#if SEARCH_DEBUG_HOOKS
+    #define  DEBUG_PLY(d,b,m)    do { if ( debugHooksEnabled ) userInterface.DebugPly ( d, b, m ); } while(0)
+    #define  DEBUG_EXIT(d,b,s)   do { if ( debugHooksEnabled ) userInterface.DebugExit ( d, b, s ); } while(0)
+#else
+    #define  DEBUG_PLY(d,b,m)    ((void)0)
+    #define  DEBUG_EXIT(d,b,s)   ((void)0)
+#endif
+
+// CheckTimeLimit reads the clock once every SEARCH_POLL_NODES calls: a
+// fraction of a millisecond of searching, so deadlines are met closely
+// without reading the clock at every node.  Every
+// SEARCH_CHECKPOINT_MICROSECONDS it lets the user interface poll for input
+// or report progress (ChessUI::SearchCheckpoint).
+#define  SEARCH_POLL_NODES               256
+#define  SEARCH_CHECKPOINT_MICROSECONDS  50000
+
+// Half-width of the first aspiration window at the root, centred on the
+// previous iteration's score.  It grows by ASPIRATION_GROWTH each time the
+// search falls outside it.
+#define  ASPIRATION_WINDOW      35
+#define  ASPIRATION_GROWTH       4
+
+
+//----------------------------------------------------------------------
+//  Lazy SMP
+//
+//  Each helper thread runs its own copy of the iterative deepening
+//  loop on its own copy of the board.  The helpers talk to the main
+//  thread only through the shared transposition table: the positions
+//  they store there make the main thread's search cheaper.
+//  Half of the helpers start one level deeper than the main thread,
+//  so that the threads tend to work on different parts of the tree.
+//----------------------------------------------------------------------
+
+class SearchHelper
+{
+public:
+    SearchHelper(): player(0) {}
+    ~SearchHelper() { delete player; }
+
+    ChessUI_Silent        ui;     // a helper never plays a game, so it has nothing to show anyone
+    ComputerChessPlayer  *player;
+    ChessBoard            board;
+    std::thread           thread;
+};
+
+
+static int ClampThreadCount ( int n )
+{
+    if ( n < 1 )
+        return 1;
+
+    if ( n > MAX_SEARCH_THREADS )
+        return MAX_SEARCH_THREADS;
+
+    return n;
+}
+
+
+void ChessEngineContext::SetDefaultThreadCount ( int _numThreads )
+{
+    defaultThreadCount = ClampThreadCount ( _numThreads );
+}
+
+
+void ComputerChessPlayer::SetThreadCount ( int _numThreads )
+{
+    _numThreads = ClampThreadCount ( _numThreads );
+    if ( _numThreads != numThreads )
+    {
+        // Discard any existing helpers: StartHelperThreads creates the right number.
+        delete[] helpers;
+        helpers = 0;
+        numHelpers = 0;
+        numThreads = _numThreads;
+    }
+}
+
+
+void ComputerChessPlayer::SetMultiPV ( int _multiPV )
+{
+    if ( _multiPV < 1 )
+        multiPV = 1;
+    else if ( _multiPV > MAX_MULTI_PV )
+        multiPV = MAX_MULTI_PV;
+    else
+        multiPV = _multiPV;
+}
+
+
+int ComputerChessPlayer::GetPrincipalVariations ( BestPath lines[], int maxLines ) const
+{
+    int n = 0;
+    while ( n < multiPVCount && n < maxLines )
+    {
+        lines[n] = multiPVPath[n];
+        ++n;
+    }
+    return n;
+}
+
+
+void ComputerChessPlayer::ReportMultiPV ( const ChessBoard &board )
+{
+    // Called after each completed iteration, when the root moves have
+    // been sorted best first.  The top multiPV of them have exact scores.
+
+    multiPVCount = 0;
+    for ( int i=0; i < rootml.num && multiPVCount < multiPV; ++i )
+    {
+        const Move &move = rootml.m[i];
+        int k;
+        for ( k=0; k < eachBestPathCount; ++k )
+            if ( eachBestPath[k].m[0] == move )
+                break;
+
+        if ( k == eachBestPathCount )
+            break;      // this move was never searched to the end
+
+        BestPath &path = multiPVPath[multiPVCount++];
+        path = eachBestPath[k];
+        path.m[0].score = move.score;
+    }
+
+    if ( multiPV > 1 )
+        for ( int i=0; i < multiPVCount; ++i )
+            userInterface.DisplayBestPath ( board, multiPVPath[i] );
+}
+
+
+void ComputerChessPlayer::RecordIteration()
+{
+    // Called after each iteration of the root search, finished or not.
+    if ( searchStats.numIterations < MAX_SEARCH_ITERATIONS )
+    {
+        SearchIterationStats &it = searchStats.iteration[searchStats.numIterations++];
+        it.depth = level + 1;     // as in ReportComputerStats
+        it.completed = !searchAborted;
+        it.visited = visited;
+        it.microseconds = timeManager.elapsedMicroseconds();
+    }
+}
+
+
+void ComputerChessPlayer::StartHelperThreads (
+    const ChessBoard &board,
+    int startLevel )
+{
+    threadNpsLimit = npsLimit;
+
+    // A node-limited search must not depend on how the threads happen to
+    // be scheduled, so it searches alone.
+    if ( numThreads <= 1 || helperInstance || isBackgroundThinker() || searchType == CCPST_NODE_SEARCH )
+        return;
+
+    if ( npsLimit > 0 )
+        threadNpsLimit = (npsLimit > UINT32(numThreads)) ? (npsLimit / numThreads) : 1;
+
+    if ( !helpers )
+    {
+        numHelpers = numThreads - 1;
+        helpers = new SearchHelper [numHelpers];
+        for ( int i=0; i < numHelpers; ++i )
+            helpers[i].player = new ComputerChessPlayer ( helpers[i].ui, engine, true );
+    }
+
+    for ( int i=0; i < numHelpers; ++i )
+    {
+        SearchHelper &h = helpers[i];
+        ComputerChessPlayer &p = *h.player;
+
+        h.board = board;
+
+        p.gene = gene;
+        p.whiteEval = whiteEval;
+        p.blackEval = blackEval;
+        p.KingPosTable = KingPosTable;
+        p.maxCheckDepth = maxCheckDepth;
+        p.maxlevel = maxlevel;
+        p.searchType = CCPST_DEPTH_SEARCH;      // helpers keep going until we stop them
+        p.multiPV = multiPV;                    // so the table holds what the master will look for
+        p.searchBias = 0;                       // the master's randomness is enough
+        p.xposTable = xposTable;
+        p.computerPlayingWhite = computerPlayingWhite;
+        p.rootml = rootml;
+        p.eachBestPathCount = 0;
+        p.currentBestPath.depth = 0;
+        p.nextBestPath[0].depth = 0;
+        p.visited = p.evaluated = p.generated = 0;
+        p.quiescenceVisited = p.cutoffs = p.firstMoveCutoffs = 0;
+        for ( int n=0; n < NODES_ARRAY_SIZE; ++n )
+            p.visnodes[n] = p.gennodes[n] = 0;
+
+        memcpy ( p.whiteHist, whiteHist, 4096 * sizeof(SCORE) );
+        memcpy ( p.blackHist, blackHist, 4096 * sizeof(SCORE) );
+        memcpy ( p.lmrTable, lmrTable, sizeof(lmrTable) );
+        p.searchAborted = false;
+        p.debugHooksEnabled = false;
+        p.timeManager = timeManager;            // the helper's clock starts with ours
+        p.timeCheckCounter = 0;
+        p.checkpointTime = 0;
+        p.threadNpsLimit = threadNpsLimit;
+
+        const int helperStartLevel = startLevel + ((i & 1) ? 0 : 1);
+        h.thread = std::thread ( &ComputerChessPlayer::HelperSearch, &p, std::ref(h.board), helperStartLevel );
+    }
+}
+
 
-ComputerChessPlayer::ComputerChessPlayer ( ChessUI &ui ):
+void ComputerChessPlayer::StopHelperThreads()
+{
+    int i;
+    for ( i=0; i < numHelpers; ++i )
+        helpers[i].player->AbortSearch();
+
+    for ( i=0; i < numHelpers; ++i )
+    {
+        SearchHelper &h = helpers[i];
+        if ( h.thread.joinable() )
+        {
+            h.thread.join();
+
+            // Report the total work done by all threads.
+            visited   += h.player->visited;
+            evaluated += h.player->evaluated;
+            generated += h.player->generated;
+            quiescenceVisited += h.player->quiescenceVisited;
+            cutoffs += h.player->cutoffs;
+            firstMoveCutoffs += h.player->firstMoveCutoffs;
+            ++searchStats.numThreads;
+        }
+    }
+}
+
+
+void ComputerChessPlayer::HelperSearch (
+    ChessBoard &board,
+    int startLevel )
+{
+    Move bestmove = rootml.m[0];
+    expectedScorePrev = expectedScoreNow = board.WhiteToMove() ? NEGINF : POSINF;
+    for ( level=startLevel; !searchAborted && level <= maxlevel; level++ )
+    {
+        if ( board.WhiteToMove() )
+            SearchRoot<WhiteSide> ( board, bestmove );
+        else
+            SearchRoot<BlackSide> ( board, bestmove );
+
+        if ( bestmove.score >= WON_FOR_WHITE || bestmove.score <= WON_FOR_BLACK )
+            break;
+
+        expectedScorePrev = expectedScoreNow;
+    }
+}
+
+
+
+//----------------------------------------------------------------------
+//  Engine context
+//----------------------------------------------------------------------
+
+ChessEngineContext::ChessEngineContext():
+    xposTable ( 0 ),
+    openingBookBoard ( new ChessBoard ),
+    defaultThreadCount ( 1 ),
+    searchingPlayer ( 0 ),
+    timeSearchStarted ( 0 )
+{
+}
+
+
+ChessEngineContext::~ChessEngineContext()
+{
+    delete xposTable;
+    xposTable = 0;
+
+    delete openingBookBoard;
+    openingBookBoard = 0;
+}
+
+
+/*static*/ ChessEngineContext &ChessEngineContext::Default()
+{
+    static ChessEngineContext TheDefaultContext;
+    return TheDefaultContext;
+}
+
+
+TranspositionTable &ChessEngineContext::GetTranspositionTable()
+{
+    if ( !xposTable )
+    {
+        // Create a default 1MB transposition table.
+        xposTable = new TranspositionTable ( 1 );
+    }
+
+    return *xposTable;
+}
+
+
+void ChessEngineContext::ClearTranspositionTable()
+{
+    if ( xposTable )
+        xposTable->reset();
+}
+
+
+void ChessEngineContext::SetTranspositionTableSize ( int memorySizeInMegabytes )
+{
+    delete xposTable;
+    xposTable = new TranspositionTable ( memorySizeInMegabytes );
+}
+
+
+void ChessEngineContext::BeginSearch (
+    ComputerChessPlayer *player,
+    INT32 startTime )
+{
+    timeSearchStarted = startTime;
+    searchingPlayer = player;
+}
+
+
+
+ComputerChessPlayer::ComputerChessPlayer (
+    ChessUI &ui,
+    ChessEngineContext &_engine,
+    bool _helperInstance ):
     ChessPlayer ( ui ),
     minlevel ( 0 ),
     maxlevel ( 3 ),
@@ -32,20 +380,25 @@ ComputerChessPlayer::ComputerChessPlayer ( ChessUI &ui ):
     visited ( 0 ),
     evaluated ( 0 ),
     generated ( 0 ),
+    quiescenceVisited ( 0 ),
+    cutoffs ( 0 ),
+    firstMoveCutoffs ( 0 ),
     searchBias ( 1 ),
     extendSearchFlag ( false ),
     computerPlayingWhite ( false ),
     expectedScorePrev ( 0 ),
     expectedScoreNow ( 0 ),
-    revertTimeLimit ( 0 ),
     searchType ( CCPST_DEPTH_SEARCH ),
     maxNodesEvaluated ( 0 ),
+    maxNodesVisited ( 0 ),
+    npsLimit ( 0 ),
+    threadNpsLimit ( 0 ),
     searchAborted ( false ),
-    stopTime ( 0 ),
     timeLimit ( 0 ),
     timeCheckCounter ( 0 ),
-    timeCheckLimit ( 100 ),
-    prevTime ( 0 ),
+    checkpointTime ( 0 ),
+    debugHooksEnabled ( false ),
+    stopToken ( 0 ),
     whiteEval ( &ComputerChessPlayer::WhiteMidgameEval ),
     blackEval ( &ComputerChessPlayer::BlackMidgameEval ),
     eachBestPathCount ( 0 ),
@@ -68,17 +421,36 @@ ComputerChessPlayer::ComputerChessPlayer ( ChessUI &ui ):
     oppTimeInstance ( false ),
     oppTimeEnable ( false ),
     blunderAlertInstance(false),
-    immediateSingularMove(true)
+    immediateSingularMove(true),
+    numThreads ( _engine.QueryDefaultThreadCount() ),
+    numHelpers ( 0 ),
+    helpers ( 0 ),
+    helperInstance ( _helperInstance ),
+    multiPV ( 1 ),
+    multiPVCount ( 0 ),
+    engine ( _engine ),
+    xposTable ( 0 )
 {
     rootml.num = 0;
-    ResetHistoryBuffers();
+
+    // The transposition table belongs to the engine context and outlives
+    // this player: entries left by earlier searches are aged out by
+    // generation, and only a new game or a resize clears the whole table.
+    for ( int i=0; i<4096; ++i )
+        whiteHist[i] = blackHist[i] = 0;
     memset(&predictedOppMove, 0, sizeof(predictedOppMove));
     memset(&moveOrder_xposBestMove, 0, sizeof(moveOrder_xposBestMove));
+    memset(&searchStats, 0, sizeof(searchStats));
+    memset(&xposAtStart, 0, sizeof(xposAtStart));
 }
 
 
 ComputerChessPlayer::~ComputerChessPlayer()
 {
+    delete[] helpers;
+    helpers = 0;
+    numHelpers = 0;
+
     delete[] whiteHist;
     whiteHist = 0;
 
@@ -93,16 +465,6 @@ ComputerChessPlayer::~ComputerChessPlayer()
 }
 
 
-/*static*/ void ComputerChessPlayer::LazyInitXposTable()
-{
-    if (!XposTable)
-    {
-        // Create a default 1MB transposition table.
-        XposTable = new TranspositionTable(1);
-    }
-}
-
-
 static void InsertPrediction (
     ChessBoard  &board,
     BestPath    &path,
@@ -181,6 +543,46 @@ static inline int NumPiecesOnBlack (
 }
 
 
+void ComputerChessPlayer::InitLateMoveReductions()
+{
+    // The reduction grows with the logarithm of both the remaining depth
+    // and how far down the ordered move list we are:
+    //
+    //      R = LMR_BASE/100 + ln(depth) * ln(moves) / (LMR_DIVISOR/100)
+    //
+    // Never reduce so far that the move gets no full-width ply at all.
+
+    for ( int d=0; d < LMR_MAX_DEPTH; ++d )
+    {
+        for ( int m=0; m < LMR_MAX_MOVES; ++m )
+        {
+            int r = 0;
+            if ( d >= LMR_MIN_DEPTH && m > LMR_MIN_MOVES )
+            {
+                r = int ( LMR_BASE/100.0 + log(double(d)) * log(double(m)) * 100.0 / LMR_DIVISOR );
+                if ( r > d - 2 )
+                    r = d - 2;
+                if ( r < 0 )
+                    r = 0;
+            }
+            lmrTable[d][m] = (unsigned char) r;
+        }
+    }
+}
+
+
+int ComputerChessPlayer::LateMoveReduction ( int remainingDepth, int moveNumber ) const
+{
+    if ( remainingDepth >= LMR_MAX_DEPTH )
+        remainingDepth = LMR_MAX_DEPTH - 1;
+
+    if ( moveNumber >= LMR_MAX_MOVES )
+        moveNumber = LMR_MAX_MOVES - 1;
+
+    return lmrTable [remainingDepth] [moveNumber];
+}
+
+
 void ComputerChessPlayer::ChooseEvalFunctions ( ChessBoard &board )
 {
     // Determine from the chess board which side we are.
@@ -266,8 +668,8 @@ void ComputerChessPlayer::ResetHistoryBuffers()
     for ( int i=0; i<4096; ++i )
         whiteHist[i] = blackHist[i] = 0;
 
-    LazyInitXposTable();
-    XposTable->reset();
+    xposTable = &engine.GetTranspositionTable();
+    xposTable->reset();
 }
 
 
@@ -283,10 +685,6 @@ void ComputerChessPlayer::setResignThreshold(unsigned _resignThreshold)
 
 
 
-INT32 TimeSearchStarted = 0;
-ComputerChessPlayer *ComputerPlayerSearching = 0;
-
-
 void ComputerChessPlayer::InformResignation()
 {
     // The opponent has resigned, so it is time to abort any pondering that may be in progress.
@@ -302,6 +700,7 @@ bool ComputerChessPlayer::GetMove (
 {
     PROFILER_ENTER(PX_SEARCH);
     timeSpent = 0;
+    multiPVCount = 0;
 
     //---------------------------------------------------------------------
     //   Before doing anything else, see if we need to continue
@@ -326,29 +725,42 @@ bool ComputerChessPlayer::GetMove (
 
     cancelPredictedOpponentMove();
 
-    INT32 timeBefore = TimeSearchStarted = ChessTime();
-    ComputerPlayerSearching = this;
-    if ( searchType == CCPST_TIMED_SEARCH )
-    {
-        prevTime = timeBefore;
-        stopTime = prevTime + timeLimit;
-        timeCheckCounter = 0;
-    }
+    INT32 timeBefore = ChessTime();
+    engine.BeginSearch ( this, timeBefore );
+    timeManager.start ( timeLimit, extendSearchFlag );
+    timeCheckCounter = 0;
+    checkpointTime = 0;
+
+    // The blunder alert instance is excluded because the user interface's
+    // debug hooks are not thread-safe.
+    debugHooksEnabled = userInterface.WantsDebugPly() && !blunderAlert_QueryInstanceFlag();
 
     searchAborted = false;
     hitMaxHistory = false;
     userInterface.ComputerIsThinking ( true, *this );
     ChooseEvalFunctions ( board );
-    XposTable->startNewSearch();
+    InitLateMoveReductions();
+    xposTable = &engine.GetTranspositionTable();    // may have been resized since last search
+    xposTable->startNewSearch();
+    xposTable->queryStats ( xposAtStart );
+    quiescenceVisited = cutoffs = firstMoveCutoffs = 0;
+    searchStats.numThreads = 1;     // StopHelperThreads counts the others
+    searchStats.numIterations = 0;
+
+    if ( stopToken )
+        stopToken->addCallback ( AbortSearchCallback, this );   // aborts right away if already stopped
 
     if ( board.WhiteToMove() )
         GetWhiteMove ( board, bestmove );
     else
         GetBlackMove ( board, bestmove );
 
+    if ( stopToken )
+        stopToken->removeCallback ( AbortSearchCallback, this );
+
     INT32 timeAfter = ChessTime();
     timeSpent = timeAfter - timeBefore;
-    ComputerPlayerSearching = 0;
+    engine.EndSearch();
     userInterface.ComputerIsThinking ( false, *this );
 
     if ( enableMoveDisplayFlag )
@@ -363,26 +775,44 @@ bool ComputerChessPlayer::GetMove (
         visnodes,
         gennodes );
 
+    searchStats.microseconds = timeManager.elapsedMicroseconds();
+    searchStats.visited = visited;
+    searchStats.evaluated = evaluated;
+    searchStats.generated = generated;
+    searchStats.quiescenceVisited = quiescenceVisited;
+    searchStats.cutoffs = cutoffs;
+    searchStats.firstMoveCutoffs = firstMoveCutoffs;
+    memcpy ( searchStats.visnodes, visnodes, sizeof(visnodes) );
+    memcpy ( searchStats.gennodes, gennodes, sizeof(gennodes) );
+
+    TranspositionStats xposNow;
+    xposTable->queryStats ( xposNow );
+    searchStats.xpos.tries    = xposNow.tries    - xposAtStart.tries;
+    searchStats.xpos.hits     = xposNow.hits     - xposAtStart.hits;
+    searchStats.xpos.stores   = xposNow.stores   - xposAtStart.stores;
+    searchStats.xpos.fresh    = xposNow.fresh    - xposAtStart.fresh;
+    searchStats.xpos.stales   = xposNow.stales   - xposAtStart.stales;
+    searchStats.xpos.stomps   = xposNow.stomps   - xposAtStart.stomps;
+    searchStats.xpos.failures = xposNow.failures - xposAtStart.failures;
+    searchStats.xpos.inferior = xposNow.inferior - xposAtStart.inferior;
+
+    userInterface.ReportSearchStats ( searchStats );
+
     FindPrevBestPath ( bestmove );
     expectedNextBoardHash = 0;   // will never match any board hash
 
-    static int NextBoardTotal=0, NextBoardHit1=0, NextBoardHit2=0;
     bool havePredictedOppMove = false;
     if ( currentBestPath.depth > 1 )
     {
-        ++NextBoardTotal;
-
         // Keep hash code of expected board position if opponent makes the
         // move we think he will make.  This helps us to know whether we
         // can recycle best path information on our next search.
         UnmoveInfo unmove[2];
         if ( board.isLegal(bestmove) )
         {
-            ++NextBoardHit1;
             board.MakeMove ( bestmove, unmove[0] );
             if ( board.isLegal(currentBestPath.m[1]) )
             {
-                ++NextBoardHit2;
                 havePredictedOppMove = true;
                 predictedOppMove = currentBestPath.m[1];
                 board.MakeMove ( predictedOppMove, unmove[1] );
@@ -516,7 +946,7 @@ void ComputerChessPlayer::GetWhiteMove (
     }
 
     // See if we can recycle best path info from the previous move's search.
-    UINT32 hash = board.Hash();
+    UINT64 hash = board.Hash();
     int startLevel = minlevel;
     if ( hash==expectedNextBoardHash &&
          currentBestPath.depth>=2 && prevCompletedLevel>1 )
@@ -543,13 +973,19 @@ void ComputerChessPlayer::GetWhiteMove (
     prevCompletedLevel = 0;
     expectedScorePrev = NEGINF;
     expectedScoreNow  = NEGINF;
-    revertTimeLimit = 0;
+    StartHelperThreads ( board, startLevel );
     const INT32 startThinkTime = ChessTime();
     for ( level=startLevel; !searchAborted && level <= maxlevel; level++ )
     {
-        WhiteSearchRoot ( board, bestmove );
+        timeManager.startIteration();
+        SearchRoot<WhiteSide> ( board, bestmove );
+        RecordIteration();
         if ( !searchAborted )
+        {
             prevCompletedLevel = level;
+            timeManager.finishIteration ( bestmove );
+            ReportMultiPV ( board );
+        }
 
         if ( bestmove.score >= WON_FOR_WHITE )
             break;   // We have found a forced win!
@@ -558,7 +994,11 @@ void ComputerChessPlayer::GetWhiteMove (
             break;   // Time to give up - no deeper search will improve things.
 
         expectedScorePrev = expectedScoreNow;
+
+        if ( searchType == CCPST_TIMED_SEARCH && !timeManager.canStartIteration() )
+            break;   // the next iteration could not finish in time
     }
+    StopHelperThreads();
     const INT32 actualThinkTime = ChessTime() - startThinkTime;
 
     if ( bestmove.score >= WON_FOR_WHITE &&
@@ -573,12 +1013,6 @@ void ComputerChessPlayer::GetWhiteMove (
         userInterface.PredictMate (1 + plies/2);
     }
 
-    if ( revertTimeLimit )
-    {
-        SetTimeLimit (revertTimeLimit);
-        revertTimeLimit = 0;
-    }
-
     if ( searchType==CCPST_TIMED_SEARCH && trainingEnabled )
     {
         tree.rememberPosition ( board, bestmove, actualThinkTime, evaluated, 1, 0 );
@@ -670,7 +1104,7 @@ void ComputerChessPlayer::GetBlackMove (
     }
 
     // See if we can recycle best path info from the previous move's search.
-    UINT32 hash = board.Hash();
+    UINT64 hash = board.Hash();
     int startLevel = minlevel;
     if ( hash==expectedNextBoardHash &&
          currentBestPath.depth>=2 && prevCompletedLevel>1 )
@@ -697,13 +1131,19 @@ void ComputerChessPlayer::GetBlackMove (
     prevCompletedLevel = 0;
     expectedScorePrev = POSINF;
     expectedScoreNow  = POSINF;
-    revertTimeLimit = 0;
+    StartHelperThreads ( board, startLevel );
     const INT32 startThinkTime = ChessTime();
     for ( level=startLevel; !searchAborted && level <= maxlevel; level++ )
     {
-        BlackSearchRoot ( board, bestmove );
+        timeManager.startIteration();
+        SearchRoot<BlackSide> ( board, bestmove );
+        RecordIteration();
         if ( !searchAborted )
+        {
             prevCompletedLevel = level;
+            timeManager.finishIteration ( bestmove );
+            ReportMultiPV ( board );
+        }
 
         if ( bestmove.score <= WON_FOR_BLACK )
             break;
@@ -712,7 +1152,11 @@ void ComputerChessPlayer::GetBlackMove (
             break;
 
         expectedScorePrev = expectedScoreNow;
+
+        if ( searchType == CCPST_TIMED_SEARCH && !timeManager.canStartIteration() )
+            break;   // the next iteration could not finish in time
     }
+    StopHelperThreads();
     const INT32 actualThinkTime = ChessTime() - startThinkTime;
 
     if ( bestmove.score <= WON_FOR_BLACK &&
@@ -727,12 +1171,6 @@ void ComputerChessPlayer::GetBlackMove (
         userInterface.PredictMate (1 + plies/2);
     }
 
-    if ( revertTimeLimit )
-    {
-        SetTimeLimit (revertTimeLimit);
-        revertTimeLimit = 0;
-    }
-
     if ( searchType==CCPST_TIMED_SEARCH && trainingEnabled )
     {
         tree.rememberPosition ( board, bestmove, actualThinkTime, evaluated, 1, 0 );
@@ -762,13 +1200,12 @@ BestPath *ComputerChessPlayer::SaveTLMBestPath ( Move move )
 {
     // Try to find move in existing TLM BestPaths...
 
-    bool found = false;
     int i;
-    for ( i=0; !found && i < eachBestPathCount; i++ )
+    for ( i=0; i < eachBestPathCount; i++ )
         if ( eachBestPath[i].m[0] == move )
-            found = true;
+            break;
 
-    if (!found)
+    if ( i == eachBestPathCount )
     {
         // Need to add a new one!
 
@@ -825,19 +1262,91 @@ void ComputerChessPlayer::FoundBestMove (
 }
 
 
-SCORE ComputerChessPlayer::WhiteSearchRoot (
+// Returns the k-th best score among the first 'count' root moves,
+// where 'better' orders scores from the point of view of the side to move.
+template <class Better>
+static SCORE KthBestRootScore ( const MoveList &ml, int count, int k, Better better )
+{
+    SCORE scores [MAX_MOVES];
+    for ( int i=0; i < count; ++i )
+        scores[i] = ml.m[i].score;
+
+    std::nth_element ( scores, scores + (k-1), scores + count, better );
+    return scores[k-1];
+}
+
+
+template <class Side>
+SCORE ComputerChessPlayer::SearchRoot (
     ChessBoard &board,
     Move       &bestmove )
 {
+    // Aspiration windows: once the previous iteration has given us an
+    // idea of the score, search with a narrow window around it, and
+    // widen the side that fails until the score lands inside.
+
+    if ( multiPV > 1 )
+    {
+        // Every one of the top moves needs an exact score,
+        // so a window around just the best one does not help.
+        return SearchRoot<Side> ( board, bestmove, MIN_WINDOW, MAX_WINDOW );
+    }
+
+    const Move prevBest = bestmove;
+    SCORE delta = ASPIRATION_WINDOW;
+    SCORE alpha = MIN_WINDOW;
+    SCORE beta  = MAX_WINDOW;
+
+    if ( expectedScorePrev > WON_FOR_BLACK && expectedScorePrev < WON_FOR_WHITE )
+    {
+        alpha = expectedScorePrev - delta;
+        beta  = expectedScorePrev + delta;
+    }
+
+    for(;;)
+    {
+        SCORE score = SearchRoot<Side> ( board, bestmove, alpha, beta );
+        if ( searchAborted )
+        {
+            // A move picked during a pass that failed on our own
+            // bound (low for White, high for Black) is not trustworthy.
+            if ( Side::IsWhite ? (alpha > MIN_WINDOW && bestmove.score <= alpha)
+                               : (beta < MAX_WINDOW && bestmove.score >= beta) )
+                bestmove = prevBest;
+            return score;
+        }
+
+        delta *= ASPIRATION_GROWTH;
+        if ( score <= alpha && alpha > MIN_WINDOW )
+            alpha = (score - delta > MIN_WINDOW) ? (score - delta) : MIN_WINDOW;
+        else if ( score >= beta && beta < MAX_WINDOW )
+            beta = (score + delta < MAX_WINDOW) ? (score + delta) : MAX_WINDOW;
+        else
+            return score;
+    }
+}
+
+
+template <class Side>
+SCORE ComputerChessPlayer::SearchRoot (
+    ChessBoard &board,
+    Move       &bestmove,
+    SCORE       alpha,      // Best so far for White
+    SCORE       beta )      // Best so far for Black
+{
+    typedef typename Side::Opponent Opponent;
+
 #if DEBUG_BOARD_CORRUPTION
     UINT32 bcopy [144];
     memcpy ( bcopy, board.board, sizeof(bcopy) );
 #endif
 
     SCORE   score;
-    SCORE   bestscore = NEGINF;
-    SCORE   alpha = MIN_WINDOW;   // Best so far for White
-    SCORE   beta  = MAX_WINDOW;   // Best so far for Black
+    SCORE   bestscore = Side::Worst;
+
+    // As in Search, the side to move improves its own bound.
+    SCORE &ownBound = Side::IsWhite ? alpha : beta;
+    SCORE &oppBound = Side::IsWhite ? beta  : alpha;
 
     hashPath[0] = board.Hash();
 
@@ -852,7 +1361,7 @@ SCORE ComputerChessPlayer::WhiteSearchRoot (
         // If this isn't the first move we are considering, and it
         // is a definite loser, just skip it!
 
-        if ( i>0 && move->score <= WON_FOR_BLACK )
+        if ( i>0 && Opponent::WinningBound(move->score) )
             continue;
 
         ++visited;
@@ -863,24 +1372,46 @@ SCORE ComputerChessPlayer::WhiteSearchRoot (
 
         FindPrevBestPath ( *move );
 
-        if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
-        {
-            userInterface.DebugPly ( 0, board, *move );
-        }
+        DEBUG_PLY ( 0, board, *move );
 
-        board.MakeWhiteMove ( *move, unmove, false, false );
+        board.MakeMove<Side> ( *move, unmove, false, false );
 
         if ( level > 0 )
         {
-            score = BlackSearch ( board, 1, alpha, beta, true );
+            // Principal variation search: every move after the first only
+            // has to show it is no better than our bound, which a null
+            // window does cheaply.  Only a move that beats the bound is
+            // searched again to find out by how much.  In multi-PV mode,
+            // "the first" means the first multiPV moves, and the bound is
+            // the worst of the best multiPV scores so far.
+
+            SCORE childAlpha = alpha;
+            SCORE childBeta  = beta;
+            if ( i >= multiPV )
+            {
+                if ( Side::IsWhite )
+                    childBeta = alpha + 1;
+                else
+                    childAlpha = beta - 1;
+            }
+
+            score = Search<Opponent> ( board, 1, childAlpha, childBeta, true );
+            if ( i >= multiPV && score > alpha && score < beta && !searchAborted )
+                score = Search<Opponent> ( board, 1, alpha, beta, true );
+
+            // A score equal to the multi-PV bound is only a bound: rank the
+            // move below any move whose exact score happens to tie with it.
+            if ( multiPV > 1 && i >= multiPV && score == ownBound )
+                score = Side::IsWhite ? ownBound - 1 : ownBound + 1;
+
             if ( !searchAborted )
                 move->score = score;
         }
         else
         {
-            score = move->score = BlackQSearch ( board, 1, alpha, beta, true );
+            score = move->score = QSearch<Opponent> ( board, 1, alpha, beta, true );
         }
-        board.UnmakeWhiteMove ( *move, unmove );
+        board.UnmakeMove<Side> ( *move, unmove );
 
         BestPath *path = 0;
         if ( !searchAborted )
@@ -894,17 +1425,17 @@ SCORE ComputerChessPlayer::WhiteSearchRoot (
                 // to keep search bias from picking from them...
 
                 while ( i < rootml.num )
-                    rootml.m[i++].score = NEGINF;
+                    rootml.m[i++].score = Side::Worst;
             }
         }
         else
         {
-            if ( score > bestscore )
+            if ( Side::Better(score,bestscore) )
             {
                 bestmove = *move;
                 expectedScoreNow = bestscore = score;
                 userInterface.DisplayBestMoveSoFar ( board, bestmove, level );
-                if ( path )
+                if ( path && multiPV == 1 )     // otherwise ReportMultiPV shows all the lines at once
                 {
                     if ( oppTimeInstance )
                         InsertPrediction ( board, *path, userInterface );
@@ -914,161 +1445,66 @@ SCORE ComputerChessPlayer::WhiteSearchRoot (
             }
         }
 
-        if ( score > alpha )
-            alpha = score;
+        if ( Side::AtLeast(score,oppBound) )
+            break;      // our caller will widen the aspiration window
+
+        if ( multiPV > 1 )
+        {
+            if ( i+1 >= multiPV && !searchAborted )
+                ownBound = KthBestRootScore ( rootml, i+1, multiPV, Side::Better );
+        }
+        else if ( Side::Better(score,ownBound) )
+            ownBound = score;
     }
 
-    rootml.WhiteSort();
+    Side::Sort ( rootml );
 
-    userInterface.DebugExit ( 0, board, bestscore );
+    DEBUG_EXIT ( 0, board, bestscore );
 
 #if DEBUG_BOARD_CORRUPTION
     if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in WhiteSearchRoot");
+        ChessFatal ( Side::IsWhite ? "Board corruption found in SearchRoot<WhiteSide>" : "Board corruption found in SearchRoot<BlackSide>" );
 #endif
 
     return bestscore;
 }
 
 
-SCORE ComputerChessPlayer::BlackSearchRoot (
-    ChessBoard &board,
-    Move       &bestmove )
+static SCORE AdjustCheckmateScore (
+    const TranspositionEntry *xpos,
+    int depth )
 {
-#if DEBUG_BOARD_CORRUPTION
-    UINT32 bcopy [144];
-    memcpy ( bcopy, board.board, sizeof(bcopy) );
-#endif
-
-    SCORE   score;
-    SCORE   bestscore = POSINF;
-    SCORE   alpha = MIN_WINDOW;   // Best so far for White
-    SCORE   beta  = MAX_WINDOW;   // Best so far for Black
+    SCORE score = xpos->bestReply.score;
+    if ( score > WON_FOR_WHITE )
+    {
+        int increasedDepth = depth - int(xpos->future);
+        score -= WIN_POSTPONEMENT(increasedDepth);
+    }
+    else if ( score < WON_FOR_BLACK )
+    {
+        int increasedDepth = depth - int(xpos->future);
+        score += WIN_POSTPONEMENT(increasedDepth);
+    }
 
-    hashPath[0] = board.Hash();
+    return score;
+}
 
-    int  i;
-    Move        *move;
-    UnmoveInfo   unmove;
 
-    for ( i=0, move=&rootml.m[0];
-          !searchAborted && i < rootml.num;
-          i++, move++ )
-    {
-        // If this isn't the first move we are considering, and it
-        // is a definite loser, just skip it!
+template <class Side>
+SCORE ComputerChessPlayer::Search (
+    ChessBoard  &board,
+    int          depth,
+    SCORE        alpha,
+    SCORE        beta,
+    bool     bestPathFlag )
+{
+    typedef typename Side::Opponent Opponent;
 
-        if ( i>0 && move->score >= WON_FOR_WHITE )
-            continue;
+    if ( depth < MAX_BESTPATH_DEPTH )
+        nextBestPath[depth].depth = depth - 1;
 
-        ++visited;
-        ++visnodes[0];
-
-        if ( level > 1 )
-            userInterface.DisplayCurrentMove ( board, *move, level );
-
-        FindPrevBestPath ( *move );
-
-        if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
-        {
-            userInterface.DebugPly ( 0, board, *move );
-        }
-
-        board.MakeBlackMove ( *move, unmove, false, false );
-
-        if ( level > 0 )
-        {
-            score = WhiteSearch ( board, 1, alpha, beta, true );
-            if ( !searchAborted )
-                move->score = score;
-        }
-        else
-        {
-            score = move->score = WhiteQSearch ( board, 1, alpha, beta, true );
-        }
-        board.UnmakeBlackMove ( *move, unmove );
-
-        BestPath *path = 0;
-        if ( !searchAborted )
-            path = SaveTLMBestPath ( *move );
-
-        if ( searchAborted )
-        {
-            if ( i > 0 )
-            {
-                // Invalidate all the remaining moves, to keep search
-                // bias from picking from them...
-
-                while ( i < rootml.num )
-                    rootml.m[i++].score = POSINF;
-            }
-        }
-        else
-        {
-            if ( score < bestscore )
-            {
-                bestmove = *move;
-                expectedScoreNow = bestscore = score;
-                userInterface.DisplayBestMoveSoFar ( board, bestmove, level );
-                if ( path )
-                {
-                    if ( oppTimeInstance )
-                        InsertPrediction ( board, *path, userInterface );
-                    else
-                        userInterface.DisplayBestPath ( board, *path );
-                }
-            }
-        }
-
-        if ( score < beta )
-            beta = score;
-    }
-
-    rootml.BlackSort();
-
-    userInterface.DebugExit ( 0, board, bestscore );
-
-#if DEBUG_BOARD_CORRUPTION
-    if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in BlackSearchRoot");
-#endif
-
-    return bestscore;
-}
-
-
-static SCORE AdjustCheckmateScore (
-    const TranspositionEntry *xpos,
-    int depth )
-{
-    SCORE score = xpos->bestReply.score;
-    if ( score > WON_FOR_WHITE )
-    {
-        int increasedDepth = depth - int(xpos->future);
-        score -= WIN_POSTPONEMENT(increasedDepth);
-    }
-    else if ( score < WON_FOR_BLACK )
-    {
-        int increasedDepth = depth - int(xpos->future);
-        score += WIN_POSTPONEMENT(increasedDepth);
-    }
-
-    return score;
-}
-
-
-SCORE ComputerChessPlayer::WhiteSearch (
-    ChessBoard  &board,
-    int          depth,
-    SCORE        alpha,
-    SCORE        beta,
-    bool     bestPathFlag )
-{
-    if ( depth < MAX_BESTPATH_DEPTH )
-        nextBestPath[depth].depth = depth - 1;
-
-    if ( CheckTimeLimit() )
-        return NEGINF;
+    if ( CheckTimeLimit() )
+        return Side::Worst;
 
     if ( depth < level && depth < MAX_BESTPATH_DEPTH )
     {
@@ -1092,44 +1528,43 @@ SCORE ComputerChessPlayer::WhiteSearch (
 #endif
 
     int          score;
-    int          bestscore = NEGINF;
-    int          i;
-    MoveList     ml;
+    int          bestscore = Side::Worst;
+    MovePicker   picker;
     UnmoveInfo   unmove;
-    Move        *move;
-    Move        *bestMove = 0;
+    Move         move;
+    Move         bestMove;
+    bool         foundBestMove = false;
+
+    // The side to move improves its own bound (White raises alpha, Black
+    // lowers beta), and is cut off when it reaches the opponent's bound.
+    // Only the own bound changes, so the originals tell the transposition
+    // table whether we failed low or high.
 
+    const SCORE  originalAlpha = alpha;
+    const SCORE  originalBeta  = beta;
+    SCORE &ownBound = Side::IsWhite ? alpha : beta;
+    SCORE &oppBound = Side::IsWhite ? beta  : alpha;
 
     moveOrder_bestPathFlag = bestPathFlag;
     moveOrder_depth = depth;
 
-    const TranspositionEntry *xpos = XposTable->locateWhiteMove (board);
+    TranspositionEntry xposCopy;
+    const TranspositionEntry *xpos = xposTable->locateMove ( board, xposCopy );
 
     if ( xpos )
         moveOrder_xposBestMove = xpos->bestReply;
     else
         moveOrder_xposBestMove.source = 0;  // so it will not match any legal move
 
-    board.GenWhiteMoves ( ml, this );
-    generated += ml.num;
-    if ( depth < NODES_ARRAY_SIZE )
-        gennodes[depth] += ml.num;
+    // Moves are generated lazily by the picker below, so checkmate and
+    // stalemate are only discovered when it runs dry.  A definite draw
+    // still needs a legal move, or else the game is already over.
 
     int numReps = 0;
-    if ( ml.num == 0 )
-    {
-        // This is the end of the game!
-        bestscore = (board.flags & SF_WCHECK)
-            ? (BLACK_WINS + WIN_POSTPONEMENT(depth))
-            : DRAW;
-
-        userInterface.DebugExit ( depth, board, bestscore );
-        return bestscore;
-    }
-    else if ( board.IsDefiniteDraw(&numReps) )
+    if ( board.IsDefiniteDraw(&numReps) && board.CanMove<Side>() )
     {
         bestscore = DRAW;
-        userInterface.DebugExit ( depth, board, bestscore );
+        DEBUG_EXIT ( depth, board, bestscore );
         return bestscore;
     }
 
@@ -1140,274 +1575,217 @@ SCORE ComputerChessPlayer::WhiteSearch (
     if ( xpos
         && xpos->searchedDepth >= level-depth
         && numReps < 2
-        && ml.IsLegal(xpos->bestReply) )
+        && xpos->scoreIsUsable(alpha,beta)
+        && board.MoveIsPseudoLegal<Side>(xposCopy.bestReply)
+        && MoveIsLegal<Side>(board,xposCopy.bestReply) )
     {
-        if ( xpos->scoreIsInsideWindow() && xpos->compatibleWindow(alpha,beta) )
-        {
-            if ( depth < MAX_BESTPATH_DEPTH )
-                nextBestPath[depth].m[depth] = xpos->bestReply;
+        if ( depth < MAX_BESTPATH_DEPTH )
+            nextBestPath[depth].m[depth] = xpos->bestReply;
 
-            userInterface.DebugExit ( depth, board, xpos->bestReply.score );
-            return AdjustCheckmateScore ( xpos, depth );
-        }
+        DEBUG_EXIT ( depth, board, xpos->bestReply.score );
+        return AdjustCheckmateScore ( xpos, depth );
     }
 
-    for ( i=0, move=&ml.m[0]; i < ml.num; i++, move++ )
-    {
-        ++visited;
-        if ( depth < NODES_ARRAY_SIZE )
-            ++visnodes[depth];
+    // Start the picker now: the null-move search below would clobber
+    // moveOrder_xposBestMove, which the picker needs.
 
-        bool nextBestPathFlag =
-            bestPathFlag &&
-            depth <= currentBestPath.depth &&
-            *move == currentBestPath.m[depth];
-
-        if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
-        {
-            userInterface.DebugPly ( depth, board, *move );
-        }
+    StartMovePicker ( picker, depth, bestPathFlag );
 
-        board.MakeWhiteMove ( *move, unmove, false, false );
+    // Null-move pruning: if the side to move can pass and a reduced-depth
+    // search still reaches the opponent's bound, some real move would
+    // almost certainly do so too.  Passing is only an advantage-free
+    // option when not in check and not in an endgame prone to zugzwang.
+    // Never pass twice in a row, and don't prune along the best path.
 
-        if ( depth < level )
-            score = BlackSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
+    if ( !bestPathFlag
+        && level - depth > NULL_MOVE_REDUCTION
+        && !Side::WinningBound(oppBound)
+        && !(board.flags & Side::CheckFlag)
+        && board.prev_move.dest != SPECIAL_MOVE_NULL
+        && Side::HasNullMoveMaterial(board) )
+    {
+        board.MakeNullMove ( unmove );
+        level -= NULL_MOVE_REDUCTION;
+        if ( Side::IsWhite )
+            score = Search<Opponent> ( board, depth+1, beta-1, beta, false );
         else
-            score = BlackQSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
-
-        board.UnmakeWhiteMove ( *move, unmove );
+            score = Search<Opponent> ( board, depth+1, alpha, alpha+1, false );
+        level += NULL_MOVE_REDUCTION;
+        board.UnmakeNullMove ( unmove );
 
-        if ( score > bestscore )
+        if ( Side::AtLeast(score,oppBound) && !searchAborted )
         {
-            bestMove = move;
-            bestMove->score = bestscore = score;
-            FoundBestMove ( *move, depth );
+            DEBUG_EXIT ( depth, board, score );
+            return score;
         }
-
-        if ( score >= beta )
-            break;   // PRUNE: Black has better (or at least as good) choices than getting here.
-
-        if ( score > alpha )
-            alpha = score;
     }
 
-    if ( bestMove )
+    while ( NextMove<Side>(board,picker,move) )
     {
-        SCORE *h = &whiteHist[bestMove->whiteHash()];
-        if ( *h < HASH_HIST_MAX )
-            *h += HASH_HIST_FUNC(*h,depth);
-        else
-            hitMaxHistory = true;
-
-        XposTable->rememberWhiteMove ( board, level, depth, *bestMove, alpha, beta );
-    }
-
-    userInterface.DebugExit ( depth, board, bestscore );
-
-#if DEBUG_BOARD_CORRUPTION
-    if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in WhiteSearch");
-#endif
-
-    return bestscore;
-}
+        ++visited;
+        if ( depth < NODES_ARRAY_SIZE )
+            ++visnodes[depth];
 
+        bool nextBestPathFlag =
+            bestPathFlag &&
+            depth <= currentBestPath.depth &&
+            move == currentBestPath.m[depth];
 
-SCORE ComputerChessPlayer::BlackSearch (
-    ChessBoard  &board,
-    int          depth,
-    SCORE        alpha,
-    SCORE        beta,
-    bool     bestPathFlag )
-{
-    if ( depth < MAX_BESTPATH_DEPTH )
-        nextBestPath[depth].depth = depth - 1;
+        DEBUG_PLY ( depth, board, move );
 
-    if ( CheckTimeLimit() )
-        return POSINF;
+        // Late move reduction: a quiet move this far down the ordered
+        // list is unlikely to be best, so first search it to a reduced
+        // depth and only search it fully if it beats our bound.  Moves
+        // that check or escape check, killers and best-path moves are exempt.
 
-    if ( depth < level && depth < MAX_BESTPATH_DEPTH )
-    {
-        hashPath[depth] = board.Hash();
-        const int limit = depth - 2;
-        for ( int rd = depth & 1; rd < limit; rd += 2 )
+        int reduction = 0;
+        if ( picker.stage == MPS_QUIET
+            && !nextBestPathFlag
+            && !(board.flags & Side::CheckFlag)
+            && !(move.source & CAUSES_CHECK_BIT) )
         {
-            if ( hashPath[rd] == hashPath[depth] )
-            {
-                if ( board.NumberOfRepetitions() != 1 )   //NOTE: 0 means board was edited
-                    return DRAW;
-                else
-                    break;
-            }
+            reduction = LateMoveReduction ( level - depth, picker.numLegal );
         }
-    }
 
-#if DEBUG_BOARD_CORRUPTION
-    UINT32 bcopy [144];
-    memcpy ( bcopy, board.board, sizeof(bcopy) );
-#endif
+        board.MakeMove<Side> ( move, unmove, false, false );
 
-    int          score;
-    int          bestscore = POSINF;
-    int          i;
-    MoveList     ml;
-    UnmoveInfo   unmove;
-    Move        *move;
-    Move        *bestMove = 0;
+        // Principal variation search: after the first move, try to prove
+        // each move is no better than our bound with a null window, and
+        // only search it again with the full window if it turns out better.
 
-    moveOrder_bestPathFlag = bestPathFlag;
-    moveOrder_depth = depth;
-
-    const TranspositionEntry *xpos = XposTable->locateBlackMove (board);
-
-    if ( xpos )
-        moveOrder_xposBestMove = xpos->bestReply;
-    else
-        moveOrder_xposBestMove.source = 0;  // so it will not match any legal move
-
-    board.GenBlackMoves ( ml, this );
-    generated += ml.num;
-    if ( depth < NODES_ARRAY_SIZE )
-        gennodes[depth] += ml.num;
-
-    int numReps = 0;
-    if ( ml.num == 0 )
-    {
-        // This is the end of the game!
-        bestscore = (board.flags & SF_BCHECK)
-            ? (WHITE_WINS - WIN_POSTPONEMENT(depth))
-            : DRAW;
+        SCORE childAlpha = alpha;
+        SCORE childBeta  = beta;
+        if ( picker.numLegal > 1 )
+        {
+            if ( Side::IsWhite )
+                childBeta = alpha + 1;
+            else
+                childAlpha = beta - 1;
+        }
 
-        userInterface.DebugExit ( depth, board, bestscore );
-        return bestscore;
-    }
-    else if ( board.IsDefiniteDraw(&numReps) )
-    {
-        bestscore = DRAW;
-        userInterface.DebugExit ( depth, board, bestscore );
-        return bestscore;
-    }
+        for(;;)
+        {
+            level -= reduction;
+            if ( depth < level )
+                score = Search<Opponent> ( board, depth+1, childAlpha, childBeta, nextBestPathFlag );
+            else
+                score = QSearch<Opponent> ( board, depth+1, childAlpha, childBeta, nextBestPathFlag );
+            level += reduction;
 
-    // Sometimes we can completely eliminate the search beneath this point!
-    // But we make sure to use transposition *only* after checking for
-    // draw by repetition.
+            if ( reduction > 0 )
+            {
+                reduction = 0;
+                if ( Side::Better(score,ownBound) && !searchAborted )
+                    continue;   // re-search at full depth
+                break;
+            }
 
-    if ( xpos
-        && xpos->searchedDepth >= level-depth
-        && numReps < 2
-        && ml.IsLegal(xpos->bestReply) )
-    {
-        if ( xpos->scoreIsInsideWindow() && xpos->compatibleWindow(alpha,beta) )
-        {
-            if ( depth < MAX_BESTPATH_DEPTH )
-                nextBestPath[depth].m[depth] = xpos->bestReply;
+            if ( (childAlpha == alpha && childBeta == beta) ||
+                 score <= alpha || score >= beta || searchAborted )
+                break;
 
-            userInterface.DebugExit ( depth, board, xpos->bestReply.score );
-            return AdjustCheckmateScore ( xpos, depth );
+            childAlpha = alpha;
+            childBeta  = beta;
         }
-    }
-
-    for ( i=0, move=&ml.m[0]; i < ml.num; i++, move++ )
-    {
-        ++visited;
-        if ( depth < NODES_ARRAY_SIZE )
-            ++visnodes[depth];
 
-        bool nextBestPathFlag =
-            bestPathFlag &&
-            depth <= currentBestPath.depth &&
-            *move == currentBestPath.m[depth];
+        board.UnmakeMove<Side> ( move, unmove );
 
-        if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
+        if ( Side::Better(score,bestscore) )
         {
-            userInterface.DebugPly ( depth, board, *move );
+            bestMove = move;
+            bestMove.score = bestscore = score;
+            foundBestMove = true;
+            FoundBestMove ( move, depth );
         }
 
-        board.MakeBlackMove ( *move, unmove, false, false );
-
-        if ( depth < level )
-            score = WhiteSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
-        else
-            score = WhiteQSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
-
-        board.UnmakeBlackMove ( *move, unmove );
-
-        if ( score < bestscore )
+        if ( Side::AtLeast(score,oppBound) )
         {
-            bestMove  = move;
-            bestMove->score = bestscore = score;
-            FoundBestMove ( *move, depth );
-        }
+            ++cutoffs;
+            if ( picker.numLegal == 1 )
+                ++firstMoveCutoffs;
 
-        if ( score <= alpha )
-            break;   // PRUNE: White has better (or at least as good) choices than getting here.
+            break;   // PRUNE: the opponent has better (or at least as good) choices than getting here.
+        }
 
-        if ( score < beta )
-            beta = score;
+        if ( Side::Better(score,ownBound) )
+            ownBound = score;
     }
 
-    if ( bestMove )
+    if ( picker.numLegal == 0 )
     {
-        SCORE *h = &blackHist [bestMove->blackHash()];
+        // This is the end of the game!
+        bestscore = (board.flags & Side::CheckFlag) ? Side::Mated(depth) : DRAW;
+    }
+    else if ( foundBestMove )
+    {
+        SCORE *h = &(Side::IsWhite ? whiteHist : blackHist) [Side::HistoryIndex(bestMove)];
         if ( *h < HASH_HIST_MAX )
             *h += HASH_HIST_FUNC(*h,depth);
         else
             hitMaxHistory = true;
 
-        XposTable->rememberBlackMove ( board, level, depth, *bestMove, alpha, beta );
+        Side::Remember ( xposTable, board, level, depth, bestMove, originalAlpha, originalBeta );
     }
 
-    userInterface.DebugExit ( depth, board, bestscore );
+    DEBUG_EXIT ( depth, board, bestscore );
 
 #if DEBUG_BOARD_CORRUPTION
     if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in BlackSearch");
+        ChessFatal ( Side::IsWhite ? "Board corruption found in Search<WhiteSide>" : "Board corruption found in Search<BlackSide>" );
 #endif
 
     return bestscore;
 }
 
 
-SCORE ComputerChessPlayer::WhiteQSearch (
+template <class Side>
+SCORE ComputerChessPlayer::QSearch (
     ChessBoard  &board,
     int          depth,
     SCORE        alpha,
     SCORE        beta,
     bool     bestPathFlag )
 {
+    typedef typename Side::Opponent Opponent;
+
     if ( depth < MAX_BESTPATH_DEPTH )
         nextBestPath[depth].depth = depth - 1;
 
     if ( CheckTimeLimit() )
-        return NEGINF;
+        return Side::Worst;
 
 #if DEBUG_BOARD_CORRUPTION
     UINT32 bcopy [144];
     memcpy ( bcopy, board.board, sizeof(bcopy) );
 #endif
 
+    const EvalFunction eval = Side::IsWhite ? whiteEval : blackEval;
+
     SCORE       score;
-    SCORE       bestscore = (this->*whiteEval) ( board, depth, alpha, beta );
+    SCORE       bestscore = (this->*eval) ( board, depth, alpha, beta );
     MoveList    ml;
     UnmoveInfo  unmove;
     int         i;
     Move       *move;
 
+    SCORE &ownBound = Side::IsWhite ? alpha : beta;
+    SCORE &oppBound = Side::IsWhite ? beta  : alpha;
+
     const bool escapeCheck =
-        (board.flags & SF_WCHECK)
+        (board.flags & Side::CheckFlag)
         && depth <= level + ESCAPE_CHECK_DEPTH;
 
-    if ( bestscore < beta || escapeCheck )
+    if ( Side::Better(oppBound,bestscore) || escapeCheck )
     {
         moveOrder_bestPathFlag = bestPathFlag;
         moveOrder_depth = depth;
 
         if ( escapeCheck )
-            board.GenWhiteMoves ( ml, this );
+            Side::GenMoves ( board, ml, this );
         else if ( depth <= level + maxCheckDepth )
-            GenWhiteCapturesAndChecks ( board, ml );
+            board.GenCapturesAndChecks<Side> ( ml, this );
         else
-            board.GenWhiteCaptures ( ml, this );
+            Side::GenCaptures ( board, ml, this );
 
         if ( depth < NODES_ARRAY_SIZE )
             gennodes[depth] += ml.num;
@@ -1415,102 +1793,16 @@ SCORE ComputerChessPlayer::WhiteQSearch (
         generated += ml.num;
         for ( i=0, move=&ml.m[0]; i < ml.num; i++, move++ )
         {
-            ++visited;
-            if ( depth < NODES_ARRAY_SIZE )
-                ++visnodes[depth];
-
-            bool nextBestPathFlag =
-                bestPathFlag &&
-                depth <= currentBestPath.depth &&
-                *move == currentBestPath.m[depth];
-
-            if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
-            {
-                userInterface.DebugPly ( depth, board, *move );
-            }
-
-            board.MakeWhiteMove ( *move, unmove, false, false );
-
-            if ( (board.flags & SF_BCHECK) || escapeCheck )
-                score = BlackSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
-            else
-                score = BlackQSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
-
-            board.UnmakeWhiteMove ( *move, unmove );
-
-            if ( score > bestscore )
-            {
-                move->score = bestscore = score;
-                FoundBestMove ( *move, depth );
-            }
-
-            if ( score >= beta )
-                break;      // PRUNE
-
-            if ( score > alpha )
-                alpha = score;
-        }
-    }
-
-    userInterface.DebugExit ( depth, board, bestscore );
-
-#if DEBUG_BOARD_CORRUPTION
-    if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in WhiteQSearch");
-#endif
-
-    return bestscore;
-}
-
-
-SCORE ComputerChessPlayer::BlackQSearch (
-    ChessBoard  &board,
-    int          depth,
-    SCORE        alpha,
-    SCORE        beta,
-    bool     bestPathFlag )
-{
-    if ( depth < MAX_BESTPATH_DEPTH )
-        nextBestPath[depth].depth = depth - 1;
-
-    if ( CheckTimeLimit() )
-        return POSINF;
-
-#if DEBUG_BOARD_CORRUPTION
-    UINT32 bcopy [144];
-    memcpy ( bcopy, board.board, sizeof(bcopy) );
-#endif
-
-    SCORE       score;
-    SCORE       bestscore = (this->*blackEval) ( board, depth, alpha, beta );
-    MoveList    ml;
-    UnmoveInfo  unmove;
-    int         i;
-    Move       *move;
-
-    const bool escapeCheck =
-        (board.flags & SF_BCHECK)
-        && depth <= level + ESCAPE_CHECK_DEPTH;
+            // Don't bother searching captures which lose material by
+            // static exchange, unless they check or we are escaping check.
 
-    if ( bestscore > alpha || escapeCheck )
-    {
-        moveOrder_bestPathFlag = bestPathFlag;
-        moveOrder_depth = depth;
+            if ( !escapeCheck &&
+                 !(move->source & CAUSES_CHECK_BIT) &&
+                 board.CaptureSEE<Side>(*move) < 0 )
+                continue;
 
-        if ( escapeCheck )
-            board.GenBlackMoves ( ml, this );
-        else if ( depth <= level + maxCheckDepth )
-            GenBlackCapturesAndChecks ( board, ml );
-        else
-            board.GenBlackCaptures ( ml, this );
-
-        if ( depth < NODES_ARRAY_SIZE )
-            gennodes[depth] += ml.num;
-
-        generated += ml.num;
-        for ( i=0, move=&ml.m[0]; i < ml.num; i++, move++ )
-        {
             ++visited;
+            ++quiescenceVisited;
             if ( depth < NODES_ARRAY_SIZE )
                 ++visnodes[depth];
 
@@ -1519,103 +1811,42 @@ SCORE ComputerChessPlayer::BlackQSearch (
                 depth <= currentBestPath.depth &&
                 *move == currentBestPath.m[depth];
 
-            if (!this->blunderAlert_QueryInstanceFlag())    // band-aid to prevent thread-safety problem with static variables
-            {
-                userInterface.DebugPly ( depth, board, *move );
-            }
+            DEBUG_PLY ( depth, board, *move );
 
-            board.MakeBlackMove ( *move, unmove, false, false );
+            board.MakeMove<Side> ( *move, unmove, false, false );
 
-            if ( (board.flags & SF_WCHECK) || escapeCheck )
-                score = WhiteSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
+            if ( (board.flags & Opponent::CheckFlag) || escapeCheck )
+                score = Search<Opponent> ( board, depth+1, alpha, beta, nextBestPathFlag );
             else
-                score = WhiteQSearch ( board, depth+1, alpha, beta, nextBestPathFlag );
+                score = QSearch<Opponent> ( board, depth+1, alpha, beta, nextBestPathFlag );
 
-            board.UnmakeBlackMove ( *move, unmove );
+            board.UnmakeMove<Side> ( *move, unmove );
 
-            if ( score < bestscore )
+            if ( Side::Better(score,bestscore) )
             {
                 move->score = bestscore = score;
                 FoundBestMove ( *move, depth );
             }
 
-            if ( score <= alpha )
+            if ( Side::AtLeast(score,oppBound) )
                 break;      // PRUNE
 
-            if ( score < beta )
-                beta = score;
+            if ( Side::Better(score,ownBound) )
+                ownBound = score;
         }
     }
 
-    userInterface.DebugExit ( depth, board, bestscore );
+    DEBUG_EXIT ( depth, board, bestscore );
 
 #if DEBUG_BOARD_CORRUPTION
     if ( memcmp(bcopy,board.board,sizeof(bcopy)) != 0 )
-        ChessFatal ("Board corruption found in BlackQSearch");
+        ChessFatal ( Side::IsWhite ? "Board corruption found in QSearch<WhiteSide>" : "Board corruption found in QSearch<BlackSide>" );
 #endif
 
     return bestscore;
 }
 
 
-void ComputerChessPlayer::GenWhiteCapturesAndChecks (
-    ChessBoard &board,
-    MoveList &ml )
-{
-    PROFILER_ENTER(PX_GENCAPS);
-    MoveList all;
-    board.GenWhiteMoves ( all, this );
-
-    // Keep only moves which cause check or are captures in 'ml'
-    ml.num = 0;
-    for ( int i=0; i<all.num; i++ )
-    {
-        Move move = all.m[i];
-        if ( move.source & CAUSES_CHECK_BIT )
-            ml.AddMove ( move );
-        else if ( move.dest > OFFSET(9,9) )
-        {
-            int special = move.dest & SPECIAL_MOVE_MASK;
-            if ( special != SPECIAL_MOVE_KCASTLE &&
-                 special != SPECIAL_MOVE_QCASTLE )
-                ml.AddMove ( move );
-        }
-        else if ( board.board[move.dest] != EMPTY )
-            ml.AddMove ( move );
-    }
-    PROFILER_EXIT();
-}
-
-
-void ComputerChessPlayer::GenBlackCapturesAndChecks (
-    ChessBoard &board,
-    MoveList &ml )
-{
-    PROFILER_ENTER(PX_GENCAPS);
-    MoveList all;
-    board.GenBlackMoves ( all, this );
-
-    // Keep only moves which cause check or are captures in 'ml'
-    ml.num = 0;
-    for ( int i=0; i<all.num; i++ )
-    {
-        Move move = all.m[i];
-        if ( move.source & CAUSES_CHECK_BIT )
-            ml.AddMove ( move );
-        else if ( move.dest > OFFSET(9,9) )
-        {
-            int special = move.dest & SPECIAL_MOVE_MASK;
-            if ( special != SPECIAL_MOVE_KCASTLE &&
-                 special != SPECIAL_MOVE_QCASTLE )
-                ml.AddMove ( move );
-        }
-        else if ( board.board[move.dest] != EMPTY )
-            ml.AddMove ( move );
-    }
-    PROFILER_EXIT();
-}
-
-
 void ComputerChessPlayer::SetMinSearchDepth (int _minSearchDepth)
 {
     expectedNextBoardHash = 0;  // prevent any possible recycling of best path info
@@ -1636,8 +1867,7 @@ void ComputerChessPlayer::SetTimeLimit ( INT32 hundredthsOfSeconds )
     maxlevel = NODES_ARRAY_SIZE/4 - 1;
     searchType = CCPST_TIMED_SEARCH;
     searchAborted = false;
-    timeLimit = (hundredthsOfSeconds >= 10) ? hundredthsOfSeconds : 10; // enforce minimum reasonable think time: 0.1 seconds.
-    stopTime = ChessTime() + timeLimit;
+    timeLimit = (hundredthsOfSeconds >= 1) ? hundredthsOfSeconds : 1;   // enforce minimum think time: 0.01 seconds.
 }
 
 
@@ -1650,12 +1880,78 @@ void ComputerChessPlayer::SetMaxNodesEvaluated ( UINT32 _maxNodesEvaluated )
 }
 
 
+void ComputerChessPlayer::SetMaxNodesVisited ( UINT32 _maxNodesVisited )
+{
+    maxlevel = NODES_ARRAY_SIZE/4 - 1;
+    searchType = CCPST_NODE_SEARCH;
+    searchAborted = false;
+    maxNodesVisited = (_maxNodesVisited < 100) ? 100 : _maxNodesVisited;
+}
+
+
 void ComputerChessPlayer::AbortSearch()
 {
     searchAborted = true;
 }
 
 
+void ComputerChessPlayer::AbortSearchCallback ( void *context )
+{
+    ((ComputerChessPlayer *)context)->AbortSearch();
+}
+
+
+//---------------------------------------------------------------------------
+
+void SearchStopToken::requestStop()
+{
+    std::lock_guard<std::mutex> lock ( mutex );
+    if ( !stopped.exchange(true) )
+    {
+        for ( size_t i=0; i < registrations.size(); ++i )
+            registrations[i].callback ( registrations[i].context );
+    }
+}
+
+
+void SearchStopToken::reset()
+{
+    std::lock_guard<std::mutex> lock ( mutex );
+    stopped = false;
+}
+
+
+void SearchStopToken::addCallback ( Callback callback, void *context )
+{
+    std::lock_guard<std::mutex> lock ( mutex );
+    if ( stopped )
+    {
+        callback ( context );
+    }
+    else
+    {
+        Registration r;
+        r.callback = callback;
+        r.context  = context;
+        registrations.push_back ( r );
+    }
+}
+
+
+void SearchStopToken::removeCallback ( Callback callback, void *context )
+{
+    std::lock_guard<std::mutex> lock ( mutex );
+    for ( size_t i=0; i < registrations.size(); ++i )
+    {
+        if ( registrations[i].callback == callback && registrations[i].context == context )
+        {
+            registrations.erase ( registrations.begin() + i );
+            break;
+        }
+    }
+}
+
+
 bool ComputerChessPlayer::CheckTimeLimit()
 {
     if ( searchAborted )
@@ -1669,53 +1965,188 @@ bool ComputerChessPlayer::CheckTimeLimit()
             return true;
         }
     }
-    if ( searchType == CCPST_TIMED_SEARCH )
+    else if ( searchType == CCPST_NODE_SEARCH )
     {
-        if ( ++timeCheckCounter >= timeCheckLimit )
+        if ( visited >= maxNodesVisited )
         {
-            timeCheckCounter = 0;
-            INT32 now = ChessTime();
+            searchAborted = true;
+            return true;
+        }
+    }
 
-            if ( now >= stopTime )
-            {
-                if ( extendSearchFlag )
-                {
-                    // See if the expected score got "worse" suddenly...
-                    INT32 deltaScore = INT32(expectedScoreNow) - INT32(expectedScorePrev);
+    if ( ++timeCheckCounter < SEARCH_POLL_NODES )
+        return false;
 
-                    if ( computerPlayingWhite )
-                        deltaScore = -deltaScore;
+    timeCheckCounter = 0;
+    INT64 now = timeManager.elapsedMicroseconds();
 
-                    if ( deltaScore > 60 )
-                    {
-                        // Things are worse than we thought... cancel timed
-                        // search and finish with fixed depth search instead.
+    if ( threadNpsLimit > 0 )
+    {
+        now = ThrottleSearch ( now );
+        if ( searchAborted )
+            return true;
+    }
 
-                        revertTimeLimit = timeLimit;  // will restore later
-                        SetSearchDepth ( level );
-                        return false;
-                    }
-                }
+    if ( now - checkpointTime >= SEARCH_CHECKPOINT_MICROSECONDS )
+    {
+        checkpointTime = now;
+        userInterface.SearchCheckpoint();   // may abort the search
+        if ( searchAborted )
+            return true;
+    }
 
-                if ( now - prevTime > 10 )
-                    timeCheckLimit /= 2;
+    if ( searchType == CCPST_TIMED_SEARCH && now >= timeManager.softDeadline() )
+    {
+        if ( now < timeManager.hardDeadline() )
+        {
+            // See if the expected score got "worse" suddenly.  If so, keep
+            // searching (up to the hard deadline) to find a way out.
+            INT32 deltaScore = INT32(expectedScoreNow) - INT32(expectedScorePrev);
 
-                searchAborted = true;
-                return true;
-            }
-            else if (now - prevTime < 5)   // less than 0.05 sec elapsed?
-            {
-                timeCheckLimit += 100;
-            }
+            if ( computerPlayingWhite )
+                deltaScore = -deltaScore;
 
-            prevTime = now;
+            if ( deltaScore > 60 )
+                return false;
         }
+
+        searchAborted = true;
+        return true;
     }
 
     return false;
 }
 
 
+INT64 ComputerChessPlayer::ThrottleSearch ( INT64 now )
+{
+    // Sleep until the nodes visited so far are no more than threadNpsLimit
+    // allows for the time spent.  Sleep in short naps, so that the user
+    // interface can still poll for input, and never past the deadline.
+    INT64 due = (INT64(visited) * 1000000) / threadNpsLimit;
+    if ( searchType == CCPST_TIMED_SEARCH && due > timeManager.hardDeadline() )
+        due = timeManager.hardDeadline();
+
+    while ( now < due && !searchAborted )
+    {
+        const INT64 nap = std::min ( due - now, INT64(SEARCH_CHECKPOINT_MICROSECONDS) );
+        std::this_thread::sleep_for ( std::chrono::microseconds(nap) );
+        now = timeManager.elapsedMicroseconds();
+
+        if ( now - checkpointTime >= SEARCH_CHECKPOINT_MICROSECONDS )
+        {
+            checkpointTime = now;
+            userInterface.SearchCheckpoint();   // may abort the search
+        }
+    }
+
+    return now;
+}
+
+
+static void AppendJson ( std::string &text, const char *format, ... )
+{
+    char buffer [128];
+    va_list args;
+    va_start ( args, format );
+    vsnprintf ( buffer, sizeof(buffer), format, args );
+    va_end ( args );
+    text += buffer;
+}
+
+
+static double StatsRatio ( UINT32 numerator, UINT32 denominator )
+{
+    return denominator ? (double(numerator) / denominator) : 0.0;
+}
+
+
+std::string FormatSearchStatsJson ( const SearchStats &stats )
+{
+    std::string json;
+    const SearchIterationStats *it = stats.iteration;
+    int depth = 0;
+    for ( int i=0; i < stats.numIterations; ++i )
+        if ( it[i].completed )
+            depth = it[i].depth;
+
+    AppendJson ( json, "{\"threads\":%d,\"timeMs\":%0.1lf,\"depth\":%d",
+        stats.numThreads, stats.microseconds / 1000.0, depth );
+
+    AppendJson ( json, ",\"nodes\":{\"visited\":%lu,\"evaluated\":%lu,\"generated\":%lu,\"quiescence\":%lu,\"quiescenceShare\":%0.4lf}",
+        (unsigned long) stats.visited,
+        (unsigned long) stats.evaluated,
+        (unsigned long) stats.generated,
+        (unsigned long) stats.quiescenceVisited,
+        StatsRatio ( stats.quiescenceVisited, stats.visited ) );
+
+    // Iterations count only the calling thread's nodes.  The effective
+    // branching factor is how many times as many nodes an iteration took
+    // as the one before it.
+    json += ",\"iterations\":[";
+    for ( int i=0; i < stats.numIterations; ++i )
+    {
+        const UINT32 nodes = it[i].visited - (i > 0 ? it[i-1].visited : 0);
+        const INT64 micros = it[i].microseconds - (i > 0 ? it[i-1].microseconds : 0);
+        AppendJson ( json, "%s{\"depth\":%d,\"completed\":%s,\"nodes\":%lu,\"timeMs\":%0.1lf,\"ebf\":",
+            (i > 0 ? "," : ""),
+            it[i].depth,
+            (it[i].completed ? "true" : "false"),
+            (unsigned long) nodes,
+            micros / 1000.0 );
+
+        const UINT32 prevNodes = (i > 0) ? (it[i-1].visited - (i > 1 ? it[i-2].visited : 0)) : 0;
+        if ( prevNodes > 0 )
+            AppendJson ( json, "%0.2lf}", double(nodes) / prevNodes );
+        else
+            json += "null}";
+    }
+    json += "]";
+
+    AppendJson ( json, ",\"cutoffs\":{\"total\":%lu,\"firstMove\":%lu,\"firstMoveRate\":%0.4lf}",
+        (unsigned long) stats.cutoffs,
+        (unsigned long) stats.firstMoveCutoffs,
+        StatsRatio ( stats.firstMoveCutoffs, stats.cutoffs ) );
+
+    const TranspositionStats &x = stats.xpos;
+    AppendJson ( json, ",\"tt\":{\"probes\":%lu,\"hits\":%lu,\"hitRate\":%0.4lf",
+        (unsigned long) x.tries,
+        (unsigned long) x.hits,
+        StatsRatio ( x.hits, x.tries ) );
+
+    AppendJson ( json, ",\"stores\":%lu,\"fresh\":%lu,\"stale\":%lu,\"stomped\":%lu,\"inferior\":%lu,\"failed\":%lu",
+        (unsigned long) x.stores,
+        (unsigned long) x.fresh,
+        (unsigned long) x.stales,
+        (unsigned long) x.stomps,
+        (unsigned long) x.inferior,
+        (unsigned long) x.failures );
+
+    AppendJson ( json, ",\"storeRate\":%0.4lf,\"replaceRate\":%0.4lf}",
+        StatsRatio ( x.fresh + x.stales + x.stomps, x.stores ),
+        StatsRatio ( x.stales + x.stomps, x.stores ) );
+
+    // Nodes by ply, up to the deepest one reached.
+    int numPlies = NODES_ARRAY_SIZE;
+    while ( numPlies > 0 && stats.visnodes[numPlies-1] == 0 && stats.gennodes[numPlies-1] == 0 )
+        --numPlies;
+
+    const char * const names[2] = { "visited", "generated" };
+    const UINT32 * const arrays[2] = { stats.visnodes, stats.gennodes };
+    json += ",\"plies\":{";
+    for ( int k=0; k < 2; ++k )
+    {
+        AppendJson ( json, "%s\"%s\":[", (k > 0 ? "," : ""), names[k] );
+        for ( int ply=0; ply < numPlies; ++ply )
+            AppendJson ( json, "%s%lu", (ply > 0 ? "," : ""), (unsigned long) arrays[k][ply] );
+        json += "]";
+    }
+    json += "}}";
+
+    return json;
+}
+
+
 void ComputerChessPlayer::SetSearchBias ( SCORE newSearchBias )
 {
     if ( newSearchBias >= 0 )
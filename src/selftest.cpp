@@ -0,0 +1,319 @@
+/*===============================================================================
+
+    selftest.cpp  -  Regression tests for Chenard.
+
+    "chenard --selftest" runs each of the checks below and prints PASS or
+    FAIL for it.  The exit status is 0 only if every check passes, so the
+    command can be used as a build gate.
+
+    Each check is a small function that sets up the situation a past bug
+    needed and returns true if the engine now does the right thing.
+
+=============================================================================*/
+
+#include <stdio.h>
+
+#include "chess.h"
+#include "side.h"
+
+
+// Makes the moves in 'notation' (separated by spaces) on 'board'.
+static bool MakeMoves ( ChessBoard &board, const char *notation )
+{
+    char word [16];
+    int length;
+    while ( sscanf ( notation, " %15s%n", word, &length ) == 1 )
+    {
+        Move move;
+        if ( !ParseFancyMove ( word, board, move ) )
+        {
+            printf ( "    cannot make move '%s'\n", word );
+            return false;
+        }
+
+        UnmoveInfo unmove;
+        board.MakeMove ( move, unmove );
+        notation += length;
+    }
+    return true;
+}
+
+
+// A null move (made by the search for null-move pruning) must be replayed
+// as a pass when the game history is scanned for repetitions; otherwise
+// the moves after it are made with the wrong side to move.
+static bool TestNullMoveRepetition()
+{
+    ChessBoard board;
+    if ( !MakeMoves ( board, "e4 d5" ) )
+        return false;
+
+    const UINT64 hashBefore = board.Hash();
+    UnmoveInfo nullUnmove;
+    board.MakeNullMove ( nullUnmove );
+
+    Move reply;
+    if ( !ParseFancyMove ( "dxe4", board, reply ) )
+    {
+        printf ( "    cannot make move 'dxe4' after a null move\n" );
+        return false;
+    }
+
+    UnmoveInfo replyUnmove;
+    board.MakeMove ( reply, replyUnmove );
+
+    const int reps = board.NumberOfRepetitions();
+    if ( reps != 1 )
+    {
+        printf ( "    NumberOfRepetitions() = %d, expected 1\n", reps );
+        return false;
+    }
+
+    if ( board.IsDefiniteDraw() )
+    {
+        printf ( "    IsDefiniteDraw() is true\n" );
+        return false;
+    }
+
+    board.UnmakeMove ( reply, replyUnmove );
+    board.UnmakeNullMove ( nullUnmove );
+    if ( board.Hash() != hashBefore || board.GetCurrentPlyNumber() != 2 || !board.WhiteToMove() )
+    {
+        printf ( "    board not restored after undoing the null move\n" );
+        return false;
+    }
+
+    return true;
+}
+
+
+// A position after a null move must not be counted as a repetition of
+// one from before the pass.  Here the position after 4...Ke8 comes up a
+// third time only because White passed once in between.
+static bool TestNullMoveBreaksRepetition()
+{
+    ChessBoard board;
+    if ( !MakeMoves ( board, "e4 e5 d4 d5 Ke2 Ke7 Ke1 Ke8 Ke2 Ke7 Ke1 Ke8" ) )
+        return false;
+
+    UnmoveInfo nullUnmove;
+    board.MakeNullMove ( nullUnmove );
+
+    if ( !MakeMoves ( board, "Ke7 Ke2 Kd7 Ke1 Ke8" ) )
+        return false;
+
+    const int reps = board.NumberOfRepetitions();
+    if ( reps != 1 )
+    {
+        printf ( "    NumberOfRepetitions() = %d, expected 1\n", reps );
+        return false;
+    }
+
+    if ( board.IsDefiniteDraw() )
+    {
+        printf ( "    IsDefiniteDraw() is true\n" );
+        return false;
+    }
+
+    return true;
+}
+
+
+// With multi-PV analysis, every line must be the one found for its own
+// first move, played out to the full search depth.  Each top-level move's
+// path used to be saved in the slot after its own, which cut the lines
+// short and gave some of them the wrong moves.
+static bool TestMultiPVLines()
+{
+    const int searchDepth = 4;
+    const int numLines = 4;
+
+    ChessBoard board;
+    if ( !board.SetForsythEdwardsNotation ( "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" ) )
+        return false;
+
+    ChessUI_Silent ui;
+    ChessEngineContext engine;
+    ComputerChessPlayer player ( ui, engine );
+    player.SetSearchDepth ( searchDepth );
+    player.SetSearchBias ( 0 );
+    player.SetOpeningBookEnable ( false );
+    player.SetTrainingEnable ( false );
+    player.setResignFlag ( false );
+    player.SetMultiPV ( numLines );
+
+    Move move;
+    INT32 timeSpent = 0;
+    if ( !player.GetMove ( board, move, timeSpent ) )
+        return false;
+
+    BestPath lines [MAX_MULTI_PV];
+    const int count = player.GetPrincipalVariations ( lines, MAX_MULTI_PV );
+    if ( count != numLines )
+    {
+        printf ( "    GetPrincipalVariations() = %d, expected %d\n", count, numLines );
+        return false;
+    }
+
+    for ( int i=0; i < count; ++i )
+    {
+        // BestPath::depth is the index of the last move in the line.
+        if ( lines[i].depth < searchDepth - 1 )
+        {
+            printf ( "    line %d has %d moves, expected at least %d\n", i+1, lines[i].depth + 1, searchDepth );
+            return false;
+        }
+
+        for ( int k=0; k < i; ++k )
+        {
+            if ( lines[k].m[0] == lines[i].m[0] )
+            {
+                printf ( "    lines %d and %d start with the same move\n", k+1, i+1 );
+                return false;
+            }
+        }
+
+        ChessBoard line = board;
+        for ( int ply=0; ply <= lines[i].depth; ++ply )
+        {
+            MoveList ml;
+            line.GenMoves ( ml );
+            if ( !ml.IsLegal ( lines[i].m[ply] ) )
+            {
+                printf ( "    line %d has an illegal move at ply %d\n", i+1, ply+1 );
+                return false;
+            }
+
+            UnmoveInfo unmove;
+            line.MakeMove ( lines[i].m[ply], unmove );
+        }
+    }
+
+    return true;
+}
+
+
+// Compares GenCapturesAndChecks with the legal moves of the position
+// that capture, promote or check, checks being found by making each move.
+template <class Side>
+static bool CheckCapturesAndChecks ( ChessBoard &board, const char *fen )
+{
+    MoveList legal, found;
+    board.GenMoves ( legal );
+    board.GenCapturesAndChecks<Side> ( found );
+
+    int expected = 0;
+    for ( int i=0; i < legal.num; ++i )
+    {
+        Move move = legal.m[i];
+        UnmoveInfo unmove;
+        board.MakeMove ( move, unmove );
+        const bool checks = board.CurrentPlayerInCheck();
+        board.UnmakeMove ( move, unmove );
+
+        const bool castles = (move.dest & SPECIAL_MOVE_MASK) == SPECIAL_MOVE_KCASTLE ||
+                             (move.dest & SPECIAL_MOVE_MASK) == SPECIAL_MOVE_QCASTLE;
+        const bool quiet = castles || (move.dest <= OFFSET(9,9) && board.GetSquareContents(move.dest) == EMPTY);
+
+        if ( quiet && !castles && board.MoveMayCheck<Side>(move) != checks )
+        {
+            printf ( "    %s: MoveMayCheck is wrong about move %d\n", fen, i );
+            return false;
+        }
+
+        if ( quiet && !checks )
+            continue;
+
+        ++expected;
+        if ( !found.IsLegal ( move ) )
+        {
+            printf ( "    %s: move %d is missing\n", fen, i );
+            return false;
+        }
+    }
+
+    if ( found.num != expected )
+    {
+        printf ( "    %s: %d moves generated, expected %d\n", fen, found.num, expected );
+        return false;
+    }
+
+    return true;
+}
+
+
+// The quiescence search's checks are generated outward from the enemy
+// king rather than filtered out of all the moves, so every way of giving
+// check needs a position: knights, sliders, pawn pushes, discovered
+// checks and castling, for both sides.
+static bool TestCapturesAndChecks()
+{
+    static const char * const positions[] =
+    {
+        "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 3",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 0 1",
+        "k7/8/2P5/8/4B3/8/4N3/4R1K1 w - - 0 1",
+        "4r1k1/8/8/4n3/8/2p5/8/K1B5 b - - 0 1",
+        "8/8/8/3k4/8/8/2P1P3/6K1 w - - 0 1",
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+        "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+        "8/8/8/8/8/8/8/2k1K2R w K - 0 1",
+        "r3k3/8/8/8/8/8/8/3K4 b q - 0 1",
+        "r3k2r/8/8/8/8/8/8/5K2 b kq - 0 1",
+    };
+
+    const int numPositions = sizeof(positions) / sizeof(positions[0]);
+    for ( int i=0; i < numPositions; ++i )
+    {
+        ChessBoard board;
+        if ( !board.SetForsythEdwardsNotation ( positions[i] ) )
+        {
+            printf ( "    cannot load '%s'\n", positions[i] );
+            return false;
+        }
+
+        const bool passed = board.WhiteToMove() ?
+            CheckCapturesAndChecks<WhiteSide> ( board, positions[i] ) :
+            CheckCapturesAndChecks<BlackSide> ( board, positions[i] );
+
+        if ( !passed )
+            return false;
+    }
+
+    return true;
+}
+
+
+struct SelfTest
+{
+    const char  *name;
+    bool       (*run)();
+};
+
+static const SelfTest SelfTests[] =
+{
+    { "null move repetition",           TestNullMoveRepetition },
+    { "null move breaks repetition",    TestNullMoveBreaksRepetition },
+    { "multi-PV lines",                 TestMultiPVLines },
+    { "captures and checks",            TestCapturesAndChecks },
+};
+
+
+int RunSelfTest()
+{
+    const int numTests = sizeof(SelfTests) / sizeof(SelfTests[0]);
+    int numFailed = 0;
+    for ( int i=0; i < numTests; ++i )
+    {
+        const bool passed = SelfTests[i].run();
+        printf ( "%s  %s\n", passed ? "PASS" : "FAIL", SelfTests[i].name );
+        if ( !passed )
+            ++numFailed;
+    }
+
+    printf ( "\n%d of %d tests passed.\n", numTests - numFailed, numTests );
+    return numFailed ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+/*===============================================================================
+
+    side.h  -  Compile-time descriptions of White and Black for Chenard.
+
+    Code that is the same for both sides apart from the direction of
+    scores, the pieces involved and which board methods it calls is
+    written once, as a template on one of the traits classes below, and
+    the compiler specializes it for each side.  Every difference between
+    White's and Black's point of view is a compile-time constant or an
+    inline call, so the specialized code is as fast as a hand-written copy.
+
+    Include after chess.h.
+
+=============================================================================*/
+#ifndef __ddc_chenard_side_h
+#define __ddc_chenard_side_h
+
+struct BlackSide;
+
+struct WhiteSide
+{
+    typedef BlackSide Opponent;
+
+    enum
+    {
+        IsWhite   = 1,
+        CheckFlag = SF_WCHECK,
+        Worst     = NEGINF,
+
+        Mask       = WHITE_MASK,    // any of White's pieces
+        PawnMask   = WP_MASK,
+        KnightMask = WN_MASK,
+        BishopMask = WB_MASK,
+        RookMask   = WR_MASK,
+        QueenMask  = WQ_MASK,
+        KingMask   = WK_MASK,
+
+        Pawn   = WPAWN,
+        Knight = WKNIGHT,
+        Bishop = WBISHOP,
+        Rook   = WROOK,
+        Queen  = WQUEEN,
+        King   = WKING,
+        Index = WHITE_IND,          // side bit of the piece indices
+        PawnIndex = WP_INDEX,
+
+        KingMoved      = SF_WKMOVED,
+        KingRookMoved  = SF_WKRMOVED,
+        QueenRookMoved = SF_WQRMOVED,
+
+        Forward  = NORTH,
+        PawnEast = NORTHEAST,   // the directions in which White's pawns capture
+        PawnWest = NORTHWEST,
+
+        // The y in OFFSET(x,y) of the ranks that matter to White's pieces.
+        BackRank      = 2,      // where the king and rooks start
+        PawnRank      = 3,      // where the pawns start
+        EnPassantRank = 6,      // where a pawn can capture en passant
+        SeventhRank   = 8       // where a pawn promotes with its next move
+    };
+
+    // Is score 'a' better for White than score 'b'?
+    static bool Better ( int a, int b )    { return a > b; }
+    static bool AtLeast ( int a, int b )   { return a >= b; }
+
+    static SCORE Mated ( int depth )   { return BLACK_WINS + WIN_POSTPONEMENT(depth); }
+    static bool  WinningBound ( SCORE bound )   { return bound >= WON_FOR_WHITE; }
+
+    // Does a move from 'source' to 'dest' leave White's first three ranks going forward?
+    static bool AdvancesFromHome ( int source, int dest )   { return source <= OFFSET(9,4) && dest >= source+10; }
+
+    // Rank of 'ofs' counted from White's side of the board, 1..8.
+    static int Rank ( int ofs )   { return YPART(ofs) - 1; }
+
+    static UINT16 &KingOffset ( ChessBoard &b )   { return b.wk_offset; }
+    static SCORE  &Material ( ChessBoard &b )     { return b.wmaterial; }
+    static int    *RepeatHash ( ChessBoard &b )   { return b.whiteRepeatHash; }     // positions with White to move
+    static bool    Attacks ( const ChessBoard &b, int ofs )   { return b.IsAttackedByWhite(ofs); }
+
+    static void GenMoves ( ChessBoard &b, MoveList &ml, ComputerChessPlayer *p )
+        { b.GenWhiteMoves ( ml, p ); }
+    static void GenCaptures ( ChessBoard &b, MoveList &ml, ComputerChessPlayer *p )
+        { b.GenWhiteCaptures ( ml, p ); }
+
+    static void Sort ( MoveList &ml )   { ml.WhiteSort(); }
+
+    static void MoveOrdering ( ComputerChessPlayer *p, ChessBoard &b, Move &m, UnmoveInfo &u )
+        { p->WhiteMoveOrdering ( b, m, u, p->moveOrder_depth, p->moveOrder_bestPathFlag ); }
+
+    // Enough material that passing is unlikely to be a zugzwang escape:
+    // a queen or rook, or at least two minor pieces.
+    static bool HasNullMoveMaterial ( const ChessBoard &b )
+    {
+        const INT16 *inv = b.queryInventoryPointer();
+        return inv[WQ_INDEX] + inv[WR_INDEX] > 0 || inv[WN_INDEX] + inv[WB_INDEX] > 1;
+    }
+
+    static int HistoryIndex ( const Move &m )   { return m.whiteHash(); }
+
+    static void Remember (
+        TranspositionTable *table,
+        ChessBoard &b,
+        int level,
+        int depth,
+        Move bestReply,
+        SCORE alpha,
+        SCORE beta )
+    {
+        table->rememberWhiteMove ( b, level, depth, bestReply, alpha, beta );
+    }
+};
+
+
+struct BlackSide
+{
+    typedef WhiteSide Opponent;
+
+    enum
+    {
+        IsWhite   = 0,
+        CheckFlag = SF_BCHECK,
+        Worst     = POSINF,
+
+        Mask       = BLACK_MASK,
+        PawnMask   = BP_MASK,
+        KnightMask = BN_MASK,
+        BishopMask = BB_MASK,
+        RookMask   = BR_MASK,
+        QueenMask  = BQ_MASK,
+        KingMask   = BK_MASK,
+
+        Pawn   = BPAWN,
+        Knight = BKNIGHT,
+        Bishop = BBISHOP,
+        Rook   = BROOK,
+        Queen  = BQUEEN,
+        King   = BKING,
+        Index = BLACK_IND,
+        PawnIndex = BP_INDEX,
+
+        KingMoved      = SF_BKMOVED,
+        KingRookMoved  = SF_BKRMOVED,
+        QueenRookMoved = SF_BQRMOVED,
+
+        Forward  = SOUTH,
+        PawnEast = SOUTHEAST,
+        PawnWest = SOUTHWEST,
+
+        BackRank      = 9,
+        PawnRank      = 8,
+        EnPassantRank = 5,
+        SeventhRank   = 3
+    };
+
+    static bool Better ( int a, int b )    { return a < b; }
+    static bool AtLeast ( int a, int b )   { return a <= b; }
+
+    static SCORE Mated ( int depth )   { return WHITE_WINS - WIN_POSTPONEMENT(depth); }
+    static bool  WinningBound ( SCORE bound )   { return bound <= WON_FOR_BLACK; }
+
+    static bool AdvancesFromHome ( int source, int dest )   { return source >= OFFSET(2,7) && dest <= source-10; }
+
+    static int Rank ( int ofs )   { return 10 - YPART(ofs); }
+
+    static UINT16 &KingOffset ( ChessBoard &b )   { return b.bk_offset; }
+    static SCORE  &Material ( ChessBoard &b )     { return b.bmaterial; }
+    static int    *RepeatHash ( ChessBoard &b )   { return b.blackRepeatHash; }
+    static bool    Attacks ( const ChessBoard &b, int ofs )   { return b.IsAttackedByBlack(ofs); }
+
+    static void GenMoves ( ChessBoard &b, MoveList &ml, ComputerChessPlayer *p )
+        { b.GenBlackMoves ( ml, p ); }
+    static void GenCaptures ( ChessBoard &b, MoveList &ml, ComputerChessPlayer *p )
+        { b.GenBlackCaptures ( ml, p ); }
+
+    static void Sort ( MoveList &ml )   { ml.BlackSort(); }
+
+    static void MoveOrdering ( ComputerChessPlayer *p, ChessBoard &b, Move &m, UnmoveInfo &u )
+        { p->BlackMoveOrdering ( b, m, u, p->moveOrder_depth, p->moveOrder_bestPathFlag ); }
+
+    static bool HasNullMoveMaterial ( const ChessBoard &b )
+    {
+        const INT16 *inv = b.queryInventoryPointer();
+        return inv[BQ_INDEX] + inv[BR_INDEX] > 0 || inv[BN_INDEX] + inv[BB_INDEX] > 1;
+    }
+
+    static int HistoryIndex ( const Move &m )   { return m.blackHash(); }
+
+    static void Remember (
+        TranspositionTable *table,
+        ChessBoard &b,
+        int level,
+        int depth,
+        Move bestReply,
+        SCORE alpha,
+        SCORE beta )
+    {
+        table->rememberBlackMove ( b, level, depth, bestReply, alpha, beta );
+    }
+};
+
+
+#endif /* __ddc_chenard_side_h */
@@ -11,67 +11,137 @@
 #include "chess.h"
 #include "profiler.h"
 
-#define TRANSPOSE_POOL_SIZE   49663
-#define COLLISION_RESOLVE     16       // number of entries to search when collisions found
+#if CHENARD_LINUX
+    #include <sys/mman.h>
+#endif
 
+#define CACHE_LINE_SIZE       64
+#define HUGE_PAGE_SIZE        (2 * 1024 * 1024)
 
-TranspositionTable  *ComputerChessPlayer::XposTable = 0;   // users must lazy init
+
+#if CHENARD_LINUX
+
+// Big tables are spread across so many pages that TLB misses cost
+// almost as much as cache misses.  Try explicit huge pages first,
+// then fall back to ordinary pages with a transparent huge page hint.
+// Either way the kernel hands us zeroed, page-aligned memory.
+static char *AllocateTableMemory ( size_t numBytes )
+{
+    void *p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if ( numBytes >= HUGE_PAGE_SIZE && (numBytes % HUGE_PAGE_SIZE) == 0 )
+        p = mmap ( 0, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+#endif
+
+    if ( p == MAP_FAILED )
+    {
+        p = mmap ( 0, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( p == MAP_FAILED )
+            return 0;
+
+#ifdef MADV_HUGEPAGE
+        if ( numBytes >= HUGE_PAGE_SIZE )
+            madvise ( p, numBytes, MADV_HUGEPAGE );     // only a hint: ignore failure
+#endif
+    }
+
+    return static_cast<char *> (p);
+}
+
+
+static void FreeTableMemory ( char *memory, size_t numBytes )
+{
+    munmap ( memory, numBytes );
+}
+
+#else
+
+// Other platforms get no huge pages, and we have to align and zero the memory ourselves.
+static char *AllocateTableMemory ( size_t )
+{
+    return 0;
+}
+
+
+static void FreeTableMemory ( char *, size_t )
+{
+}
+
+#endif
 
 
 TranspositionTable::TranspositionTable (int memorySizeInMegabytes)
 {
+    if (sizeof(TranspositionBucket) != CACHE_LINE_SIZE)
+    {
+        ChessFatal ("TranspositionBucket does not fill exactly one cache line");
+    }
+
     if (memorySizeInMegabytes < 1)
     {
-        if (sizeof(int) < 4)
-        {
-            numTableEntries = 65500 / sizeof(TranspositionEntry);
-        }
-        else
-        {
-            numTableEntries = TRANSPOSE_POOL_SIZE;      // about 800K worth of table
-        }
+        memorySizeInMegabytes = 1;
     }
-    else
+    else if (memorySizeInMegabytes > MAX_XPOS_MEGABYTES)
     {
-        if (memorySizeInMegabytes > 1024)
-        {
-            memorySizeInMegabytes = 1024;   // enforce a 1GB limit to avoid integer overflow
-        }
+        memorySizeInMegabytes = MAX_XPOS_MEGABYTES;
+    }
 
-        // divide by 2 because there are 2 transposition tables (one for White and one for Black)...
-        int entriesPerMegabyte = (1024 * 1024 / 2) / sizeof(TranspositionEntry);      // will result in a tiny amount of rounding down... who cares
-        numTableEntries = memorySizeInMegabytes * entriesPerMegabyte;
+    if (sizeof(size_t) < 8 && memorySizeInMegabytes > 1024)
+    {
+        memorySizeInMegabytes = 1024;   // enforce a 1GB limit to avoid integer overflow on 32-bit platforms
     }
 
+    const size_t maxBuckets = (size_t(memorySizeInMegabytes) << 20) / sizeof(TranspositionBucket);
+    numBuckets = 1;
+    while (2*numBuckets <= maxBuckets)
+    {
+        numBuckets *= 2;
+    }
+    bucketMask = numBuckets - 1;
+
     init ();
 }
 
 
 void TranspositionTable::init ()
 {
-    whiteTable = new TranspositionEntry [numTableEntries];
-    blackTable = new TranspositionEntry [numTableEntries];
+    memorySize = numBuckets * sizeof(TranspositionBucket);
+    memory = AllocateTableMemory ( memorySize );
+    memoryMapped = (memory != 0);
+    if ( memoryMapped )
+    {
+        // Already zeroed, so there is no need to touch every page now.
+        buckets = reinterpret_cast<TranspositionBucket *> (memory);
+        generation = 0;
+        numHits = numTries = 0;
+        numStomps = numStores = numFresh = numStales = numFailures = numInferior = 0;
+    }
+    else
+    {
+        // Allocate an extra cache line so that every bucket can start on a cache line boundary.
+        memorySize += CACHE_LINE_SIZE;
+        memory = new char [memorySize];
+        if ( !memory )
+            ChessFatal ( "Out of memory allocating TranspositionTable" );
 
-    if ( !whiteTable || !blackTable )
-        ChessFatal ( "Out of memory allocating TranspositionTable" );
+        size_t misalign = reinterpret_cast<size_t>(memory) % CACHE_LINE_SIZE;
+        buckets = reinterpret_cast<TranspositionBucket *> (memory + (misalign ? (CACHE_LINE_SIZE - misalign) : 0));
 
-    reset();
+        reset();
+    }
 }
 
 
 TranspositionTable::~TranspositionTable()
 {
-    if ( whiteTable )
-    {
-        delete[] whiteTable;
-        whiteTable = 0;
-    }
+    if ( memoryMapped )
+        FreeTableMemory ( memory, memorySize );
+    else
+        delete[] memory;
 
-    if ( blackTable )
-    {
-        delete[] blackTable;
-        blackTable = 0;
-    }
+    memory = 0;
+    buckets = 0;
 }
 
 
@@ -79,8 +149,8 @@ void TranspositionTable::reset()
 {
     PROFILER_ENTER(PX_XPOS);
 
-    memset ( whiteTable, 0, numTableEntries * sizeof(TranspositionEntry) );
-    memset ( blackTable, 0, numTableEntries * sizeof(TranspositionEntry) );
+    memset ( buckets, 0, numBuckets * sizeof(TranspositionBucket) );
+    generation = 0;
     numHits = numTries = 0;
     numStomps = numStores = numFresh = numStales = numFailures = numInferior = 0;
 
@@ -90,16 +160,9 @@ void TranspositionTable::reset()
 
 void TranspositionTable::startNewSearch()
 {
-    PROFILER_ENTER(PX_XPOS);
-
-    // set all staleness flags...
-    for ( unsigned i=0; i < numTableEntries; ++i )
-    {
-        whiteTable[i].flags |= XF_STALE;
-        blackTable[i].flags |= XF_STALE;
-    }
-
-    PROFILER_EXIT();
+    // Every entry stored before now becomes stale.
+    // This used to require setting a flag in every entry of the table.
+    ++generation;
 }
 
 
@@ -117,7 +180,7 @@ void TranspositionTable::rememberWhiteMove (
     if ( searchedDepth < 0 )
         searchedDepth = 0;
 
-    rememberMove ( board, searchedDepth, depth, bestReply, alpha, beta, whiteTable, true );
+    rememberMove ( board, searchedDepth, depth, bestReply, alpha, beta, true );
 
     PROFILER_EXIT();
 }
@@ -137,29 +200,34 @@ void TranspositionTable::rememberBlackMove (
     if ( searchedDepth < 0 )
         searchedDepth = 0;
 
-    rememberMove ( board, searchedDepth, depth, bestReply, alpha, beta, blackTable, false );
+    rememberMove ( board, searchedDepth, depth, bestReply, alpha, beta, false );
 
     PROFILER_EXIT();
 }
 
 
-const TranspositionEntry *TranspositionTable::locateWhiteMove (
-    ChessBoard &board )
-{
-    PROFILER_ENTER(PX_XPOS);
-    const TranspositionEntry *xpos = locateMove ( board, whiteTable );
-    PROFILER_EXIT();
-    return xpos;
-}
-
-
-const TranspositionEntry *TranspositionTable::locateBlackMove (
-    ChessBoard &board )
+static void StoreEntry (
+    TranspositionEntry &x,
+    UINT32 keyCheck,
+    int searchedDepth,
+    int future,
+    Move bestReply,
+    BYTE bound,
+    BYTE generation )
 {
-    PROFILER_ENTER(PX_XPOS);
-    const TranspositionEntry *xpos = locateMove ( board, blackTable );
-    PROFILER_EXIT();
-    return xpos;
+    // The entry is built up on the side and copied into the table in one go,
+    // but other threads may still see a mixture of its old and new fields.
+    // Those mixtures fail TranspositionEntry::matches, because the key check
+    // is stored XORed with a check of all the other fields.
+    TranspositionEntry entry;
+    entry.searchedDepth = BYTE(searchedDepth);
+    entry.future = BYTE(future);
+    entry.flags = bound;
+    entry.generation = generation;
+    entry.bestReply = bestReply;
+    entry.reserved[0] = entry.reserved[1] = entry.reserved[2] = entry.reserved[3] = 0;
+    entry.keyCheck = keyCheck ^ entry.dataCheck();
+    x = entry;
 }
 
 
@@ -170,27 +238,37 @@ void TranspositionTable::rememberMove (
     Move bestReply,
     SCORE alpha,
     SCORE beta,
-    TranspositionEntry *table,
     bool whiteToMove )
 {
     ++numStores;
-    UINT32 hashCode = board.Hash();
-    const unsigned idealIndex = hashCode % numTableEntries;
-
-    // Go through 3 passes to find a slot to store the new <board,reply> tuple...
+    const UINT64 hashCode = board.Hash();
+    const UINT32 check = keyCheck ( hashCode );
+    TranspositionBucket &bucket = findBucket ( hashCode );
+
+    BYTE bound;
+    if ( bestReply.score <= alpha )
+        bound = XF_UPPER;
+    else if ( bestReply.score >= beta )
+        bound = XF_LOWER;
+    else
+        bound = XF_EXACT;
 
-    // Pass 1: search for a completely unused slot (hash == 0), or old
-    // copies of the same board position.
+    // Pass 1: look for old copies of the same board position,
+    // and remember any completely unused slot we see along the way.
 
-    unsigned index = idealIndex;
-    int retry;
-    for ( retry=0; retry < COLLISION_RESOLVE; ++retry )
+    TranspositionEntry *unused = 0;
+    int k;
+    for ( k=0; k < XPOS_BUCKET_SIZE; ++k )
     {
-        TranspositionEntry &x = table[index];
-        bool better = false;
-
-        if ( x.boardHash == hashCode )
+        TranspositionEntry &x = bucket.entry[k];
+        if ( !x.isUsed() )
+        {
+            if ( !unused )
+                unused = &x;
+        }
+        else if ( x.matches ( check ) )
         {
+            bool better = false;
             if ( searchedDepth > x.searchedDepth )
                 better = true;
             else if ( searchedDepth == x.searchedDepth )
@@ -198,138 +276,169 @@ void TranspositionTable::rememberMove (
                 // If the searches are of equal depth, employ tie-breakers
                 // for replacement.
 
-                bool newInsideWindow =
-                    alpha <= bestReply.score && bestReply.score <= beta;
+                if ( !x.scoreIsExact() )
+                    better = (bound == XF_EXACT) || future < x.future;
+            }
 
-                if ( !x.scoreIsInsideWindow() )
-                {
-                    better = newInsideWindow || future < x.future;
-                }
+            if ( better )
+            {
+                ++numFresh;
+                StoreEntry ( x, check, searchedDepth, future, bestReply, bound, generation );
+            }
+            else
+            {
+                ++numInferior;
+                // The deeper entry is still useful to this search.
+                StoreEntry ( x, check, x.searchedDepth, x.future, x.bestReply, x.flags & XF_BOUND, generation );
             }
-        }
-        else if ( x.boardHash == 0 )
-            better = true;
 
-        if ( better )
-        {
-            ++numFresh;
-            x.boardHash = hashCode;
-            x.searchedDepth = searchedDepth;
-            x.future = future;
-            x.flags &= ~XF_STALE;
-            x.bestReply = bestReply;
-            x.alpha = alpha;
-            x.beta = beta;
-            return;
-        }
-        else if ( x.boardHash == hashCode )
-        {
-            ++numInferior;
             return;   // the position was inside the table, so don't search any more
         }
+    }
 
-        if ( ++index >= numTableEntries )
-            index = 0;
+    if ( unused )
+    {
+        ++numFresh;
+        StoreEntry ( *unused, check, searchedDepth, future, bestReply, bound, generation );
+        return;
     }
 
-    // Pass 2: search for slot with "stale" bit set.
+    // Pass 2: replace a stale entry (one stored by an earlier search),
+    // preferring the oldest, and then the shallowest.
 
-    index = idealIndex;
-    for ( retry=0; retry < COLLISION_RESOLVE; ++retry )
+    TranspositionEntry *victim = 0;
+    for ( k=0; k < XPOS_BUCKET_SIZE; ++k )
     {
-        TranspositionEntry &x = table[index];
-        if ( x.flags & XF_STALE )
+        TranspositionEntry &x = bucket.entry[k];
+        const int xAge = age(x);
+        if ( xAge > 0 )
         {
-            ++numStales;
-            x.boardHash = hashCode;
-            x.searchedDepth = searchedDepth;
-            x.future = future;
-            x.flags &= ~XF_STALE;
-            x.bestReply = bestReply;
-            x.alpha = alpha;
-            x.beta = beta;
-            return;
+            if ( !victim ||
+                 xAge > age(*victim) ||
+                 (xAge == age(*victim) && x.searchedDepth < victim->searchedDepth) )
+                victim = &x;
         }
+    }
 
-        if ( ++index >= numTableEntries )
-            index = 0;
+    if ( victim )
+    {
+        ++numStales;
+        StoreEntry ( *victim, check, searchedDepth, future, bestReply, bound, generation );
+        return;
     }
 
     // Pass 3: as a last resort, try to find an "inferior"
-    // entry in the table to stomp on.
+    // entry in the bucket to stomp on.  Board positions found higher
+    // in the tree are likelier to be requested in the future.
 
-    for ( retry=0; retry < COLLISION_RESOLVE; ++retry )
+    for ( k=0; k < XPOS_BUCKET_SIZE; ++k )
     {
-        TranspositionEntry &x = table[index];
+        TranspositionEntry &x = bucket.entry[k];
+        if ( !victim ||
+             x.searchedDepth < victim->searchedDepth ||
+             (x.searchedDepth == victim->searchedDepth && x.future > victim->future) )
+            victim = &x;
+    }
 
-        bool newMoveBetter = (searchedDepth > x.searchedDepth);
-        if ( !newMoveBetter )
+    bool newMoveBetter = (searchedDepth > victim->searchedDepth);
+    if ( !newMoveBetter )
+    {
+        if ( searchedDepth == victim->searchedDepth )
         {
-            if ( searchedDepth == x.searchedDepth )
-            {
-                // we need tie-breaker!
+            // we need tie-breaker!
 
-                if ( future < x.future )
-                {
-                    // Board positions found higher in the tree are likelier to
-                    // be requested in the future
+            if ( future < victim->future )
+                newMoveBetter = true;
+            else if ( future == victim->future )
+            {
+                // secondary tie-breaker... better score means that this
+                // move might be more likely to cause pruning in the future.
 
-                    newMoveBetter = true;
-                }
-                else if ( future == x.future )
-                {
-                    // secondary tie-breaker... better score means that this
-                    // move might be more likely to cause pruning in the future.
-
-                    if ( whiteToMove )
-                    {
-                        if ( bestReply.score > x.bestReply.score )
-                            newMoveBetter = true;
-                    }
-                    else
-                    {
-                        if ( bestReply.score < x.bestReply.score )
-                            newMoveBetter = true;
-                    }
-                }
+                if ( whiteToMove )
+                    newMoveBetter = (bestReply.score > victim->bestReply.score);
+                else
+                    newMoveBetter = (bestReply.score < victim->bestReply.score);
             }
         }
+    }
+
+    if ( newMoveBetter )
+    {
+        ++numStomps;
+        StoreEntry ( *victim, check, searchedDepth, future, bestReply, bound, generation );
+        return;
+    }
+
+    ++numFailures;
+}
+
+
+const TranspositionEntry *TranspositionTable::locateMove (
+    ChessBoard &board )
+{
+    PROFILER_ENTER(PX_XPOS);
 
-        if ( newMoveBetter )
+    const TranspositionEntry *xpos = 0;
+    ++numTries;
+    const UINT64 hashCode = board.Hash();
+    const UINT32 check = keyCheck ( hashCode );
+    TranspositionBucket &bucket = findBucket ( hashCode );
+    for ( int k=0; k < XPOS_BUCKET_SIZE; ++k )
+    {
+        const TranspositionEntry &x = bucket.entry[k];
+        if ( x.matches ( check ) && x.isUsed() )
         {
-            ++numStomps;
-            x.boardHash = hashCode;
-            x.searchedDepth = searchedDepth;
-            x.future = future;
-            x.flags &= ~XF_STALE;
-            x.bestReply = bestReply;
-            x.alpha = alpha;
-            x.beta = beta;
-            return;
+            ++numHits;
+            xpos = &x;
+            break;
         }
-
-        if ( ++index >= numTableEntries )
-            index = 0;
     }
 
-    ++numFailures;
+    PROFILER_EXIT();
+    return xpos;
 }
 
 
 const TranspositionEntry *TranspositionTable::locateMove (
     ChessBoard &board,
-    TranspositionEntry *table )
+    TranspositionEntry &copy )
 {
+    PROFILER_ENTER(PX_XPOS);
+
+    const TranspositionEntry *xpos = 0;
     ++numTries;
-    UINT32 hashCode = board.Hash();
-    unsigned index = 0;
-    if ( findEntry(hashCode,table,index) )
+    const UINT64 hashCode = board.Hash();
+    const UINT32 check = keyCheck ( hashCode );
+    TranspositionBucket &bucket = findBucket ( hashCode );
+    for ( int k=0; k < XPOS_BUCKET_SIZE; ++k )
     {
-        ++numHits;
-        return &table[index];
+        // Another thread may be storing into this slot while we copy it.
+        // The copy is only trusted if its key check matches its own fields
+        // (see StoreEntry), which a copy torn between two stores does not.
+        copy = bucket.entry[k];
+        if ( copy.matches ( check ) && copy.isUsed() )
+        {
+            ++numHits;
+            xpos = &copy;
+            break;
+        }
     }
 
-    return 0;
+    PROFILER_EXIT();
+    return xpos;
+}
+
+
+void TranspositionTable::queryStats ( TranspositionStats &stats ) const
+{
+    stats.tries    = numTries;
+    stats.hits     = numHits;
+    stats.stores   = numStores;
+    stats.fresh    = numFresh;
+    stats.stales   = numStales;
+    stats.stomps   = numStomps;
+    stats.failures = numFailures;
+    stats.inferior = numInferior;
 }
 
 
@@ -351,24 +460,22 @@ void TranspositionTable::debugDump ( const char *filename ) const
         fprintf ( f, "store checksum = %u\n\n",
                   numStomps + numInferior + numFresh + numStales + numFailures );
 
-        fprintf ( f, "%8s %3s %3s %2s %3s %3s %6s %6s %6s  %8s %3s %3s %2s %3s %3s %6s %6s %6s: %9s\n\n",
-                  "hash", "dep", "fut", "fl", "src", "dst", "score", "alpha", "beta",
-                  "hash", "dep", "fut", "fl", "src", "dst", "score", "alpha", "beta",
-                  "index" );
+        fprintf ( f, "%8s %3s %3s %2s %3s %3s %3s %6s: %9s %s\n\n",
+                  "check", "dep", "fut", "fl", "age", "src", "dst", "score", "bucket", "slot" );
 
-        for ( unsigned i=0; i < numTableEntries; ++i )
+        for ( size_t i=0; i < numBuckets; ++i )
         {
-            const TranspositionEntry &w = whiteTable[i];
-            const TranspositionEntry &b = blackTable[i];
-
-            fprintf ( f, "%8x %3u %3u %2x %3u %3u %6d %6d %6d  %8x %3u %3u %2x %3u %3u %6d %6d %6d: %9u\n",
-                      w.boardHash, unsigned(w.searchedDepth), unsigned(w.future), unsigned(w.flags),
-                      unsigned(w.bestReply.source), unsigned(w.bestReply.dest), int(w.bestReply.score),
-                      int(w.alpha), int(w.beta),
-                      b.boardHash, unsigned(b.searchedDepth), unsigned(b.future), unsigned(b.flags),
-                      unsigned(b.bestReply.source), unsigned(b.bestReply.dest), int(b.bestReply.score),
-                      int(b.alpha), int(b.beta),
-                      i );
+            for ( int k=0; k < XPOS_BUCKET_SIZE; ++k )
+            {
+                const TranspositionEntry &x = buckets[i].entry[k];
+                if ( x.isUsed() )
+                {
+                    fprintf ( f, "%08x %3u %3u %2x %3d %3u %3u %6d: %9lu %d\n",
+                              x.keyCheck, unsigned(x.searchedDepth), unsigned(x.future), unsigned(x.flags), age(x),
+                              unsigned(x.bestReply.source), unsigned(x.bestReply.dest), int(x.bestReply.score),
+                              (unsigned long)i, k );
+                }
+            }
         }
 
         fclose (f);
@@ -376,32 +483,6 @@ void TranspositionTable::debugDump ( const char *filename ) const
 }
 
 
-bool TranspositionTable::findEntry (
-    UINT32 hashCode,
-    TranspositionEntry *table,
-    unsigned &findIndex )
-{
-    // figure out ideal position in given hash table...
-    unsigned index = hashCode % numTableEntries;
-    for ( int retry=0; retry < COLLISION_RESOLVE; ++retry )
-    {
-        if ( table[index].boardHash == hashCode )
-        {
-            findIndex = index;
-            return true;
-        }
-
-        if ( table[index].boardHash == 0 )
-            return false;   // would have found it by now
-
-        if ( ++index >= numTableEntries )
-            index = 0;  // wrap around end of table
-    }
-
-    return false;
-}
-
-
 /*
     $Log: transpos.cpp,v $
     Revision 1.5  2009/09/16 16:49:34  Don.Cross
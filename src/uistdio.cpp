@@ -45,7 +45,8 @@ ChessUI_stdio::ChessUI_stdio():
     whitePlayer(0),
     blackPlayer(0),
     boardDisplayType(BDT_STANDARD),
-    combatModeComputerSide(SIDE_NEITHER)
+    combatModeComputerSide(SIDE_NEITHER),
+    statsFilename(0)
 {
     remove(LogFilename);
 }
@@ -815,6 +816,20 @@ void ChessUI_stdio::ReportComputerStats (
 }
 
 
+void ChessUI_stdio::ReportSearchStats ( const SearchStats &stats )
+{
+    if ( statsFilename )
+    {
+        FILE *statsFile = fopen ( statsFilename, "at" );
+        if ( statsFile )
+        {
+            fprintf ( statsFile, "%s\n", FormatSearchStatsJson(stats).c_str() );
+            fclose ( statsFile );
+        }
+    }
+}
+
+
 void ChessFatal ( const char *message )
 {
     fprintf ( stderr, "Fatal chess error: %s\n", message );
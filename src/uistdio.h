@@ -66,6 +66,14 @@ public:
                                UINT32  gen [NODES_ARRAY_SIZE] );
 
     virtual void ReportSpecial ( const char *msg );
+    void ReportSearchStats ( const SearchStats & );
+
+    // Append the statistics of every search to this file, one line of JSON each.
+    void SetStatsFilename ( const char *filename )
+    {
+        statsFilename = filename;
+    }
+
     void SetScoreDisplay ( bool _showScores )
     {
         showScores = _showScores;
@@ -99,6 +107,7 @@ private:
     BoardDisplayType  boardDisplayType;
     
     ChessSide combatModeComputerSide;   // if not SIDE_NEITHER, determines automatic assignment of computer-vs-human
+    const char *statsFilename;          // NULL unless SetStatsFilename was called
 };
 
 
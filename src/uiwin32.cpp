@@ -620,10 +620,6 @@ bool ProcessChessCommands ( ChessBoard &board, int &source, int &dest )
                 const char *resultFormat =
                     "Benchmark completed in %0.2lf seconds\n\n"
                     "Your computer is %0.2lf times as fast as the author's 100 MHz Pentium."
-#ifdef CHENARD_PROFILER
-                    "\n\ntime data: {%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d}\n"
-                    "call data: {%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d}\n\n"
-#endif
 
 #if REQUEST_BENCHMARK_DATA
                     "\n\nIf you feel like it, send email to me <cosinekitty@hotmail.com> with your computer's "
@@ -636,32 +632,14 @@ bool ProcessChessCommands ( ChessBoard &board, int &source, int &dest )
                 sprintf ( msg, resultFormat,
                           timeElapsed,
                           290.0 / timeElapsed
-#ifdef CHENARD_PROFILER
-                          , ProfilerHitCount[0],
-                          ProfilerHitCount[1],
-                          ProfilerHitCount[2],
-                          ProfilerHitCount[3],
-                          ProfilerHitCount[4],
-                          ProfilerHitCount[5],
-                          ProfilerHitCount[6],
-                          ProfilerHitCount[7],
-                          ProfilerHitCount[8],
-                          ProfilerHitCount[9],
-
-                          ProfilerCallCount[0],
-                          ProfilerCallCount[1],
-                          ProfilerCallCount[2],
-                          ProfilerCallCount[3],
-                          ProfilerCallCount[4],
-                          ProfilerCallCount[5],
-                          ProfilerCallCount[6],
-                          ProfilerCallCount[7],
-                          ProfilerCallCount[8],
-                          ProfilerCallCount[9]
-#endif
                         );
 
+#ifdef CHENARD_PROFILER
+                std::string report = std::string(msg) + "\n\n" + ProfilerReport();
+                MessageBox ( HwndMain, report.c_str(), CHESS_PROGRAM_NAME, MB_OK );
+#else
                 MessageBox ( HwndMain, msg, CHESS_PROGRAM_NAME, MB_OK );
+#endif
                 TheBoardDisplayBuffer.update (board);
                 TheBoardDisplayBuffer.freshenBoard();
             }
@@ -1681,6 +1659,13 @@ void ChessUI_win32_gui::DebugExit ( int depth, ChessBoard &board, SCORE score )
 }
 
 
+bool ChessUI_win32_gui::WantsDebugPly() const
+{
+    // DebugPly is only needed to show the current search path.
+    return Global_AnalysisType == 2;
+}
+
+
 void ChessUI_win32_gui::DisplayBestPath (
     const ChessBoard &_board,
     const BestPath &path )
@@ -1690,7 +1675,7 @@ void ChessUI_win32_gui::DisplayBestPath (
 
     // It should not be possible to get here without having
     // initialized the transposition tables, but why risk a crash?
-    ComputerChessPlayer::LazyInitXposTable();
+    TranspositionTable &xposTable = ChessEngineContext::Default().GetTranspositionTable();
 
     // We change the board here, but we put it back the way we find it!
     ChessBoard &board = (ChessBoard &) _board;
@@ -1710,11 +1695,7 @@ void ChessUI_win32_gui::DisplayBestPath (
         if ( i > n )
         {
             // Try to find best move from transposition table
-            const TranspositionEntry *xpos;
-            if ( board.WhiteToMove() )
-                xpos = ComputerChessPlayer::XposTable->locateWhiteMove(board);
-            else
-                xpos = ComputerChessPlayer::XposTable->locateBlackMove(board);
+            const TranspositionEntry *xpos = xposTable.locateMove(board);
 
             if ( xpos )
             {
@@ -18,10 +18,7 @@
 #include "uixboard.h"
 #include "lrntree.h"
 
-const int CHECK_INPUT_INTERVAL = 5000;
-
 ChessUI_xboard::ChessUI_xboard():
-    checkInputCounter (0),
     adHocTextEnabled (false),
     thinkingDisplayEnabled (false),
     levelCache (0),
@@ -123,102 +120,96 @@ void ChessUI_xboard::AbortSearch (const char *verb, const char *rest)
 }
 
 
-void ChessUI_xboard::DebugPly (int /*depth*/, ChessBoard &, Move)
+void ChessUI_xboard::SearchCheckpoint()
 {
-    // We use this method override as a hack for checking for xboard input while thinking.
-    // This function gets called a LOT during the search, so we have to be careful about performance.
-    // For efficiency, we check for input (by calling IsInputReady) only every now and then.
-
-    if (++checkInputCounter >= CHECK_INPUT_INTERVAL)
+    // The search calls this a few times a second while thinking, so we can
+    // check for xboard input (by calling IsInputReady) without slowing it down.
+
+    // If we receive an xboard command that we are not ready to execute now,
+    // we save the command away in pendingVerb and pendingRest and abort the search.
+    // Once this happens, we still could get more calls here to SearchCheckpoint.
+    // Therefore we must check to make sure the search has not yet been aborted
+    // before looking for any xboard commands, lest we skip over a command,
+    // causing it to be ignored.
+    if (!GlobalAbortFlag && !player->IsSearchAborted())
     {
-        checkInputCounter = 0;
-
-        // If we receive an xboard command that we are not ready to execute now,
-        // we save the command away in pendingVerb and pendingRest and abort the search.
-        // Once this happens, we still could get more calls here to DebugPly.
-        // Therefore we must check to make sure the search has not yet been aborted
-        // before looking for any xboard commands, lest we skip over a command,
-        // causing it to be ignored.
-        if (!GlobalAbortFlag && !player->IsSearchAborted())
+        if (IsInputReady())
         {
-            if (IsInputReady())
+            // xboard is trying to talk to us, even though we are thinking!
+            // See if it is the "?" command, meaning "move now", or something else important like "quit"...
+            char verb [MAX_XBOARD_LINE];
+            const char *rest = ReadCommandFromXboard (verb);
+            if (rest)
             {
-                // xboard is trying to talk to us, even though we are thinking!
-                // See if it is the "?" command, meaning "move now", or something else important like "quit"...
-                char verb [MAX_XBOARD_LINE];
-                const char *rest = ReadCommandFromXboard (verb);
-                if (rest)
+                if (CommandMayBeIgnored(verb))       // There are some commands we can safely ignore, so as to avoid disturbing an active search.
+                {
+                    dprintf ("Ignoring command while thinking: %s %s\n", verb, rest);
+                }
+                else
                 {
-                    if (CommandMayBeIgnored(verb))       // There are some commands we can safely ignore, so as to avoid disturbing an active search.
+                    if (0 == strcmp(verb,"?"))
+                    {
+                        player->AbortSearch();
+                    }
+                    else if (0 == strcmp(verb,"force"))
+                    {
+                        ReceiveForceCommand();
+                        player->AbortSearch();
+                    }
+                    else if (0 == strcmp(verb,"quit"))
+                    {
+                        GlobalAbortFlag = true;
+                        ReceiveForceCommand();
+                        player->AbortSearch();
+                    }
+                    else if (0 == strcmp(verb,"post"))
+                    {
+                        EnableThinkingDisplay (true);
+                    }
+                    else if (0 == strcmp(verb,"nopost"))
                     {
-                        dprintf ("Ignoring command while thinking: %s %s\n", verb, rest);
+                        EnableThinkingDisplay (false);
                     }
                     else
                     {
-                        if (0 == strcmp(verb,"?"))
+                        // If we are pondering, we may get commands like "time", "otim", "usermove".
+                        // Make note of "time" and "otim", and respond conditionally to "usermove",
+                        // based on whether we predicted the opponent correctly.
+                        if (pondering)
                         {
-                            player->AbortSearch();
-                        }
-                        else if (0 == strcmp(verb,"force"))
-                        {
-                            ReceiveForceCommand();
-                            player->AbortSearch();
-                        }
-                        else if (0 == strcmp(verb,"quit"))
-                        {
-                            GlobalAbortFlag = true;
-                            ReceiveForceCommand();
-                            player->AbortSearch();
-                        }
-                        else if (0 == strcmp(verb,"post"))
-                        {
-                            EnableThinkingDisplay (true);
-                        }
-                        else if (0 == strcmp(verb,"nopost"))
-                        {
-                            EnableThinkingDisplay (false);
-                        }
-                        else
-                        {
-                            // If we are pondering, we may get commands like "time", "otim", "usermove".
-                            // Make note of "time" and "otim", and respond conditionally to "usermove",
-                            // based on whether we predicted the opponent correctly.
-                            if (pondering)
+                            if (0 == strcmp(verb,"time"))
                             {
-                                if (0 == strcmp(verb,"time"))
-                                {
-                                    myPonderClock = atoi(rest);
-                                }
-                                else if (0 == strcmp(verb,"usermove"))
-                                {
-                                    if (LooksLikeMove(rest))
-                                    {
-                                        OnIncomingUserMove (rest);
-                                    }
-                                }
-                                else if (0 == strcmp(verb,"hint"))
-                                {
-                                    printf ("Hint: %s\n", predictedAlgebraic);
-                                }
-                                else if (0 == strcmp(verb,"ping"))
-                                {
-                                    // The xboard spec says we must reply to ping commands immediately while pondering.
-                                    printf ("pong %s\n", rest);
-                                }
-                                else if (LooksLikeMove(verb))               // needed in case usermove feature was not available
-                                {
-                                    OnIncomingUserMove (verb);
-                                }
-                                else
+                                myPonderClock = atoi(rest);
+                            }
+                            else if (0 == strcmp(verb,"usermove"))
+                            {
+                                if (LooksLikeMove(rest))
                                 {
-                                    AbortSearch (verb, rest);
+                                    OnIncomingUserMove (rest);
                                 }
                             }
+                            else if (0 == strcmp(verb,"hint"))
+                            {
+                                printf ("Hint: %s\n", predictedAlgebraic);
+                            }
+                            else if (0 == strcmp(verb,"ping"))
+                            {
+                                // The xboard spec says we must reply to ping commands immediately while pondering.
+                                printf ("pong %s\n", rest);
+                            }
+                            else if (LooksLikeMove(verb))               // needed in case usermove feature was not available
+                            {
+                                OnIncomingUserMove (verb);
+                            }
                             else
                             {
                                 AbortSearch (verb, rest);
                             }
                         }
+                        else
+                        {
+                            AbortSearch (verb, rest);
+                        }
                     }
                 }
             }
@@ -381,6 +372,12 @@ void ChessUI_xboard::ReportSpecial ( const char * /*message*/ )
 {
 }
 
+void ChessUI_xboard::ReportSearchStats ( const SearchStats &stats )
+{
+    // Shows up in the engine debug log of the GUI, for tuning the search.
+    dprintf ("stats %s\n", FormatSearchStatsJson(stats).c_str());
+}
+
 
 /*
     $Log: uixboard.cpp,v $
@@ -14,7 +14,7 @@ const size_t MAX_XBOARD_LINE = 256;    // I really hope this is big enough!
 const char *ReadCommandFromXboard (char *verb);
 void ReceiveForceCommand();
 bool IsInputReady();
-extern bool GlobalAbortFlag;
+extern std::atomic<bool> GlobalAbortFlag;    // may be set by the stdin reader thread
 bool LooksLikeMove (const char *string, int &source, int &dest, int &prom);
 inline bool LooksLikeMove (const char *string)
 {
@@ -42,7 +42,7 @@ public:
     ChessUI_xboard();
     ~ChessUI_xboard();
 
-    virtual void DebugPly ( int depth, ChessBoard &, Move );     // we use this as a hack for checking for xboard input while thinking
+    virtual void SearchCheckpoint();     // checks for xboard input while thinking
 
 
     ChessPlayer *CreatePlayer ( ChessSide );
@@ -69,6 +69,7 @@ public:
                                UINT32  gen [NODES_ARRAY_SIZE] );
 
     virtual void ReportSpecial ( const char *msg );
+    void ReportSearchStats ( const SearchStats & );
     virtual void SetAdHocText ( int index, const char *, ... );
 
     void SetComputerChessPlayer (ComputerChessPlayer *_player)
@@ -107,7 +108,6 @@ protected:
     void AbortSearch (const char *verb, const char *rest);
 
 private:
-    int     checkInputCounter;          // helps us check for xboard input every now and then
     bool    adHocTextEnabled;           // set to true to monitor progress of endgame database file generation
     bool    thinkingDisplayEnabled;     // enables/disables display of thinking to WinBoard/xboard (post/nopost commands)
     int     levelCache;                 // used to hold current search level for thinking display
@@ -12,13 +12,16 @@
 ============================================================================*/
 
 #include "chess.h"
+#include "side.h"
+#include "bitboard.h"
 #include "profiler.h"
 
 #define DEBUG_UNMOVE 0
 
-void ChessBoard::UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )
+template <class Side>
+void ChessBoard::UnmakeMove ( Move move, UnmoveInfo &unmove )
 {
-    PROFILER_ENTER(PX_UNMOVE);
+    PROFILER_DETAIL_ENTER(PX_UNMOVE);
 
     int      source = move.source & BOARD_OFFSET_MASK;
     int      dest;
@@ -27,7 +30,7 @@ void ChessBoard::UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )
 
 #if DEBUG_UNMOVE
     if ( board[source] != EMPTY )
-        ChessFatal ( "source not empty in UnmakeWhiteMove" );
+        ChessFatal ( "source not empty in UnmakeMove" );
 
     SQUARE destSquare = EMPTY;
 #endif
@@ -39,81 +42,97 @@ void ChessBoard::UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )
         switch ( move.dest & 0xF0 )
         {
         case SPECIAL_MOVE_PROMOTE_NORM:
-            prom_piece_index = (move.dest & PIECE_MASK) | WHITE_IND;
-            dest = source + NORTH;
+            prom_piece_index = (move.dest & PIECE_MASK) | Side::Index;
+            dest = source + Side::Forward;
 #if DEBUG_UNMOVE
             destSquare = board[dest];
 #endif
-            board [source] = WPAWN;
+            BB_TOGGLE ( board[dest], dest );
+            BB_TOGGLE ( Side::Pawn, source );
+            board [source] = Side::Pawn;
             board [dest] = EMPTY;
-            ++inventory [WP_INDEX];
+            ++inventory [Side::PawnIndex];
             --inventory [prom_piece_index];
             break;
 
         case SPECIAL_MOVE_PROMOTE_CAP_EAST:
-            prom_piece_index = (move.dest & PIECE_MASK) | WHITE_IND;
-            dest = source + NORTHEAST;
+            prom_piece_index = (move.dest & PIECE_MASK) | Side::Index;
+            dest = source + Side::PawnEast;
 #if DEBUG_UNMOVE
             destSquare = board[dest];
 #endif
-            board [source] = WPAWN;
+            BB_TOGGLE ( board[dest], dest );
+            BB_TOGGLE ( Side::Pawn, source );
+            BB_TOGGLE ( capture, dest );
+            board [source] = Side::Pawn;
             board [dest] = capture;
-            ++inventory [WP_INDEX];
+            ++inventory [Side::PawnIndex];
             --inventory [prom_piece_index];
             break;
 
         case SPECIAL_MOVE_PROMOTE_CAP_WEST:
-            prom_piece_index = (move.dest & PIECE_MASK) | WHITE_IND;
-            dest = source + NORTHWEST;
+            prom_piece_index = (move.dest & PIECE_MASK) | Side::Index;
+            dest = source + Side::PawnWest;
 #if DEBUG_UNMOVE
             destSquare = board[dest];
 #endif
-            board [source] = WPAWN;
+            BB_TOGGLE ( board[dest], dest );
+            BB_TOGGLE ( Side::Pawn, source );
+            BB_TOGGLE ( capture, dest );
+            board [source] = Side::Pawn;
             board [dest] = capture;
-            ++inventory [WP_INDEX];
+            ++inventory [Side::PawnIndex];
             --inventory [prom_piece_index];
             break;
 
         case SPECIAL_MOVE_KCASTLE:
 #if DEBUG_UNMOVE
-            destSquare = board[OFFSET(8,2)];
+            destSquare = board[OFFSET(8, Side::BackRank)];
 #endif
-            wk_offset = OFFSET(6,2);
-            board [ OFFSET(6,2) ] = WKING;
-            board [ OFFSET(9,2) ] = WROOK;
-            board [ OFFSET(7,2) ] = board [ OFFSET(8,2) ] = EMPTY;
+            Side::KingOffset(*this) = OFFSET(6, Side::BackRank);
+            BB_MOVE ( Side::King, OFFSET(8, Side::BackRank), OFFSET(6, Side::BackRank) );
+            BB_MOVE ( Side::Rook, OFFSET(7, Side::BackRank), OFFSET(9, Side::BackRank) );
+            board [ OFFSET(6, Side::BackRank) ] = Side::King;
+            board [ OFFSET(9, Side::BackRank) ] = Side::Rook;
+            board [ OFFSET(7, Side::BackRank) ] = board [ OFFSET(8, Side::BackRank) ] = EMPTY;
             break;
 
         case SPECIAL_MOVE_QCASTLE:
 #if DEBUG_UNMOVE
-            destSquare = board[OFFSET(4,2)];
+            destSquare = board[OFFSET(4, Side::BackRank)];
 #endif
-            wk_offset = OFFSET(6,2);
-            board [ OFFSET(6,2) ] = WKING;
-            board [ OFFSET(2,2) ] = WROOK;
-            board [ OFFSET(4,2) ] = board [ OFFSET(5,2) ] = EMPTY;
+            Side::KingOffset(*this) = OFFSET(6, Side::BackRank);
+            BB_MOVE ( Side::King, OFFSET(4, Side::BackRank), OFFSET(6, Side::BackRank) );
+            BB_MOVE ( Side::Rook, OFFSET(5, Side::BackRank), OFFSET(2, Side::BackRank) );
+            board [ OFFSET(6, Side::BackRank) ] = Side::King;
+            board [ OFFSET(2, Side::BackRank) ] = Side::Rook;
+            board [ OFFSET(4, Side::BackRank) ] = board [ OFFSET(5, Side::BackRank) ] = EMPTY;
             break;
 
         case SPECIAL_MOVE_EP_EAST:
-            board [source] = board [dest = source + NORTHEAST];
+            board [source] = board [dest = source + Side::PawnEast];
 #if DEBUG_UNMOVE
             destSquare = board[dest];
 #endif
+            BB_MOVE ( Side::Pawn, dest, source );
+            BB_TOGGLE ( capture, source + EAST );
             board [dest] = EMPTY;
             board [source + EAST] = capture;
             break;
 
         case SPECIAL_MOVE_EP_WEST:
-            board [source] = board [dest = source + NORTHWEST];
+            board [source] = board [dest = source + Side::PawnWest];
 #if DEBUG_UNMOVE
             destSquare = board[dest];
 #endif
+            BB_MOVE ( Side::Pawn, dest, source );
+            BB_TOGGLE ( capture, source + WEST );
             board [dest] = EMPTY;
             board [source + WEST] = capture;
             break;
 
         default:
-            ChessFatal ( "Invalid special move code in ChessBoard::UnmakeWhiteMove" );
+            ChessFatal ( "Invalid special move code in ChessBoard::UnmakeMove" );
             break;
         }
     }
@@ -126,14 +145,17 @@ void ChessBoard::UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )
         destSquare = board[dest];
 #endif
         board[dest] = capture;
+        BB_MOVE ( move_piece, dest, source );
+        if ( capture != EMPTY )
+            BB_TOGGLE ( capture, dest );
 
-        if ( move_piece & WK_MASK )
-            wk_offset = source;
+        if ( move_piece & Side::KingMask )
+            Side::KingOffset(*this) = source;
     }
 
 #if DEBUG_UNMOVE
-    if ( !(destSquare & WHITE_MASK) )
-        ChessFatal ( "Attempt to unmove non-white piece in UnmakeWhiteMove" );
+    if ( !(destSquare & Side::Mask) )
+        ChessFatal ( "Attempt to unmove enemy piece in UnmakeMove" );
 #endif
 
     if ( capture != EMPTY )
@@ -144,156 +166,17 @@ void ChessBoard::UnmakeWhiteMove ( Move move, UnmoveInfo &unmove )
     wmaterial        =  unmove.wmaterial;
     prev_move        =  unmove.prev_move;
     lastCapOrPawn    =  unmove.lastCapOrPawn;
-    --blackRepeatHash[cachedHash % REPEAT_HASH_SIZE];  // no longer Black to move
+    --Side::Opponent::RepeatHash(*this) [cachedHash % REPEAT_HASH_SIZE];  // no longer the opponent's turn
     cachedHash       =  unmove.cachedHash;
 
     --ply_number;
-    white_to_move = true;
+    white_to_move = Side::IsWhite;
 
-    PROFILER_EXIT();
+    PROFILER_DETAIL_EXIT();
 }
 
-
-//------------------------------------------------------------------------
-
-
-void ChessBoard::UnmakeBlackMove ( Move move, UnmoveInfo &unmove )
-{
-    PROFILER_ENTER(PX_UNMOVE)
-
-    int      source = move.source & BOARD_OFFSET_MASK;
-    int      dest;
-    SQUARE   capture = unmove.capture;
-    SQUARE   prom_piece_index;
-
-#if DEBUG_UNMOVE
-    if ( board[source] != EMPTY )
-        ChessFatal ( "source not empty in UnmakeWhiteMove" );
-
-    SQUARE destSquare = EMPTY;
-#endif
-
-    if ( move.dest > OFFSET(9,9) )
-    {
-        // This is a "special" move...
-
-        switch ( move.dest & 0xF0 )
-        {
-        case SPECIAL_MOVE_PROMOTE_NORM:
-            prom_piece_index = (move.dest & PIECE_MASK) | BLACK_IND;
-            dest = source + SOUTH;
-#if DEBUG_UNMOVE
-            destSquare = board[dest];
-#endif
-            board [source] = BPAWN;
-            board [dest] = EMPTY;
-            ++inventory [BP_INDEX];
-            --inventory [prom_piece_index];
-            break;
-
-        case SPECIAL_MOVE_PROMOTE_CAP_EAST:
-            prom_piece_index = (move.dest & PIECE_MASK) | BLACK_IND;
-            dest = source + SOUTHEAST;
-#if DEBUG_UNMOVE
-            destSquare = board[dest];
-#endif
-            board [source] = BPAWN;
-            board [dest] = capture;
-            ++inventory [BP_INDEX];
-            --inventory [prom_piece_index];
-            break;
-
-        case SPECIAL_MOVE_PROMOTE_CAP_WEST:
-            prom_piece_index = (move.dest & PIECE_MASK) | BLACK_IND;
-            dest = source + SOUTHWEST;
-#if DEBUG_UNMOVE
-            destSquare = board[dest];
-#endif
-            board [source] = BPAWN;
-            board [dest] = capture;
-            ++inventory [BP_INDEX];
-            --inventory [prom_piece_index];
-            break;
-
-        case SPECIAL_MOVE_KCASTLE:
-#if DEBUG_UNMOVE
-            destSquare = board[OFFSET(8,9)];
-#endif
-            bk_offset = OFFSET(6,9);
-            board [ OFFSET(6,9) ] = BKING;
-            board [ OFFSET(9,9) ] = BROOK;
-            board [ OFFSET(7,9) ] = board [ OFFSET(8,9) ] = EMPTY;
-            break;
-
-        case SPECIAL_MOVE_QCASTLE:
-#if DEBUG_UNMOVE
-            destSquare = board[OFFSET(4,9)];
-#endif
-            bk_offset = OFFSET(6,9);
-            board [ OFFSET(6,9) ] = BKING;
-            board [ OFFSET(2,9) ] = BROOK;
-            board [ OFFSET(4,9) ] = board [ OFFSET(5,9) ] = EMPTY;
-            break;
-
-        case SPECIAL_MOVE_EP_EAST:
-            board [source] = board [dest = source + SOUTHEAST];
-#if DEBUG_UNMOVE
-            destSquare = board[dest];
-#endif
-            board [dest] = EMPTY;
-            board [source + EAST] = capture;
-            break;
-
-        case SPECIAL_MOVE_EP_WEST:
-            board [source] = board [dest = source + SOUTHWEST];
-#if DEBUG_UNMOVE
-            destSquare = board[dest];
-#endif
-            board [dest] = EMPTY;
-            board [source + WEST] = capture;
-            break;
-
-        default:
-            ChessFatal ( "Invalid special move code in ChessBoard::UnmakeBlackMove" );
-            break;
-        }
-    }
-    else
-    {
-        // This is a "normal" move...
-        dest = move.dest;
-#if DEBUG_UNMOVE
-        destSquare = board[dest];
-#endif
-        SQUARE move_piece = board[source] = board[dest];
-        board [dest] = capture;
-
-        if ( move_piece & BK_MASK )
-            bk_offset = source;
-    }
-
-#if DEBUG_UNMOVE
-    if ( !(destSquare & BLACK_MASK) )
-        ChessFatal ( "Attempt to unmove non-black piece in UnmakeBlackMove" );
-#endif
-
-    if ( capture != EMPTY )
-        ++inventory [SPIECE_INDEX(capture)];
-
-    flags            =  unmove.flags;
-    bmaterial        =  unmove.bmaterial;
-    wmaterial        =  unmove.wmaterial;
-    prev_move        =  unmove.prev_move;
-    lastCapOrPawn    =  unmove.lastCapOrPawn;
-
-    --whiteRepeatHash[cachedHash % REPEAT_HASH_SIZE];  // no longer White to move
-    cachedHash       =  unmove.cachedHash;
-
-    --ply_number;
-    white_to_move = false;
-
-    PROFILER_EXIT()
-}
+template void ChessBoard::UnmakeMove<WhiteSide> ( Move, UnmoveInfo & );
+template void ChessBoard::UnmakeMove<BlackSide> ( Move, UnmoveInfo & );
 
 
 /*
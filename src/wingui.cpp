@@ -2236,15 +2236,13 @@ static void UpdateAnalysisDisplay ()
 {
     // update nodes evaluated...
 
-    extern ComputerChessPlayer *ComputerPlayerSearching;
-    ComputerChessPlayer *cp = ComputerPlayerSearching;
+    ChessEngineContext &engine = ChessEngineContext::Default();
+    ComputerChessPlayer *cp = engine.QuerySearchingPlayer();
     if ( Global_UI && cp )
     {
-        extern INT32 TimeSearchStarted;
-
         INT32 currentTime = ChessTime();
         Global_UI->ReportComputerStats (
-            currentTime - TimeSearchStarted,
+            currentTime - engine.QueryTimeSearchStarted(),
             0,
             cp->queryNodesEvaluated(),
             0, 0, 0, 0 );
@@ -2419,10 +2417,6 @@ LRESULT CALLBACK ChessWndProc (
 
     case WM_TIMER:
     {
-#ifdef CHENARD_PROFILER
-        if ( wparam == 1 )   // make sure it's really our timer
-            ++ProfilerHitCount[ProfilerIndex];
-#endif
         if ( wparam == 2 )   // analysis display update timer
             UpdateAnalysisDisplay ();
     }
@@ -2672,10 +2666,11 @@ LRESULT CALLBACK ChessWndProc (
 
         case ID_DUMP_XPOS_TABLE:
         {
-            if (ComputerChessPlayer::XposTable)
+            const TranspositionTable *xposTable = ChessEngineContext::Default().QueryTranspositionTable();
+            if (xposTable)
             {
                 const char *dumpFilename = "xposdump.txt";
-                ComputerChessPlayer::XposTable->debugDump ( dumpFilename );
+                xposTable->debugDump ( dumpFilename );
                 sprintf ( buffer,
                           "Transposition table has been dumped to file '%s'",
                           dumpFilename );
@@ -518,6 +518,7 @@ public:
 
     virtual void DebugPly ( int depth, ChessBoard &, Move );
     virtual void DebugExit ( int depth, ChessBoard &, SCORE );
+    virtual bool WantsDebugPly() const;
     bool allowMateAnnounce ( bool allow )
     {
         bool prev = enableMateAnnounce;
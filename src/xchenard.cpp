@@ -30,9 +30,11 @@
 #include "chenga.h"
 #include "uixboard.h"
 #include "lrntree.h"
+#include "profiler.h"
 
 const char * const CHENARD_VERSION = ConvertDateToVersion(__DATE__);
 const char * const OPTION_OPENING_BOOK = "Use opening book";
+const char * const OPTION_MULTI_PV = "MultiPV";
 bool OpeningBookEnableState = true;
 
 int XboardVersion = 0;
@@ -41,7 +43,7 @@ ChessUI_xboard TheUserInterface;
 ComputerChessPlayer TheComputerPlayer (TheUserInterface);
 bool ComputerIsPlayingBlack = false;
 bool ComputerIsPlayingWhite = false;
-bool GlobalAbortFlag = false;
+std::atomic<bool> GlobalAbortFlag (false);
 bool BoardIsCorrupt = false;
 int TotalMovesPerPeriod = 0;
 int TotalSecondsPerPeriod = 0;
@@ -185,7 +187,7 @@ tLineNode *LineQueueFront = NULL;
 tLineNode *LineQueueBack  = NULL;
 CRITICAL_SECTION LineQueueCriticalSection;
 bool InputThreadHasStarted = false;
-bool InputThreadHasExited  = false;
+std::atomic<bool> InputThreadHasExited (false);
 
 
 void InputThreadFunc (void *)
@@ -354,8 +356,7 @@ void XChenardCleanup()
 void StartNewGame()
 {
     // Allow "memory" command to optionally override transposition hash table size...
-    delete ComputerChessPlayer::XposTable;
-    ComputerChessPlayer::XposTable = new TranspositionTable (MemoryAllotmentInMegabytes);   // if MemoryAllotmentInMegabytes==0, retains original Chenard behavior
+    ChessEngineContext::Default().SetTranspositionTableSize (MemoryAllotmentInMegabytes);   // if MemoryAllotmentInMegabytes==0, retains original Chenard behavior
 
     TheChessBoard.Init();       // Reset the chess board back to its initial, beginning-of-game state.
     BoardIsCorrupt = false;     // We just fixed any problems there might have been in the board state
@@ -1031,6 +1032,11 @@ void ParseOption (const char *text)
         {
             OpeningBookEnableDisable (valueInt != 0);
         }
+        else if (0 == strcmp (name, OPTION_MULTI_PV))
+        {
+            TheComputerPlayer.SetMultiPV (valueInt);
+            dprintf ("Reporting %d line(s) per search iteration.\n", TheComputerPlayer.QueryMultiPV());
+        }
         else if (0 == strcmp (name, "memory"))
         {
             // This is a little bit squirrelly, because it is not an advertised XChenard option.
@@ -1105,7 +1111,9 @@ bool ExecuteCommand (const char *verb, const char *rest)        // returns true
         printf ("feature analyze=0\n");     // FIXFIXFIX:  Implement analyze command some day.
         printf ("feature debug=1\n");       // Not available in all WinBoard/xboard implementions: send debug prints only if we receive "accepted debug".
         printf ("feature memory=1\n");      // [16 September 2009]:  Adding support for the new "memory" command.
+        printf ("feature smp=1\n");         // We accept the "cores" command to set the number of search threads.
         printf ("feature option=\"%s -check %d\"\n", OPTION_OPENING_BOOK, (OpeningBookEnableState ? 1 : 0));      // [17 September 2009]:  Allow user to enable/disable internal opening book and external training file chenard.trx.
+        printf ("feature option=\"%s -spin %d 1 %d\"\n", OPTION_MULTI_PV, TheComputerPlayer.QueryMultiPV(), MAX_MULTI_PV);     // Number of best lines to show, each with an exact score.
         printf ("feature done=1\n");        // ***** This must be the final feature sent (ends xboard timeout) *****
     }
     else if (0 == strcmp(verb,"accepted"))
@@ -1238,12 +1246,42 @@ bool ExecuteCommand (const char *verb, const char *rest)        // returns true
         //      settings just before each "new" command.
         MemoryAllotmentInMegabytes = atoi (rest);   // it is OK if atoi() results in 0 (invalid integer): we will use defaults then
     }
+    else if (0 == strcmp(verb,"cores"))
+    {
+        //      cores N
+        //      This command informs the engine on how many CPU cores it is allowed to use maximally.
+        //      This could be interpreted as the number of search threads for SMP engines.
+        //      This command will only be sent to engines that have requested it through the smp feature.
+        int cores = atoi (rest);
+        if (cores > 0)
+        {
+            TheComputerPlayer.SetThreadCount (cores);
+            dprintf ("Using %d search thread(s).\n", TheComputerPlayer.QueryThreadCount());
+        }
+    }
+    else if (0 == strcmp(verb,"profile"))
+    {
+        // Not part of the xboard protocol: for someone typing at xchenard, or reading its debug log.
+        // "profile" shows the execution profiler's counters as comments; "profile reset" zeroes them.
+#ifdef CHENARD_PROFILER
+        if (0 == strncmp(rest, "reset", 5))
+        {
+            StartProfiler();
+        }
+        else
+        {
+            printf ("%s", ProfilerReport("# ").c_str());
+        }
+#else
+        printf ("# The profiler is not available: build with CHENARD_PROFILER defined.\n");
+#endif
+    }
     else if (0 == strcmp(verb,"option"))
     {
         // [17 September 2009]
         // WinBoard 4.4.xx allows Chenard to request custom options from it, and it will then reply
         // with values chosen by the user.  This is where we receive the choices.
-        // Currently the only custom option we support is whether to enable/disable the opening book (and training file).
+        // We support whether to enable/disable the opening book (and training file), and how many lines to show (MultiPV).
         // rest ==> "Use opening book=0"
         ParseOption (rest);
     }